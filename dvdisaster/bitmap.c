@@ -24,18 +24,23 @@
 
 /***
  *** A simple bitmap structure
- ***/
+ ***
+ * Bits are kept in 64bit words so that whole words can be
+ * skipped when searching, and counted with a single popcount.
+ */
+
+#define ALL_ONES  G_GUINT64_CONSTANT(0xffffffffffffffff)
 
 /*
  * Allocate the bitmap
  */
 
-Bitmap* CreateBitmap0(int size)
+Bitmap* CreateBitmap0(gint64 size)
 {  Bitmap *bm = g_malloc(sizeof(Bitmap));
 
    bm->size   = size;
-   bm->words  = (size>>5)+1;
-   bm->bitmap = g_malloc0(bm->words*sizeof(guint32));
+   bm->words  = (size>>6)+1;
+   bm->bitmap = g_malloc0(bm->words*sizeof(guint64));
 
    return bm;
 }
@@ -51,17 +56,209 @@ void FreeBitmap(Bitmap *bm)
    g_free(bm);
 }
 
+/*
+ * Bit twiddling helpers
+ */
+
+static inline int popcount64(guint64 word)
+{
+#ifdef __GNUC__
+   return __builtin_popcountll(word);
+#else
+   word = word - ((word >> 1) & G_GUINT64_CONSTANT(0x5555555555555555));
+   word = (word & G_GUINT64_CONSTANT(0x3333333333333333)) 
+          + ((word >> 2) & G_GUINT64_CONSTANT(0x3333333333333333));
+   word = (word + (word >> 4)) & G_GUINT64_CONSTANT(0x0f0f0f0f0f0f0f0f);
+   return (word * G_GUINT64_CONSTANT(0x0101010101010101)) >> 56;
+#endif
+}
+
+static inline int lowest_bit64(guint64 word)  /* word must be non-zero */
+{
+#ifdef __GNUC__
+   return __builtin_ctzll(word);
+#else
+   int n = 0;
+
+   while(!(word & 1))
+   {  word >>= 1;
+      n++;
+   }
+   return n;
+#endif
+}
+
+/* Mask with bits [first..63] set */
+
+static inline guint64 mask_from(gint64 first)
+{  return ALL_ONES << (first & 63);
+}
+
+/* Mask with bits [0..last] set */
+
+static inline guint64 mask_upto(gint64 last)
+{  return ALL_ONES >> (63 - (last & 63));
+}
+
 /*
  * Count the '1' bits in the bitmap 
  */
 
-int CountBits(Bitmap *bm)
-{ int i;
-  int sum = 0;
+gint64 CountBits(Bitmap *bm)
+{  gint64 i;
+   gint64 sum = 0;
+
+   if(bm->size <= 0)
+     return 0;
+
+   for(i=0; i<bm->words-1; i++)
+     sum += popcount64(bm->bitmap[i]);
+
+   /* Ignore anything beyond bm->size in the last word */
+
+   sum += popcount64(bm->bitmap[i] & mask_upto(bm->size-1));
+
+   return sum;
+}
+
+/*
+ * Set or clear the bits [first..last], inclusively
+ */
+
+void SetBitRange(Bitmap *bm, gint64 first, gint64 last)
+{  gint64 fw,lw,i;
+
+   if(first < 0) first = 0;
+   if(last >= bm->size) last = bm->size-1;
+   if(first > last) return;
+
+   fw = first>>6;
+   lw = last>>6;
+
+   if(fw == lw)
+   {  bm->bitmap[fw] |= mask_from(first) & mask_upto(last);
+      return;
+   }
+
+   bm->bitmap[fw] |= mask_from(first);
+   for(i=fw+1; i<lw; i++)
+     bm->bitmap[i] = ALL_ONES;
+   bm->bitmap[lw] |= mask_upto(last);
+}
+
+void ClearBitRange(Bitmap *bm, gint64 first, gint64 last)
+{  gint64 fw,lw,i;
+
+   if(first < 0) first = 0;
+   if(last >= bm->size) last = bm->size-1;
+   if(first > last) return;
+
+   fw = first>>6;
+   lw = last>>6;
+
+   if(fw == lw)
+   {  bm->bitmap[fw] &= ~(mask_from(first) & mask_upto(last));
+      return;
+   }
+
+   bm->bitmap[fw] &= ~mask_from(first);
+   for(i=fw+1; i<lw; i++)
+     bm->bitmap[i] = 0;
+   bm->bitmap[lw] &= ~mask_upto(last);
+}
+
+/*
+ * Find the first set (or cleared) bit at position >= start.
+ * Returns bm->size if there is none.
+ */
+
+gint64 FindNextSetBit(Bitmap *bm, gint64 start)
+{  gint64 w;
+   guint64 word;
+
+   if(start < 0) start = 0;
+   if(start >= bm->size) return bm->size;
+
+   w = start>>6;
+   word = bm->bitmap[w] & mask_from(start);
+
+   while(!word)
+   {  if(++w >= bm->words)
+	return bm->size;
+      word = bm->bitmap[w];
+   }
+
+   start = (w<<6) + lowest_bit64(word);
+   return start < bm->size ? start : bm->size;
+}
+
+/*
+ * Find the first set bit within [first..last].
+ * Unlike FindNextSetBit() the search stops at last,
+ * so testing a short window is cheap. Returns -1 if there is none.
+ */
+
+gint64 FindSetBitInRange(Bitmap *bm, gint64 first, gint64 last)
+{  gint64 w,lw;
+   guint64 word;
+
+   if(first < 0) first = 0;
+   if(last >= bm->size) last = bm->size-1;
+   if(first > last) return -1;
+
+   w  = first>>6;
+   lw = last>>6;
+   word = bm->bitmap[w] & mask_from(first);
+
+   while(w < lw)
+   {  if(word)
+	return (w<<6) + lowest_bit64(word);
+      word = bm->bitmap[++w];
+   }
+
+   word &= mask_upto(last);
+   return word ? (w<<6) + lowest_bit64(word) : -1;
+}
+
+gint64 FindNextClearBit(Bitmap *bm, gint64 start)
+{  gint64 w;
+   guint64 word;
+
+   if(start < 0) start = 0;
+   if(start >= bm->size) return bm->size;
+
+   w = start>>6;
+   word = ~bm->bitmap[w] & mask_from(start);
+
+   while(!word)
+   {  if(++w >= bm->words)
+	return bm->size;
+      word = ~bm->bitmap[w];
+   }
+
+   start = (w<<6) + lowest_bit64(word);
+   return start < bm->size ? start : bm->size;
+}
+
+/*
+ * Return the bits [first..first+63] as one word, bit 0 being first.
+ * Bits beyond the end of the bitmap are returned as zero.
+ */
+
+guint64 GetBitWord(Bitmap *bm, gint64 first)
+{  gint64 w = first>>6;
+   int shift = first & 63;
+   guint64 word;
+
+   if(first < 0 || first >= bm->size) 
+     return 0;
+
+   word = bm->bitmap[w] >> shift;
+   if(shift && w+1 < bm->words)
+     word |= bm->bitmap[w+1] << (64-shift);
 
-  for(i=0; i<bm->size; i++)
-    if(GetBit(bm, i))
-      sum++;
+   if(bm->size - first < 64)
+     word &= mask_upto(bm->size - first - 1);
 
-  return sum;
+   return word;
 }
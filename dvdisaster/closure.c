@@ -484,12 +484,14 @@ void ReadDotfile()
       if(!strcmp(symbol, "missing-sector-marker"))  { Closure->dsmVersion  = atoi(value); continue; }
       if(!strcmp(symbol, "prefetch-sectors")){ Closure->prefetchSectors  = atoi(value); continue; }
       if(!strcmp(symbol, "raw-mode"))        { Closure->rawMode = atoi(value); continue; }
+      if(!strcmp(symbol, "raw-sample-memory")) { Closure->rawSampleMB = atoi(value); continue; }
       if(!strcmp(symbol, "read-and-create")) { Closure->readAndCreate = atoi(value); continue; }
       if(!strcmp(symbol, "read-medium"))     { Closure->readingPasses = atoi(value); continue; }
       if(!strcmp(symbol, "read-raw"))        { Closure->readRaw = atoi(value); continue; }
       if(!strcmp(symbol, "redundancy"))      { if(Closure->redundancy) g_free(Closure->redundancy);
                                                Closure->redundancy  = g_strdup(value); continue; }
       if(!strcmp(symbol, "reverse-cancel-ok")) { Closure->reverseCancelOK = atoi(value); continue; }
+      if(!strcmp(symbol, "sector-map"))      { Closure->sectorMap = atoi(value); continue; }
       if(!strcmp(symbol, "spinup-delay"))    { Closure->spinupDelay = atoi(value); continue; }
       if(!strcmp(symbol, "unlink"))          { Closure->unlinkImage = atoi(value); continue; }
       if(!strcmp(symbol, "verbose"))         { Closure->verbose = atoi(value); continue; }
@@ -584,12 +586,14 @@ static void update_dotfile()
    g_fprintf(dotfile, "missing-sector-marker: %d\n", Closure->dsmVersion);
    g_fprintf(dotfile, "prefetch-sectors:  %d\n", Closure->prefetchSectors);
    g_fprintf(dotfile, "raw-mode:          %d\n", Closure->rawMode);
+   g_fprintf(dotfile, "raw-sample-memory: %d\n", Closure->rawSampleMB);
    g_fprintf(dotfile, "read-and-create:   %d\n", Closure->readAndCreate);
    g_fprintf(dotfile, "read-medium:       %d\n", Closure->readingPasses);
    g_fprintf(dotfile, "read-raw:          %d\n", Closure->readRaw);
    if(Closure->redundancy)
      g_fprintf(dotfile, "redundancy:        %s\n", Closure->redundancy);
    g_fprintf(dotfile, "reverse-cancel-ok: %d\n", Closure->reverseCancelOK);
+   g_fprintf(dotfile, "sector-map:        %d\n", Closure->sectorMap);
    g_fprintf(dotfile, "spinup-delay:      %d\n", Closure->spinupDelay);
    g_fprintf(dotfile, "unlink:            %d\n", Closure->unlinkImage);
    g_fprintf(dotfile, "verbose:           %d\n", Closure->verbose);
@@ -698,8 +702,10 @@ void InitClosure()
    Closure->minReadAttempts = 1;
    Closure->maxReadAttempts = 1;
    Closure->rawMode     = 0x20;
+   Closure->rawSampleMB = 32;
    Closure->internalAttempts = -1;
    Closure->sectorSkip  = 16;
+   Closure->sectorMap   = TRUE;
    Closure->spinupDelay = 5;
    Closure->fillUnreadable = -1;
    Closure->welcomeMessage = 1;
@@ -798,6 +804,7 @@ void FreeClosure()
      update_dotfile();
 
    ClearCrcCache();
+   FreeGaloisTableCache();
 
    cond_free(Closure->cookedVersion);
    cond_free(Closure->versionString);
@@ -822,6 +829,9 @@ void FreeClosure()
    cond_free(Closure->errorTitle);
    cond_free(Closure->dDumpDir);
    cond_free(Closure->dDumpPrefix);
+   cond_free(Closure->readProfile);
+   cond_free(Closure->statsFile);
+   cond_free(Closure->traceFile);
 
    if(Closure->prefsContext)
      FreePreferences(Closure->prefsContext);
@@ -171,12 +171,22 @@ CrcBuf *GetCRCFromRS02_obsolete(void *layv, void *dhv, LargeFile *image)
  ***/
 
 int CheckAgainstCrcBuffer(CrcBuf *cb, gint64 idx, unsigned char *buf)
-{  guint32 crc;
-
+{
    if(idx < 0 || idx >= cb->size)
       Stop("CheckAgainstCrcBuffer: illegal index %ldd\n", idx);
 
-   crc = Crc32(buf, 2048);
+   return CheckCrcAgainstCrcBuffer(cb, idx, Crc32(buf, 2048));
+}
+
+/*
+ * Same as above, but for an already known CRC sum
+ * (e.g. taken from the sector map)
+ */
+
+int CheckCrcAgainstCrcBuffer(CrcBuf *cb, gint64 idx, guint32 crc)
+{
+   if(idx < 0 || idx >= cb->size)
+      Stop("CheckCrcAgainstCrcBuffer: illegal index %ldd\n", idx);
 
    if(!GetBit(cb->valid, idx))
       return CRC_UNKNOWN;
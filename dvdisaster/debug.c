@@ -27,6 +27,9 @@
 #include "udf.h"
 
 #include <time.h>
+#ifndef SYS_MINGW
+#include <sys/resource.h>
+#endif
 
 /***
  *** Debugging functions.
@@ -394,20 +397,15 @@ void RandomError(char *arg)
 
    if(!strncmp(method->name, "RS01", 4))
      random_error1(image, arg);
-
-   if(!strncmp(method->name, "RS02", 4))
-   {  random_error2(image, arg);
-      return;
-   }
-
-   if(!strncmp(method->name, "RS03", 4))
-   {  random_error3(image, arg);
-      return;
+   else if(!strncmp(method->name, "RS02", 4))
+     random_error2(image, arg);
+   else if(!strncmp(method->name, "RS03", 4))
+     random_error3(image, arg);
+   else
+   {  strncpy(buf, method->name, 4); buf[4] = 0;
+      Stop("Don't know how to handle codec %s\n", buf);
    }
 
-   strncpy(buf, method->name, 4); buf[4] = 0;
-   Stop("Don't know how to handle codec %s\n", buf);
-
    CloseImage(image);
 }
 
@@ -688,6 +686,1085 @@ void ZeroUnreadable(void)
    FreeImageInfo(ii);
 }
 
+/*
+ * Microbenchmark for the dead sector marker scan.
+ * Compares the per-sector CheckForMissingSector() loop
+ * against the batched CheckForMissingSectors().
+ */
+
+void BenchMissingSectors(char *arg)
+{  unsigned char *buf;
+   guint32 *words;
+   gint64 sectors = arg ? atoll(arg) : 0;
+   gint64 i,first_defect = 0;
+   int rounds = 20;
+   int r,result_single = SECTOR_PRESENT,result_batch = SECTOR_PRESENT;
+   GTimer *timer;
+   double single_time, batch_time;
+   double mbytes;
+
+   if(sectors < 1) sectors = 16384;
+   if(sectors > 32768) sectors = 32768;   /* 64MB */
+
+   /*** Fill the buffer with random data and put a marker into the last sector */
+
+   buf = g_malloc(2048*sectors);
+   words = (guint32*)buf;
+   for(i=0; i<512*sectors; i++)
+      words[i] = Random32();
+
+   CreateMissingSector(buf+2048*(sectors-1), sectors-1, NULL, 0, NULL);
+
+   /*** Per sector loop */
+
+   timer = g_timer_new();
+   for(r=0; r<rounds; r++)
+      for(i=0; i<sectors; i++)
+      {  result_single = CheckForMissingSector(buf+2048*i, i, NULL, 0);
+	 if(result_single != SECTOR_PRESENT)
+	    break;
+      }
+   single_time = g_timer_elapsed(timer, NULL);
+
+   /*** Batched scan */
+
+   g_timer_start(timer);
+   for(r=0; r<rounds; r++)
+      result_batch = CheckForMissingSectors(buf, 0, NULL, 0, sectors, (guint64*)&first_defect);
+   batch_time = g_timer_elapsed(timer, NULL);
+
+   g_timer_destroy(timer);
+   g_free(buf);
+
+   if(result_single != result_batch || first_defect != sectors-1)
+      Stop("BenchMissingSectors: results differ (%d/%d, defect at %lld)\n",
+	   result_single, result_batch, first_defect);
+
+   mbytes = (2048.0*sectors*rounds)/(1024.0*1024.0);
+   PrintLog("Scanned %lld sectors %d times for dead sector markers:\n", sectors, rounds);
+   PrintLog("  per sector: %7.3fs (%8.1f MB/s)\n", single_time, mbytes/single_time);
+   PrintLog("  batched   : %7.3fs (%8.1f MB/s)\n", batch_time, mbytes/batch_time);
+}
+
+/*
+ * Helpers shared by the benchmarks below
+ */
+
+static int compare_seconds(const void *a, const void *b)
+{  double x = *(double*)a;
+   double y = *(double*)b;
+
+   if(x < y) return -1;
+   if(x > y) return 1;
+   return 0;
+}
+
+/* Nearest rank percentile of n >= 1 sorted values, e.g. p=99 picks
+   the ceil(0.99*n)-th value, which is the largest one for n < 100 */
+
+static double bench_percentile(double *sorted, int n, int p)
+{
+   return sorted[(p*n+99)/100 - 1];
+}
+
+/* Create a mode 1 frame with valid EDC and L-EC parity */
+
+static void make_bench_frame(ReedSolomonTables *rt, unsigned char *frame, int lba)
+{  unsigned char vector[Q_VECTOR_SIZE];
+   int eras[3];
+   guint32 crc;
+   int i;
+
+   InitializeCDFrame(frame, lba, 0, 0);
+   for(i=16; i<2064; i++)
+      frame[i] = Random() & 0xff;
+
+   crc = EDCCrc32(frame, 2064);
+   frame[2064] = crc & 0xff;
+   frame[2065] = (crc >> 8) & 0xff;
+   frame[2066] = (crc >> 16) & 0xff;
+   frame[2067] = (crc >> 24) & 0xff;
+
+   /* Decoding the parity bytes as erasures creates them */
+
+   for(i=0; i<N_P_VECTORS; i++)
+   {  GetPVector(frame, vector, i);
+      eras[0] = P_VECTOR_SIZE-2; eras[1] = P_VECTOR_SIZE-1;
+      DecodePQ(rt, vector, P_PADDING, eras, 2);
+      SetPVector(frame, vector, i);
+   }
+
+   for(i=0; i<N_Q_VECTORS; i++)
+   {  GetQVector(frame, vector, i);
+      eras[0] = Q_VECTOR_SIZE-2; eras[1] = Q_VECTOR_SIZE-1;
+      DecodePQ(rt, vector, Q_PADDING, eras, 2);
+      SetQVector(frame, vector, i);
+   }
+}
+
+/*
+ * Benchmark decoding all P/Q vectors of raw frames
+ * one by one against the batched decoders
+ */
+
+void BenchPQDecode(char *arg)
+{  GaloisTables *gt = CreateGaloisTables(0x11d);
+   ReedSolomonTables *rt = CreateReedSolomonTables(gt, 0, 1, 10);
+   unsigned char *frames, *frame;
+   unsigned char vector[Q_VECTOR_SIZE];
+   unsigned char value[N_P_VECTORS];
+   int err[N_P_VECTORS], pos[N_P_VECTORS];
+   int single_err[N_P_VECTORS+N_Q_VECTORS];
+   int n_frames = arg ? atoi(arg) : 0;
+   int i,j,v;
+   gint64 single_failures = 0;
+   GTimer *timer;
+   double single_time, batch_time;
+
+   if(n_frames < 1) n_frames = 10000;
+   if(n_frames > 100000) n_frames = 100000;
+
+   /*** Start with valid frames and damage some bytes */
+
+   frames = g_malloc(CD_RAW_SECTOR_SIZE*n_frames);
+   for(i=0, frame=frames; i<n_frames; i++, frame+=CD_RAW_SECTOR_SIZE)
+   {  int n_errors = Random() % 10;
+
+      make_bench_frame(rt, frame, i);
+
+      for(j=0; j<n_errors; j++)
+	 frame[12 + Random() % (CD_RAW_SECTOR_SIZE-12)] = Random() & 0xff;
+   }
+
+   /*** One vector at a time */
+
+   timer = g_timer_new();
+   for(i=0, frame=frames; i<n_frames; i++, frame+=CD_RAW_SECTOR_SIZE)
+   {  for(v=0; v<N_P_VECTORS; v++)
+      {  GetPVector(frame, vector, v);
+	 if(DecodePQ(rt, vector, P_PADDING, pos, 0) < 0)
+	    single_failures++;
+      }
+      for(v=0; v<N_Q_VECTORS; v++)
+      {  GetQVector(frame, vector, v);
+	 if(DecodePQ(rt, vector, Q_PADDING, pos, 0) < 0)
+	    single_failures++;
+      }
+   }
+   single_time = g_timer_elapsed(timer, NULL);
+
+   /*** Batched */
+
+   g_timer_start(timer);
+   for(i=0, frame=frames; i<n_frames; i++, frame+=CD_RAW_SECTOR_SIZE)
+   {  DecodePVectors(rt, frame, err, pos, value);
+      DecodeQVectors(rt, frame, err, pos, value);
+   }
+   batch_time = g_timer_elapsed(timer, NULL);
+
+   /*** Compare the per vector results */
+
+   for(i=0, frame=frames; i<n_frames; i++, frame+=CD_RAW_SECTOR_SIZE)
+   {  for(v=0; v<N_P_VECTORS; v++)
+      {  GetPVector(frame, vector, v);
+	 single_err[v] = DecodePQ(rt, vector, P_PADDING, pos, 0);
+      }
+      for(v=0; v<N_Q_VECTORS; v++)
+      {  GetQVector(frame, vector, v);
+	 single_err[N_P_VECTORS+v] = DecodePQ(rt, vector, Q_PADDING, pos, 0);
+      }
+
+      DecodePVectors(rt, frame, err, pos, value);
+      for(v=0; v<N_P_VECTORS; v++)
+	 if(err[v] != single_err[v])
+	    Stop("BenchPQDecode: frame %d, P%02d: %d/%d\n", i, v, single_err[v], err[v]);
+
+      DecodeQVectors(rt, frame, err, pos, value);
+      for(v=0; v<N_Q_VECTORS; v++)
+	 if(err[v] != single_err[N_P_VECTORS+v])
+	    Stop("BenchPQDecode: frame %d, Q%02d: %d/%d\n", i, v, single_err[N_P_VECTORS+v], err[v]);
+   }
+
+   g_timer_destroy(timer);
+   g_free(frames);
+   FreeReedSolomonTables(rt);
+   FreeGaloisTables(gt);
+
+   PrintLog("Decoded all P/Q vectors of %d frames (%lld uncorrectable vectors):\n", 
+	    n_frames, single_failures);
+   PrintLog("  per vector: %7.3fs (%8.0f frames/s)\n", single_time, n_frames/single_time);
+   PrintLog("  batched   : %7.3fs (%8.0f frames/s)\n", batch_time, n_frames/batch_time);
+}
+
+/*
+ * Benchmark the raw sector recovery strategies on synthetic frames.
+ * arg is "frames,rereads,bursts,length,c2[,strategy...]": Each frame 
+ * gets a number of defect sites which are hit by bursts of up to the 
+ * given length in 3 out of 4 rereads. c2 is the percentage of damaged 
+ * bytes which are flagged in the C2 vector (0 = drive without C2 support).
+ * Every strategy is given the same rereads one by one, like the
+ * raw reader does, until it recovers the sector or runs out of samples.
+ * Smart L-EC is only run when named explicitly since it is disabled
+ * in the raw reader and may not terminate.
+ */
+
+typedef struct
+{  char *name;
+   void (*run)(RawBuffer*);
+   int byDefault;
+} raw_strategy;
+
+static void run_iterative_lec(RawBuffer *rb)
+{  IterativeLEC(rb);
+}
+
+static void run_heuristic_lec(RawBuffer *rb)
+{  HeuristicLEC(rb->recovered, rb, NULL);
+}
+
+static void run_smart_lec(RawBuffer *rb)
+{  SmartLEC(rb);
+}
+
+static void run_brute_force(RawBuffer *rb)
+{  BruteForceSearchPlausibleSector(rb);
+}
+
+static raw_strategy raw_strategies[] =
+{  { "iterative",  run_iterative_lec, TRUE },
+   { "heuristic",  run_heuristic_lec, TRUE },
+   { "smart",      run_smart_lec,     FALSE },
+   { "bruteforce", run_brute_force,   TRUE },
+   { NULL, NULL, FALSE }
+};
+
+/* Create the rereads of a frame according to the error model */
+
+static void make_bench_samples(unsigned char *frame, unsigned char *samples, 
+			       int rereads, int bursts, int length, int c2)
+{  int site[bursts];
+   int i,j,k;
+
+   for(i=0; i<bursts; i++)
+      site[i] = 12 + Random() % (CD_RAW_SECTOR_SIZE-12-length);
+
+   for(k=0; k<rereads; k++)
+   {  unsigned char *sample = samples + k*MAX_RAW_TRANSFER_SIZE;
+
+      memcpy(sample, frame, CD_RAW_SECTOR_SIZE);
+      memset(sample+CD_RAW_SECTOR_SIZE, 0, MAX_RAW_TRANSFER_SIZE-CD_RAW_SECTOR_SIZE);
+      if(c2) sample[CD_RAW_DUMP_SIZE-1] = 1;
+
+      for(i=0; i<bursts; i++)
+      {  int len = 1 + Random() % length;
+
+	 if(Random() % 4 == 0)
+	    continue;
+
+	 for(j=site[i]; j<site[i]+len; j++)
+	 {  sample[j] = Random() & 0xff;
+	    if(Random() % 100 < c2)
+	       sample[CD_RAW_SECTOR_SIZE + (j>>3)] |= 0x80 >> (j&7);
+	 }
+      }
+   }
+}
+
+void BenchRawRecovery(char *arg)
+{  int n_frames = 100, rereads = 5, bursts = 8, length = 16, c2 = 0;
+   int n_strategies = sizeof(raw_strategies)/sizeof(raw_strategy) - 1;
+   unsigned char *frame, *samples;
+   double *seconds[n_strategies];
+   double total[n_strategies];
+   int recovered[n_strategies], wrong[n_strategies], used[n_strategies];
+   int selected[n_strategies], named = FALSE;
+   RawBuffer *rb;
+   GTimer *timer;
+   int i,k,s;
+
+   memset(selected, 0, sizeof(selected));
+
+   /* Numeric parameters first, then optional strategy names */
+
+   if(arg)
+   {  int *param[] = { &n_frames, &rereads, &bursts, &length, &c2 };
+      int n_params = 0;
+      char *cpos = arg;
+
+      while(cpos && *cpos)
+      {  char *next = strchr(cpos, ',');
+
+	 if(next) *next++ = 0;
+
+	 if(isdigit(*cpos) && n_params < 5)
+	    *param[n_params++] = atoi(cpos);
+	 else
+	 {  for(s=0; s<n_strategies; s++)
+	       if(!strcmp(cpos, raw_strategies[s].name))
+		  break;
+	    if(s == n_strategies)
+	       Stop("BenchRawRecovery: unknown strategy %s\n", cpos);
+	    selected[s] = named = TRUE;
+	 }
+
+	 cpos = next;
+      }
+   }
+
+   if(!named)
+      for(s=0; s<n_strategies; s++)
+	 selected[s] = raw_strategies[s].byDefault;
+
+   if(n_frames < 1) n_frames = 1;
+   if(rereads < 1) rereads = 1;
+   if(bursts < 0) bursts = 0;
+   if(length < 1) length = 1;
+   if(length > 1024) length = 1024;
+   if(c2 < 0) c2 = 0;
+   if(c2 > 100) c2 = 100;
+
+   Closure->maxReadAttempts = rereads;
+   rb = CreateRawBuffer(MAX_RAW_TRANSFER_SIZE);
+   rb->sampleSize = c2 ? CD_RAW_DUMP_SIZE : CD_RAW_SECTOR_SIZE;
+
+   frame   = g_malloc(MAX_RAW_TRANSFER_SIZE);
+   samples = g_malloc(rereads*MAX_RAW_TRANSFER_SIZE);
+
+   for(s=0; s<n_strategies; s++)
+   {  seconds[s] = g_malloc(n_frames*sizeof(double));
+      total[s] = 0.0;
+      recovered[s] = wrong[s] = used[s] = 0;
+   }
+
+   PrintLog("Raw recovery benchmark: %d frames, %d rereads, %d bursts of up to %d bytes, %d%% C2 coverage\n",
+	    n_frames, rereads, bursts, length, c2);
+
+   SRandom(1);
+   timer = g_timer_new();
+
+   for(i=0; i<n_frames; i++)
+   {  int lba = 1000+i;
+
+      make_bench_frame(rb->rt, frame, lba);
+      make_bench_samples(frame, samples, rereads, bursts, length, c2);
+
+      for(s=0; s<n_strategies; s++)
+      {  double elapsed = 0.0;
+
+	 if(!selected[s])
+	    continue;
+
+	 ResetRawBuffer(rb);
+	 rb->lba        = lba;
+	 rb->xaMode     = FALSE;
+	 rb->dataOffset = 16;
+
+	 for(k=0; k<rereads; k++)
+	 {  g_timer_start(timer);
+
+	    ReserveRawSample(rb);
+	    memcpy(rb->rawBuf[rb->samplesRead], samples + k*MAX_RAW_TRANSFER_SIZE, rb->sampleSize);
+	    rb->samplesRead++;
+	    UpdateFrameStats(rb);
+
+	    memcpy(rb->recovered, samples + k*MAX_RAW_TRANSFER_SIZE, rb->sampleSize);
+	    InitializeCDFrame(rb->recovered, lba, FALSE, TRUE);
+	    memset(rb->byteState, 0, rb->sampleSize);
+
+	    raw_strategies[s].run(rb);
+
+	    elapsed += g_timer_elapsed(timer, NULL);
+
+	    if(CheckEDC(rb->recovered, rb->xaMode)
+	       && CheckMSF(rb->recovered, lba, STRICT_MSF_CHECK))
+	    {  if(memcmp(rb->recovered+16, frame+16, 2048))
+		  wrong[s]++;
+	       else
+	       {  seconds[s][recovered[s]++] = elapsed;
+		  used[s] += k+1;
+	       }
+	       break;
+	    }
+	 }
+
+	 total[s] += elapsed;
+      }
+   }
+
+   /*** Report */
+
+   PrintLog("%-10s %10s %9s %6s %8s %10s %10s %10s\n",
+	    "strategy", "sectors/s", "recovered", "wrong", "rereads",
+	    "p50 [ms]", "p90 [ms]", "p99 [ms]");
+
+   for(s=0; s<n_strategies; s++)
+   {  double *sec = seconds[s];
+      int n = recovered[s];
+
+      if(!selected[s])
+      {  g_free(sec);
+	 continue;
+      }
+
+      qsort(sec, n, sizeof(double), compare_seconds);
+
+      PrintLog("%-10s %10.1f %8.1f%% %6d %8.2f",
+	       raw_strategies[s].name,
+	       total[s] > 0.0 ? n_frames/total[s] : 0.0,
+	       (100.0*n)/n_frames, wrong[s],
+	       n ? (double)used[s]/n : 0.0);
+
+      if(n) PrintLog(" %10.3f %10.3f %10.3f\n",
+		     1000.0*bench_percentile(sec, n, 50),
+		     1000.0*bench_percentile(sec, n, 90),
+		     1000.0*bench_percentile(sec, n, 99));
+      else  PrintLog(" %10s %10s %10s\n", "-", "-", "-");
+
+      g_free(seconds[s]);
+   }
+
+   g_timer_destroy(timer);
+   g_free(frame);
+   g_free(samples);
+   FreeRawBuffer(rb);
+}
+
+/*
+ * Codec microbenchmark.
+ * arg is "mbytes,repetitions[,nroots...]". Each kernel is run
+ * repetitions times over (up to) mbytes of random data. The median
+ * and the 99th percentile run (by nearest rank, which is the slowest
+ * run for less than 100 repetitions) are printed as JSON on
+ * stdout so that builds and hosts can be compared by scripts.
+ * Throughput is given in MB/s with MB = 2^20 bytes.
+ */
+
+#define BENCH_MAX_ROOTS 16
+
+typedef struct
+{  unsigned char *data;      /* random test data */
+   gint64 size;              /* bytes in data, multiple of 2048 */
+   int reps;
+   double *seconds;          /* time of each repetition */
+   GTimer *timer;
+   int nResults;
+} codec_bench;
+
+static void report_codec_bench(codec_bench *cb, char *kernel, char *backend, int nroots, gint64 bytes)
+{  double mbytes = (double)bytes/(1024.0*1024.0);
+   double median, p99;
+
+   qsort(cb->seconds, cb->reps, sizeof(double), compare_seconds);
+   median = bench_percentile(cb->seconds, cb->reps, 50);
+   p99    = bench_percentile(cb->seconds, cb->reps, 99);
+
+   g_printf("%s\n    {\"kernel\": \"%s\", \"backend\": \"%s\", \"nroots\": %d, \"bytes\": %lld, "
+	    "\"median_mb_s\": %.1f, \"p99_mb_s\": %.1f}",
+	    cb->nResults ? "," : "",
+	    kernel, backend, nroots, (long long int)bytes,
+	    median > 0.0 ? mbytes/median : 0.0,
+	    p99    > 0.0 ? mbytes/p99    : 0.0);
+   fflush(stdout);
+
+   cb->nResults++;
+}
+
+/* Reed-Solomon encoding as done by RS03, one backend at a time */
+
+static void bench_encoder(codec_bench *cb, char *backend, int nroots)
+{  GaloisTables *gt = CreateGaloisTables(RS_GENERATOR_POLY);
+   ReedSolomonTables *rt = CreateReedSolomonTables(gt, RS_FIRST_ROOT, RS_PRIM_ELEM, nroots);
+   int ndata = GF_FIELDMAX - nroots;
+   int nroots_aligned = (nroots+15)&~15;
+   gint64 layer_size = ((cb->size/ndata)/2048)*2048;
+   unsigned char *paritybase, *parity;
+   int r,layer;
+
+   paritybase = g_malloc(layer_size*nroots_aligned + 16);
+   parity     = paritybase + (16 - ((unsigned long)paritybase & 15));
+
+   for(r=0; r<cb->reps; r++)
+   {  memset(parity, 0, layer_size*nroots_aligned);
+
+      g_timer_start(cb->timer);
+      for(layer=0; layer<ndata; layer++)
+	 EncodeNextLayer(rt, cb->data + layer*layer_size, parity, layer_size,
+			 (rt->shiftInit + layer) % nroots);
+      cb->seconds[r] = g_timer_elapsed(cb->timer, NULL);
+   }
+
+   report_codec_bench(cb, "rs_encode", backend, nroots, layer_size*ndata);
+
+   g_free(paritybase);
+   FreeReedSolomonTables(rt);
+   FreeGaloisTables(gt);
+}
+
+/* Syndrome calculation over full size RS(255, 255-nroots) code words */
+
+static void bench_syndromes(codec_bench *cb, int nroots)
+{  GaloisTables *gt = CreateGaloisTables(RS_GENERATOR_POLY);
+   ReedSolomonTables *rt = CreateReedSolomonTables(gt, RS_FIRST_ROOT, RS_PRIM_ELEM, nroots);
+   gint64 n_words = MIN(cb->size, 8*1024*1024) / GF_FIELDMAX;
+   gint64 i;
+   int r;
+
+   for(r=0; r<cb->reps; r++)
+   {  g_timer_start(cb->timer);
+      for(i=0; i<n_words; i++)
+	 TestErrorSyndromes(rt, cb->data + i*GF_FIELDMAX);
+      cb->seconds[r] = g_timer_elapsed(cb->timer, NULL);
+   }
+
+   report_codec_bench(cb, "rs_syndromes", "portable", nroots, n_words*GF_FIELDMAX);
+
+   FreeReedSolomonTables(rt);
+   FreeGaloisTables(gt);
+}
+
+/* Erasure decoding of all L-EC P/Q vectors of valid raw frames, two erasures each */
+
+static void bench_lec_erasures(codec_bench *cb)
+{  GaloisTables *gt = CreateGaloisTables(0x11d);
+   ReedSolomonTables *rt = CreateReedSolomonTables(gt, 0, 1, 10);
+   gint64 n_frames = MIN(cb->size, 8*1024*1024) / CD_RAW_SECTOR_SIZE;
+   unsigned char *frames = g_malloc(n_frames*CD_RAW_SECTOR_SIZE);
+   unsigned char vector[Q_VECTOR_SIZE];
+   gint64 i;
+   int r,v;
+
+   for(i=0; i<n_frames; i++)
+      make_bench_frame(rt, frames + i*CD_RAW_SECTOR_SIZE, i);
+
+   for(r=0; r<cb->reps; r++)
+   {  g_timer_start(cb->timer);
+      for(i=0; i<n_frames; i++)
+      {  unsigned char *frame = frames + i*CD_RAW_SECTOR_SIZE;
+
+	 for(v=0; v<N_P_VECTORS; v++)
+	 {  int eras[2] = { v % P_VECTOR_SIZE, (v+13) % P_VECTOR_SIZE };
+
+	    GetPVector(frame, vector, v);
+	    DecodePQ(rt, vector, P_PADDING, eras, 2);
+	 }
+	 for(v=0; v<N_Q_VECTORS; v++)
+	 {  int eras[2] = { v % Q_VECTOR_SIZE, (v+22) % Q_VECTOR_SIZE };
+
+	    GetQVector(frame, vector, v);
+	    DecodePQ(rt, vector, Q_PADDING, eras, 2);
+	 }
+      }
+      cb->seconds[r] = g_timer_elapsed(cb->timer, NULL);
+   }
+
+   report_codec_bench(cb, "lec_erasure_decode", "portable", 10, n_frames*CD_RAW_SECTOR_SIZE);
+
+   g_free(frames);
+   FreeReedSolomonTables(rt);
+   FreeGaloisTables(gt);
+}
+
+/* Checksums */
+
+static void bench_checksums(codec_bench *cb)
+{  gint64 sectors = cb->size/2048;
+   gint64 frames  = cb->size/CD_RAW_SECTOR_SIZE;
+   struct MD5Context ctxt;
+   guint8 digest[16];
+   gint64 i;
+   int r;
+
+   for(r=0; r<cb->reps; r++)
+   {  g_timer_start(cb->timer);
+      for(i=0; i<sectors; i++)
+	 Crc32(cb->data + 2048*i, 2048);
+      cb->seconds[r] = g_timer_elapsed(cb->timer, NULL);
+   }
+   report_codec_bench(cb, "crc32", "portable", 0, 2048*sectors);
+
+   /* EDC covers sync, header and user data of a mode 1 frame */
+
+   for(r=0; r<cb->reps; r++)
+   {  g_timer_start(cb->timer);
+      for(i=0; i<frames; i++)
+	 EDCCrc32(cb->data + CD_RAW_SECTOR_SIZE*i, 2064);
+      cb->seconds[r] = g_timer_elapsed(cb->timer, NULL);
+   }
+   report_codec_bench(cb, "edc_crc32", "portable", 0, 2064*frames);
+
+   for(r=0; r<cb->reps; r++)
+   {  g_timer_start(cb->timer);
+      MD5Init(&ctxt);
+      MD5Update(&ctxt, cb->data, cb->size);
+      MD5Final(digest, &ctxt);
+      cb->seconds[r] = g_timer_elapsed(cb->timer, NULL);
+   }
+   report_codec_bench(cb, "md5", "portable", 0, cb->size);
+}
+
+/* Four md5sums at once, as done for the RS02 ecc slices */
+
+static void bench_md5_multi(codec_bench *cb, char *backend)
+{  struct MD5Context ctxt[4], *ctxt_ptr[4];
+   unsigned char *buf[4];
+   guint8 digest[16];
+   unsigned len = (cb->size/4) & ~63;
+   int i,r;
+
+   for(i=0; i<4; i++)
+   {  ctxt_ptr[i] = &ctxt[i];
+      buf[i] = cb->data + i*len;
+   }
+
+   for(r=0; r<cb->reps; r++)
+   {  g_timer_start(cb->timer);
+      for(i=0; i<4; i++)
+	 MD5Init(&ctxt[i]);
+      MD5UpdateMulti(ctxt_ptr, buf, 4, len);
+      for(i=0; i<4; i++)
+	 MD5Final(digest, &ctxt[i]);
+      cb->seconds[r] = g_timer_elapsed(cb->timer, NULL);
+   }
+   report_codec_bench(cb, "md5_multi", backend, 0, 4*(gint64)len);
+}
+
+/* Dead sector marker detection, per sector and batched */
+
+static void bench_missing_sectors(codec_bench *cb)
+{  gint64 sectors = cb->size/2048;
+   gint64 i,first_defect;
+   int r;
+
+   for(r=0; r<cb->reps; r++)
+   {  g_timer_start(cb->timer);
+      for(i=0; i<sectors; i++)
+	 CheckForMissingSector(cb->data + 2048*i, i, NULL, 0);
+      cb->seconds[r] = g_timer_elapsed(cb->timer, NULL);
+   }
+   report_codec_bench(cb, "missing_sector_check", "portable", 0, 2048*sectors);
+
+   for(r=0; r<cb->reps; r++)
+   {  g_timer_start(cb->timer);
+      CheckForMissingSectors(cb->data, 0, NULL, 0, sectors, (guint64*)&first_defect);
+      cb->seconds[r] = g_timer_elapsed(cb->timer, NULL);
+   }
+   report_codec_bench(cb, "missing_sector_scan", "portable", 0, 2048*sectors);
+}
+
+void BenchCodec(char *arg)
+{  codec_bench *cb = g_malloc0(sizeof(codec_bench));
+   int roots[BENCH_MAX_ROOTS] = { 16, 20, 32, 64 };
+   int n_roots = 4;
+   int mbytes = 32;
+   int have_sse2    = Closure->useSSE2;
+   int have_altivec = Closure->useAltiVec;
+   guint32 *words;
+   gint64 i;
+   int r;
+
+   cb->reps = 9;
+
+   /*** Parse the arguments */
+
+   if(arg && *arg)
+   {  char *cpos = arg;
+      int n = 0;
+
+      while(cpos && *cpos)
+      {  int value = atoi(cpos);
+
+	 switch(n++)
+	 {  case 0:  mbytes   = value; break;
+	    case 1:  cb->reps = value; break;
+	    default: 
+	       if(n == 3) n_roots = 0;
+	       if(n_roots < BENCH_MAX_ROOTS)
+		  roots[n_roots++] = value;
+	       break;
+	 }
+
+	 cpos = strchr(cpos, ',');
+	 if(cpos) cpos++;
+      }
+   }
+
+   if(mbytes < 1) mbytes = 1;
+   if(cb->reps < 1) cb->reps = 1;
+   for(r=0; r<n_roots; r++)
+      if(roots[r] < 2 || roots[r] > 170)
+	 Stop("--bench-codec: number of roots must be in the range 2...170\n");
+
+   /*** Prepare random test data */
+
+   cb->size    = (gint64)mbytes*1024*1024;
+   cb->data    = g_malloc(cb->size);
+   cb->seconds = g_malloc(cb->reps*sizeof(double));
+   cb->timer   = g_timer_new();
+
+   words = (guint32*)cb->data;
+   for(i=0; i<cb->size/4; i++)
+      words[i] = Random32();
+
+   g_printf("{\n  \"benchmark\": \"codec\",\n  \"version\": \"%s\",\n"
+	    "  \"mbytes\": %d,\n  \"repetitions\": %d,\n"
+	    "  \"sse2\": %s,\n  \"altivec\": %s,\n  \"results\": [",
+	    Closure->cookedVersion, mbytes, cb->reps,
+	    have_sse2 ? "true" : "false", have_altivec ? "true" : "false");
+
+   /*** Encoders for each available backend */
+
+   for(r=0; r<n_roots; r++)
+   {  Closure->useSSE2 = Closure->useAltiVec = FALSE;
+      bench_encoder(cb, "portable", roots[r]);
+
+      if(have_sse2)
+      {  Closure->useSSE2 = TRUE;
+	 bench_encoder(cb, "sse2", roots[r]);
+	 Closure->useSSE2 = FALSE;
+      }
+
+      if(have_altivec)
+      {  Closure->useAltiVec = TRUE;
+	 bench_encoder(cb, "altivec", roots[r]);
+	 Closure->useAltiVec = FALSE;
+      }
+   }
+
+   Closure->useSSE2    = have_sse2;
+   Closure->useAltiVec = have_altivec;
+
+   /*** Decoder parts */
+
+   for(r=0; r<n_roots; r++)
+      bench_syndromes(cb, roots[r]);
+
+   bench_lec_erasures(cb);
+
+   /*** Checksums and sector scanning */
+
+   bench_checksums(cb);
+
+   Closure->useSSE2 = FALSE;
+   bench_md5_multi(cb, "portable");
+   Closure->useSSE2 = have_sse2;
+   if(have_sse2)
+      bench_md5_multi(cb, "sse2");
+
+   bench_missing_sectors(cb);
+
+   g_printf("\n  ]\n}\n");
+
+   g_timer_destroy(cb->timer);
+   g_free(cb->seconds);
+   g_free(cb->data);
+   g_free(cb);
+}
+
+/*
+ * End-to-end codec benchmark on synthetic images.
+ * arg is "sectors[,methods[,redundancy[,threads[,damage[,report]]]]]"
+ * where methods ("RS01:RS02:RS03") and threads ("1:2:4") may be lists.
+ * For each method and thread count a random image of the given size
+ * is created under the -i name (put it on a tmpfs to leave the disk out),
+ * then ecc data is created, verified, damage% of the roots per ecc block
+ * are erased and the image is repaired. Wall and CPU time, throughput
+ * and peak RSS (Linux only) of each phase are written as JSON
+ * to the report file or to stdout.
+ */
+
+#define BENCH_PHASES 5
+
+static char *bench_phase_names[BENCH_PHASES] = { "generate", "create", "verify", "damage", "fix" };
+
+typedef struct
+{  char method[5];
+   int threads;
+   int nroots;
+   int repaired;                       /* image md5sum matches after fix */
+   double wall[BENCH_PHASES];
+   double cpu[BENCH_PHASES];
+   long peakRSS[BENCH_PHASES];         /* in KB, -1 if unknown */
+} bench_run;
+
+static double cpu_time(void)
+{
+#ifndef SYS_MINGW
+   struct rusage ru;
+
+   getrusage(RUSAGE_SELF, &ru);
+   return   ru.ru_utime.tv_sec + ru.ru_utime.tv_usec/1000000.0
+          + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec/1000000.0;
+#else
+   return 0.0;
+#endif
+}
+
+/*
+ * Peak RSS of a single phase.
+ * getrusage() only knows the peak of the whole process, so each phase
+ * after the largest one would just repeat it. Linux lets us reset
+ * the high water mark (VmHWM) to the current RSS instead.
+ * Elsewhere the peak is reported as unknown.
+ */
+
+static int reset_peak_rss(void)
+{
+#ifdef SYS_LINUX
+   FILE *file = fopen("/proc/self/clear_refs", "w");
+   int ok;
+
+   if(!file) return FALSE;
+   ok = fputs("5", file) >= 0;
+   if(fclose(file)) ok = FALSE;
+
+   return ok;
+#else
+   return FALSE;
+#endif
+}
+
+static long read_peak_rss(void)
+{  long kb = -1;
+#ifdef SYS_LINUX
+   FILE *file = fopen("/proc/self/status", "r");
+   char line[256];
+
+   if(!file) return -1;
+
+   while(fgets(line, 256, file))
+      if(!strncmp(line, "VmHWM:", 6))
+      {  kb = atol(line+6);
+	 break;
+      }
+
+   fclose(file);
+#endif
+   return kb;
+}
+
+static void start_phase(bench_run *br, int phase, GTimer *timer, double *cpu)
+{
+   br->peakRSS[phase] = reset_peak_rss() ? 0 : -1;
+   *cpu = cpu_time();
+   g_timer_start(timer);
+}
+
+static void end_phase(bench_run *br, int phase, GTimer *timer, double cpu_start)
+{
+   br->wall[phase] = g_timer_elapsed(timer, NULL);
+   br->cpu[phase]  = cpu_time() - cpu_start;
+   if(!br->peakRSS[phase])
+      br->peakRSS[phase] = read_peak_rss();
+}
+
+static void image_md5(char *path, guint8 *digest)
+{  struct MD5Context ctxt;
+   LargeFile *file;
+   unsigned char *buf = g_malloc(1024*1024);
+   int n;
+
+   if(!(file = LargeOpen(path, O_RDONLY, IMG_PERMS)))
+      Stop(_("Can't open %s:\n%s"), path, strerror(errno));
+
+   MD5Init(&ctxt);
+   while((n = LargeRead(file, buf, 1024*1024)) > 0)
+      MD5Update(&ctxt, buf, n);
+   MD5Final(digest, &ctxt);
+
+   LargeClose(file);
+   g_free(buf);
+}
+
+/* Open the image and its ecc data the same way --fix does */
+
+static Image* open_bench_image(int flags, Method **method)
+{  Image *image;
+
+   image = OpenImageFromFile(Closure->imageName, flags, IMG_PERMS);
+   image = OpenEccFileForImage(image, Closure->eccName, O_RDONLY, IMG_PERMS);
+
+   if(image && image->eccFileMethod) *method = image->eccFileMethod;
+   else if(image && image->eccMethod) *method = image->eccMethod;
+   else Stop("--benchmark: no ecc data found for %s", Closure->imageName);
+
+   return image;
+}
+
+static void run_benchmark(bench_run *br, char *n_sectors, int damage)
+{  Method *method = FindMethod(br->method);
+   GTimer *timer = g_timer_new();
+   guint8 good_md5[16], fixed_md5[16];
+   char error_arg[40];
+   double cpu;
+   Image *image;
+   EccHeader *eh;
+
+   if(!method)
+      Stop(_("\nMethod %s not available.\n"
+	     "Use -m without parameters for a method list.\n"), br->method);
+
+   Closure->codecThreads = br->threads;
+   g_free(Closure->methodName);
+   Closure->methodName = g_strdup(br->method);
+
+   ClearCrcCache();
+   LargeUnlink(Closure->eccName);
+
+   /*** Random image */
+
+   start_phase(br, 0, timer, &cpu);
+   RandomImage(Closure->imageName, n_sectors, FALSE);
+   end_phase(br, 0, timer, cpu);
+
+   /*** Create the ecc data */
+
+   start_phase(br, 1, timer, &cpu);
+   method->create();
+   end_phase(br, 1, timer, cpu);
+
+   image_md5(Closure->imageName, good_md5);
+
+   /*** Verify it */
+
+   image = open_bench_image(O_RDONLY, &method);
+   eh = image->eccFileHeader ? image->eccFileHeader : image->eccHeader;
+   br->nroots = eh->eccBytes;
+
+   start_phase(br, 2, timer, &cpu);
+   method->verify(image);
+   end_phase(br, 2, timer, cpu);
+
+   /*** Erase damage% of the roots in each ecc block */
+
+   if(!strncmp(br->method, "RS01", 4))
+        g_snprintf(error_arg, 40, "%d,%d", br->nroots, MAX(1, (br->nroots*damage)/100));
+   else g_snprintf(error_arg, 40, "%d", MAX(1, (br->nroots*damage)/100));
+
+   start_phase(br, 3, timer, &cpu);
+   RandomError(error_arg);
+   end_phase(br, 3, timer, cpu);
+
+   /*** Repair the image */
+
+   image = open_bench_image(O_RDWR, &method);
+
+   start_phase(br, 4, timer, &cpu);
+   method->fix(image);
+   end_phase(br, 4, timer, cpu);
+
+   image_md5(Closure->imageName, fixed_md5);
+   br->repaired = !memcmp(good_md5, fixed_md5, 16);
+
+   g_timer_destroy(timer);
+}
+
+static void write_benchmark_report(FILE *file, bench_run *runs, int n_runs, 
+				   gint64 sectors, int damage)
+{  double mbytes = (2048.0*sectors)/(1024.0*1024.0);
+   int i,p;
+
+   g_fprintf(file, "{\n  \"benchmark\": \"end-to-end\",\n  \"version\": \"%s\",\n"
+	     "  \"image\": \"%s\",\n  \"sectors\": %lld,\n  \"redundancy\": \"%s\",\n"
+	     "  \"damage_percent\": %d,\n  \"runs\": [",
+	     Closure->cookedVersion, Closure->imageName, (long long int)sectors,
+	     Closure->redundancy ? Closure->redundancy : "", damage);
+
+   for(i=0; i<n_runs; i++)
+   {  bench_run *br = &runs[i];
+
+      g_fprintf(file, "%s\n    {\"method\": \"%s\", \"threads\": %d, \"nroots\": %d, "
+		"\"repaired\": %s, \"phases\": [",
+		i ? "," : "", br->method, br->threads, br->nroots,
+		br->repaired ? "true" : "false");
+
+      for(p=0; p<BENCH_PHASES; p++)
+	 g_fprintf(file, "%s\n      {\"phase\": \"%s\", \"wall_s\": %.3f, \"cpu_s\": %.3f, "
+		   "\"mb_s\": %.1f, \"peak_rss_kb\": %ld}",
+		   p ? "," : "", bench_phase_names[p], br->wall[p], br->cpu[p],
+		   br->wall[p] > 0.0 ? mbytes/br->wall[p] : 0.0, br->peakRSS[p]);
+
+      g_fprintf(file, "\n    ]}");
+   }
+
+   g_fprintf(file, "\n  ]\n}\n");
+}
+
+void Benchmark(char *arg)
+{  char *fields[6] = { "50000", "RS01:RS02:RS03", NULL, "1", "50", NULL };
+   char **methods, **threads;
+   char *args = g_strdup(arg ? arg : "");
+   char *cpos = args;
+   bench_run *runs;
+   int n_methods, n_threads, n_runs = 0;
+   int damage;
+   int i,j;
+   FILE *report;
+
+   /*** Split up the arguments; empty fields keep their defaults */
+
+   for(i=0; i<6 && cpos && *cpos; i++)
+   {  char *next = strchr(cpos, ',');
+
+      if(next) *next++ = 0;
+      if(*cpos) fields[i] = cpos;
+      cpos = next;
+   }
+
+   if(fields[2])
+   {  g_free(Closure->redundancy);
+      Closure->redundancy = g_strdup(fields[2]);
+   }
+
+   damage = atoi(fields[4]);
+   if(damage < 1 || damage > 100)
+      Stop("--benchmark: damage must be 1..100 percent of the roots\n");
+
+   methods = g_strsplit(fields[1], ":", 0);
+   threads = g_strsplit(fields[3], ":", 0);
+   for(n_methods=0; methods[n_methods]; n_methods++)
+     ;
+   for(n_threads=0; threads[n_threads]; n_threads++)
+   {  int n = atoi(threads[n_threads]);
+
+      if(n < 1 || n > MAX_CODEC_THREADS)
+	 Stop(_("--threads must be 1..%d\n"), MAX_CODEC_THREADS);
+   }
+
+   /*** Run all combinations */
+
+   runs = g_malloc0(n_methods*n_threads*sizeof(bench_run));
+
+   for(i=0; i<n_methods; i++)
+      for(j=0; j<n_threads; j++)
+      {  bench_run *br = &runs[n_runs++];
+
+	 strncpy(br->method, methods[i], 4);
+	 br->threads = atoi(threads[j]);
+
+	 PrintLog("\n*** Benchmark: %s, %d thread(s)\n", br->method, br->threads);
+	 run_benchmark(br, fields[0], damage);
+      }
+
+   /*** Report the results */
+
+   if(fields[5])
+   {  if(!(report = portable_fopen(fields[5], "w")))
+	 Stop(_("Could not open %s: %s"), fields[5], strerror(errno));
+      write_benchmark_report(report, runs, n_runs, atoll(fields[0]), damage);
+      fclose(report);
+      PrintLog("\nBenchmark report written to %s.\n", fields[5]);
+   }
+   else 
+   {  g_printf("\n");
+      write_benchmark_report(stdout, runs, n_runs, atoll(fields[0]), damage);
+   }
+
+   g_strfreev(methods);
+   g_strfreev(threads);
+   g_free(runs);
+   g_free(args);
+}
+
 /**
  ** Debugging functions to show contents of a given sector
  **/
@@ -134,6 +134,35 @@ static char *get_volume_label(unsigned char *buf)
    return NULL;
 }
 
+/***
+ *** Fast rejection of sectors which can not be missing sector markers
+ ***
+ * Nearly all sectors we look at contain real data.
+ * Comparing their first 16 bytes against the marker prefix
+ * in two 64bit words weeds them out before any string parsing
+ * takes place.
+ */
+
+typedef struct
+{  guint64 w[2];
+} marker_prefix;
+
+static void get_marker_prefix(marker_prefix *mp)
+{  
+   if(Closure->fillUnreadable >= 0)
+   {  memset(mp->w, Closure->fillUnreadable, 16);
+   }
+   else memcpy(mp->w, "dvdisaster dead ", 16);
+}
+
+static inline int is_marker_candidate(unsigned char *buf, marker_prefix *mp)
+{  guint64 w[2];
+
+   memcpy(w, buf, 16);   /* buffer might not be aligned */
+
+   return !((w[0] ^ mp->w[0]) | (w[1] ^ mp->w[1]));
+}
+
 /***
  *** Check whether this is a missing sector
  ***/
@@ -141,14 +170,16 @@ static char *get_volume_label(unsigned char *buf)
 int CheckForMissingSector(unsigned char *buf, guint64 sector, 
 			  unsigned char *fingerprint, guint64 fingerprint_sector)
 {  static char pattern[2048];
-   static char last_pattern = 0;
+   static int last_pattern = -1;     /* not yet set */
    guint64 recorded_number;
 
    /* Bytefill used as missing sector marker? */
    
    if(Closure->fillUnreadable >= 0)
    {  if(Closure->fillUnreadable != last_pattern)  /* cache the pattern */
-	 memset(pattern, Closure->fillUnreadable, 2048);
+      {  memset(pattern, Closure->fillUnreadable, 2048);
+	 last_pattern = Closure->fillUnreadable;
+      }
 
       if(memcmp(buf, pattern, 2048)) 
 	   return SECTOR_PRESENT;
@@ -198,21 +229,30 @@ int CheckForMissingSector(unsigned char *buf, guint64 sector,
    return SECTOR_MISSING;
 }
 
+/*
+ * Check a run of consecutive sectors.
+ * Only sectors passing the prefix test are handed over to the 
+ * full CheckForMissingSector() parser.
+ */
+
 int CheckForMissingSectors(unsigned char *buf, guint64 sector, 
 			   unsigned char *fingerprint, guint64 fingerprint_sector,
 			   int n_sectors, guint64 *first_defect)
-{  int i,result;
+{  marker_prefix mp;
+   int i,result;
+
+   get_marker_prefix(&mp);
 
-   for(i=0; i<n_sectors; i++)
-   {  result = CheckForMissingSector(buf, sector, fingerprint, fingerprint_sector);
+   for(i=0; i<n_sectors; i++, buf+=2048)
+   {  if(!is_marker_candidate(buf, &mp))
+	 continue;
+
+      result = CheckForMissingSector(buf, sector+i, fingerprint, fingerprint_sector);
 
       if(result != SECTOR_PRESENT)
-      {  *first_defect = sector;
+      {  *first_defect = sector+i;
 	 return result;
       }
-
-      buf += 2048;
-      sector++;
    }
 
    return SECTOR_PRESENT;
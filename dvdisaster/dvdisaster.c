@@ -41,7 +41,13 @@ typedef enum
    MODE_READ, 
    MODE_SCAN,
    MODE_SEQUENCE, 
+   MODE_RAW_RECOVER,
 
+   MODE_BENCH_DS_MARKER,
+   MODE_BENCH_CODEC,
+   MODE_BENCHMARK,
+   MODE_BENCH_PQ,
+   MODE_BENCH_RAW,
    MODE_BYTESET, 
    MODE_COPY_SECTOR,
    MODE_CMP_IMAGES,
@@ -59,7 +65,7 @@ typedef enum
    MODE_TRUNCATE,
    MODE_ZERO_UNREADABLE,
 
-   MODIFIER_ADAPTIVE_READ, 
+   MODIFIER_ADAPTIVE_READ = 256,  /* keep clear of the short option characters and '?' */
    MODIFIER_AUTO_SUFFIX,
    MODIFIER_CACHE_SIZE, 
    MODIFIER_CLV_SPEED,    /* unused */ 
@@ -74,17 +80,23 @@ typedef enum
    MODIFIER_IGNORE_FATAL_SENSE,
    MODIFIER_IGNORE_ISO_SIZE,
    MODIFIER_INTERNAL_REREADS,
+   MODIFIER_NO_SECTOR_MAP,
    MODIFIER_OLD_DS_MARKER,
    MODIFIER_PREFETCH_SECTORS,
    MODIFIER_RANDOM_SEED,
    MODIFIER_READ_ATTEMPTS,
    MODIFIER_READ_MEDIUM,
+   MODIFIER_READ_PROFILE,
    MODIFIER_READ_RAW,
    MODIFIER_RAW_MODE,
    MODIFIER_SCREEN_SHOT,
    MODIFIER_SIMULATE_DEFECTS,
    MODIFIER_SPEED_WARNING, 
    MODIFIER_SPINUP_DELAY, 
+   MODIFIER_STATS,
+   MODIFIER_STATS_INTERVAL,
+   MODIFIER_STREAM_SIZE,
+   MODIFIER_TRACE,
    MODIFIER_TRUNCATE,
    MODIFIER_VERSION,
 } run_mode;
@@ -244,6 +256,11 @@ int main(int argc, char *argv[])
       { {"adaptive-read", 0, 0, MODIFIER_ADAPTIVE_READ},
 	{"auto-suffix", 0, 0,  MODIFIER_AUTO_SUFFIX},
 	{"assume", 1, 0, 'a'},
+	{"bench-ds-marker", 2, 0, MODE_BENCH_DS_MARKER },
+	{"bench-codec", 2, 0, MODE_BENCH_CODEC },
+	{"bench-pq", 2, 0, MODE_BENCH_PQ },
+	{"bench-raw", 2, 0, MODE_BENCH_RAW },
+	{"benchmark", 2, 0, MODE_BENCHMARK },
 	{"byteset", 1, 0, MODE_BYTESET },
 	{"copy-sector", 1, 0, MODE_COPY_SECTOR },
 	{"compare-images", 1, 0, MODE_CMP_IMAGES },
@@ -276,6 +293,7 @@ int main(int argc, char *argv[])
 	{"marked-image", 1, 0, MODE_MARKED_IMAGE },
 	{"merge-images", 1, 0, MODE_MERGE_IMAGES },
 	{"method", 2, 0, 'm' },
+	{"no-sector-map", 0, 0, MODIFIER_NO_SECTOR_MAP },
 	{"old-ds-marker", 0, 0, MODIFIER_OLD_DS_MARKER },
 	{"prefetch-sectors", 1, 0, MODIFIER_PREFETCH_SECTORS },
         {"prefix", 1, 0, 'p'},
@@ -283,10 +301,12 @@ int main(int argc, char *argv[])
 	{"random-image", 1, 0, MODE_RANDOM_IMAGE },
 	{"random-seed", 1, 0, MODIFIER_RANDOM_SEED },
 	{"raw-mode", 1, 0, MODIFIER_RAW_MODE },
+	{"raw-recover", 2, 0, MODE_RAW_RECOVER },
 	{"raw-sector", 1, 0, MODE_RAW_SECTOR},
 	{"read", 2, 0,'r'},
 	{"read-attempts", 1, 0, MODIFIER_READ_ATTEMPTS },
 	{"read-medium", 1, 0, MODIFIER_READ_MEDIUM },
+	{"read-profile", 1, 0, MODIFIER_READ_PROFILE },
 	{"read-sector", 1, 0, MODE_READ_SECTOR},
 	{"read-raw", 0, 0, MODIFIER_READ_RAW},
 	{"redundancy", 1, 0, 'n'},
@@ -298,8 +318,12 @@ int main(int argc, char *argv[])
 	{"sim-defects", 1, 0, MODIFIER_SIMULATE_DEFECTS},
 	{"speed-warning", 2, 0, MODIFIER_SPEED_WARNING},
 	{"spinup-delay", 1, 0, MODIFIER_SPINUP_DELAY},
+	{"stats", 2, 0, MODIFIER_STATS},
+	{"stats-interval", 1, 0, MODIFIER_STATS_INTERVAL},
+	{"stream-size", 1, 0, MODIFIER_STREAM_SIZE},
 	{"test", 2, 0, 't'},
         {"threads", 1, 0, 'x'},
+	{"trace", 1, 0, MODIFIER_TRACE},
 	{"truncate", 2, 0, MODIFIER_TRUNCATE},
 	{"unlink", 0, 0, 'u'},
        	{"verbose", 0, 0, 'v'},
@@ -477,6 +501,9 @@ int main(int argc, char *argv[])
 	    }
 	 }
 	   break;
+	 case MODIFIER_NO_SECTOR_MAP:
+	    Closure->sectorMap = FALSE;
+	    break;
 	 case MODIFIER_OLD_DS_MARKER:
 	    Closure->dsmVersion = 0;
 	    break;
@@ -520,6 +547,10 @@ int main(int argc, char *argv[])
          case MODIFIER_READ_MEDIUM:
 	   Closure->readingPasses = atoi(optarg);
 	   break;
+         case MODIFIER_READ_PROFILE:
+	   if(Closure->readProfile) g_free(Closure->readProfile);
+	   Closure->readProfile = g_strdup(optarg);
+	   break;
          case MODIFIER_READ_RAW:
 	   Closure->readRaw = TRUE;
 	   break;
@@ -533,6 +564,30 @@ int main(int argc, char *argv[])
          case MODIFIER_SPINUP_DELAY:
 	   if(optarg) Closure->spinupDelay = atoi(optarg);
 	   break;
+         case MODIFIER_STATS:
+	   Closure->stats = TRUE;
+	   if(optarg)
+	   {  if(Closure->statsFile) g_free(Closure->statsFile);
+	      Closure->statsFile = g_strdup(optarg);
+	   }
+	   break;
+         case MODIFIER_STATS_INTERVAL:
+	   Closure->statsInterval = atoi(optarg);
+	   if(Closure->statsInterval < 0) Closure->statsInterval = 0;
+	   break;
+         case MODIFIER_STREAM_SIZE:
+	 {  char *end;
+
+	    Closure->streamSize = strtoll(optarg, &end, 10);
+	    if(*end == 's') Closure->streamSize *= 2048;
+	    if(Closure->streamSize <= 0)
+	      Stop(_("--stream-size must be a positive number of bytes (or sectors with suffix s)."));
+	    break;
+	 }
+         case MODIFIER_TRACE:
+	   if(Closure->traceFile) g_free(Closure->traceFile);
+	   Closure->traceFile = g_strdup(optarg);
+	   break;
          case MODIFIER_SPEED_WARNING:
 	   if(optarg) Closure->speedWarning = atoi(optarg);
 	   else Closure->speedWarning=10;
@@ -548,6 +603,26 @@ int main(int argc, char *argv[])
 	    FreeClosure();
 	    exit(EXIT_SUCCESS); 
 	    break;
+         case MODE_BENCH_DS_MARKER:
+	   mode = MODE_BENCH_DS_MARKER;
+	   if(optarg) debug_arg = g_strdup(optarg);
+	   break;
+         case MODE_BENCH_CODEC:
+	   mode = MODE_BENCH_CODEC;
+	   if(optarg) debug_arg = g_strdup(optarg);
+	   break;
+         case MODE_BENCHMARK:
+	   mode = MODE_BENCHMARK;
+	   if(optarg) debug_arg = g_strdup(optarg);
+	   break;
+         case MODE_BENCH_PQ:
+	   mode = MODE_BENCH_PQ;
+	   if(optarg) debug_arg = g_strdup(optarg);
+	   break;
+         case MODE_BENCH_RAW:
+	   mode = MODE_BENCH_RAW;
+	   if(optarg) debug_arg = g_strdup(optarg);
+	   break;
          case MODE_BYTESET:
 	   mode = MODE_BYTESET;
 	   debug_arg = g_strdup(optarg);
@@ -584,6 +659,10 @@ int main(int argc, char *argv[])
 	   mode = MODE_RANDOM_IMAGE;
 	   debug_arg = g_strdup(optarg);
 	   break;
+         case MODE_RAW_RECOVER:
+	   mode = MODE_RAW_RECOVER;
+	   if(optarg) debug_arg = g_strdup(optarg);
+	   break;
          case MODE_RAW_SECTOR:
 	   mode = MODE_RAW_SECTOR;
 	   debug_arg = g_strdup(optarg);
@@ -615,7 +694,12 @@ int main(int argc, char *argv[])
    
    if(!Closure->debugMode)
      switch(mode)
-     {  case MODE_BYTESET:
+     {  case MODE_BENCH_CODEC:
+        case MODE_BENCH_DS_MARKER:
+        case MODE_BENCHMARK:
+        case MODE_BENCH_PQ:
+        case MODE_BENCH_RAW:
+        case MODE_BYTESET:
 	case MODE_COPY_SECTOR:
 	case MODE_CMP_IMAGES:
         case MODE_ERASE:
@@ -704,17 +788,24 @@ int main(int argc, char *argv[])
    mode = MODE_NONE;
 #endif
 
+   StartTrace();
+
    switch(mode)
    {  case MODE_SEQUENCE:
 	if(sequence & 1<<MODE_SCAN)
-	  ReadMediumLinear((gpointer)1);
+	{  StartStats("scan");
+	   ReadMediumLinear((gpointer)1);
+	   StopStats();
+	}
 
 	if(sequence & 1<<MODE_READ)
 	{  if(sequence & 1<<MODE_CREATE) 
 	      Closure->readAndCreate = TRUE;
+	   StartStats("read");
 	   if(Closure->adaptiveRead) 
 	        ReadMediumAdaptive((gpointer)0);
 	   else ReadMediumLinear((gpointer)0);
+	   StopStats();
 	}
 
 	if(sequence & 1<<MODE_CREATE)
@@ -724,7 +815,12 @@ int main(int argc, char *argv[])
 			      "Use -m without parameters for a method list.\n"), 
 			    Closure->methodName);
 
+	   if(!strcmp(Closure->imageName, "-") && strncmp(method->name, "RS01", 4))
+	     Stop(_("Reading the image from standard input is only supported by method RS01.\n"));
+
+	   StartStats("create");
 	   method->create();
+	   StopStats();
 	}
 
 	if(sequence & 1<<MODE_FIX)
@@ -751,7 +847,9 @@ int main(int argc, char *argv[])
 	   else if(image && image->eccMethod) method = image->eccMethod;
 	   else Stop("Internal error: No suitable method for repairing image.");
 
+	   StartStats("fix");
 	   method->fix(image);
+	   StopStats();
 	}
 
 	if(sequence & 1<<MODE_VERIFY)
@@ -768,10 +866,32 @@ int main(int argc, char *argv[])
 	   else if(!(method = FindMethod("RS01")))
 	           Stop(_("RS01 method not available for comparing files."));
 	     
+	   StartStats("verify");
 	   method->verify(image);
+	   StopStats();
 	}
 	break;
 
+      case MODE_BENCH_CODEC:
+         BenchCodec(debug_arg);
+	 break;
+
+      case MODE_BENCHMARK:
+         Benchmark(debug_arg);
+	 break;
+
+      case MODE_BENCH_DS_MARKER:
+         BenchMissingSectors(debug_arg);
+	 break;
+
+      case MODE_BENCH_PQ:
+         BenchPQDecode(debug_arg);
+	 break;
+
+      case MODE_BENCH_RAW:
+         BenchRawRecovery(debug_arg);
+	 break;
+
       case MODE_BYTESET:
          Byteset(debug_arg);
 	 break;
@@ -797,6 +917,10 @@ int main(int argc, char *argv[])
 	 SendCDB(debug_arg);
 	 break;
 
+      case MODE_RAW_RECOVER:
+	 RawRecoverImage(debug_arg);
+	 break;
+
       case MODE_RAW_SECTOR:
          if(!Closure->device) Closure->device = DefaultDevice();
 	 RawSector(debug_arg);
@@ -845,6 +969,8 @@ int main(int argc, char *argv[])
 	break;
    }
 
+   StopTrace();
+
    if(debug_arg) g_free(debug_arg);
 
    /*** If no mode was selected, print the help screen. */
@@ -897,19 +1023,36 @@ int main(int argc, char *argv[])
       PrintCLI(_("  --ignore-fatal-sense   - continue reading after potentially fatal error conditon\n"));
       PrintCLI(_("  --ignore-iso-size      - ignore image size from ISO/UDF data (dangerous - see man page!)\n"));
       PrintCLI(_("  --internal-rereads n   - drive may attempt n rereads before reporting an error\n"));
+      PrintCLI(_("  --no-sector-map        - do not keep a map of read sectors next to the image\n"));
       PrintCLI(_("  --old-ds-marker        - mark missing sectors compatible with dvdisaster <= 0.70\n"));
       PrintCLI(_("  --prefetch-sectors n   - prefetch n sectors for RS03 encoding (uses ~nMB)\n"));
       PrintCLI(_("  --raw-mode n           - mode for raw reading CD media (20 or 21)\n"));
+      PrintCLI(_("  --raw-recover [s]      - recover sectors from the --defective-dump cache into the image,\n"
+		 "                           spending at most s seconds per sector (default: 120)\n"));
       PrintCLI(_("  --read-attempts n-m    - attempts n upto m reads of a defective sector\n"));
       PrintCLI(_("  --read-medium n        - read the whole medium up to n times\n"));
+      PrintCLI(_("  --read-profile file    - save read latencies and zone speeds as JSON (or CSV if file ends in .csv)\n"));
       PrintCLI(_("  --read-raw             - performs read in raw mode if possible\n"));
       PrintCLI(_("  --speed-warning n      - print warning if speed changes by more than n percent\n"));
       PrintCLI(_("  --spinup-delay n       - wait n seconds for drive to spin up\n"));
+      PrintCLI(_("  --stats [file]         - report time spent in each stage as JSON (to the log or appended to file)\n"));
+      PrintCLI(_("  --stats-interval n     - print the statistics every n seconds\n"));
+      PrintCLI(_("  --stream-size n[s]     - size of the image read from standard input with -i - (RS01 only),\n"
+		 "                           in bytes or in 2048 byte sectors when followed by s\n"));
+      PrintCLI(_("  --trace file           - write a time line of the I/O and encoder threads\n"
+		 "                           in Chrome trace format (chrome://tracing, Perfetto)\n"));
 
       if(Closure->debugMode)
       { PrintCLI("\n");
 	PrintCLI(_("Debugging options (purposefully undocumented and possibly harmful)\n"));
 	PrintCLI(_("  --debug           - enables the following options\n"));
+	PrintCLI(_("  --bench-codec [m,r,n...] - benchmark codec kernels r times over m MB for n roots (JSON)\n"));
+	PrintCLI(_("  --bench-ds-marker [n] - benchmark dead sector marker scan over n sectors (max. 32768)\n"));
+	PrintCLI(_("  --bench-pq [n]    - benchmark L-EC P/Q vector decoding over n frames\n"));
+	PrintCLI(_("  --bench-raw [n,r,b,l,c,s...] - benchmark raw sector recovery strategies s over n frames\n"
+		   "                      with r rereads, b bursts of up to l bytes and c%% C2 coverage\n"));
+	PrintCLI(_("  --benchmark [s,m,r,t,d,f] - create/verify/damage/fix s sector image with methods m,\n"
+		   "                      redundancy r, threads t and d%% of roots erased; JSON to f\n"));
 	PrintCLI(_("  --byteset s,i,b   - set byte i in sector s to b\n"));
 	PrintCLI(_("  --cdump           - creates C #include file dumps instead of hexdumps\n")); 
 	PrintCLI(_("  --compare-images a,b  - compare sectors in images a and b\n"));
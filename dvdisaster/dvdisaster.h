@@ -136,6 +136,7 @@ typedef struct _GlobalClosure
    GPtrArray *deviceNodes;  /* List of device nodes (C: or /dev/foo) */
    char *imageName;     /* complete path of current image file */
    char *eccName;       /* complete path of current ecc file */
+   gint64 streamSize;   /* size of an image read from stdin ("-i -") */
    GPtrArray *methodList; /* List of available methods */
    char *methodName;    /* Name of currently selected codec */
    gint64 readStart;    /* Range to read */
@@ -155,12 +156,14 @@ typedef struct _GlobalClosure
    int prefetchSectors; /* Prefetch setting per encoder thread */
    int codecThreads;    /* Number of threads to use for RS encoders */
    int sectorSkip;      /* Number of sectors to skip after read error occurs */
+   int sectorMap;       /* Keep a persistent map of present sectors next to the image */
    char *redundancy;    /* Error correction code redundancy */
    int eccTarget;       /* 0=file; 1=augmented image */
    int readRaw;         /* Read CD sectors raw + verify them */
    int rawMode;         /* mode for mode page */
    int minReadAttempts; /* minimum reading attempts */
    int maxReadAttempts; /* maximal reading attempts */
+   int rawSampleMB;     /* memory limit for raw samples of one sector, in megabytes */
    int internalAttempts;/* read attempts by the drive itself */
    int adaptiveRead;    /* Use optimized strategy for reading defective images */
    int speedWarning;    /* Print warning if speed changes by more than given percentage */
@@ -189,6 +192,11 @@ typedef struct _GlobalClosure
    int defectiveDump;   /* dump non-recoverable sectors into given path */
    char *dDumpDir;      /* directory for above */
    char *dDumpPrefix;   /* file name prefix for above */
+   char *readProfile;   /* export read latency/speed profile to this file */
+   int stats;           /* report run time statistics of the actions */
+   char *statsFile;     /* write them to this file instead of the log */
+   int statsInterval;   /* print statistics every n seconds */
+   char *traceFile;     /* write a Chrome trace of the hot paths to this file */
    int reverseCancelOK; /* if TRUE the button order is reversed */
    int eject;           /* eject medium on success */
    int readingPasses;   /* try to read medium n times */
@@ -338,6 +346,14 @@ typedef struct _LargeFile
    guint64 size;
 } LargeFile;
 
+typedef struct _LargeFileStamp     /* tells whether a file has changed */
+{  guint64 size;
+   guint64 device;
+   guint64 inode;
+   gint64 mtime, mtimeNsec;
+   gint64 ctime, ctimeNsec;
+} LargeFileStamp;
+
 /***
  *** An info package about a medium image 
  *** (NOT part or a header of the image file!)
@@ -452,17 +468,23 @@ struct _DeviceHandle *dh_forward;
  ***/
 
 typedef struct _Bitmap
-{  guint32 *bitmap;
-   gint32 size;
-   gint32 words;
+{  guint64 *bitmap;
+   gint64 size;
+   gint64 words;
 } Bitmap;
 
-Bitmap* CreateBitmap0(int);
-#define GetBit(bm,bit) (bm->bitmap[(bit)>>5] & (1<<((bit)&31))) 
-#define SetBit(bm,bit) bm->bitmap[(bit)>>5] |= (1<<((bit)&31)) 
-#define ClearBit(bm,bit) bm->bitmap[(bit)>>5] &= ~(1<<((bit)&31)) 
-int CountBits(Bitmap*);
+Bitmap* CreateBitmap0(gint64);
+#define GetBit(bm,bit) (bm->bitmap[(bit)>>6] & ((guint64)1<<((bit)&63))) 
+#define SetBit(bm,bit) bm->bitmap[(bit)>>6] |= ((guint64)1<<((bit)&63)) 
+#define ClearBit(bm,bit) bm->bitmap[(bit)>>6] &= ~((guint64)1<<((bit)&63)) 
+void ClearBitRange(Bitmap*, gint64, gint64);
+gint64 CountBits(Bitmap*);
+gint64 FindNextClearBit(Bitmap*, gint64);
+gint64 FindNextSetBit(Bitmap*, gint64);
+gint64 FindSetBitInRange(Bitmap*, gint64, gint64);
 void FreeBitmap(Bitmap*);
+guint64 GetBitWord(Bitmap*, gint64);
+void SetBitRange(Bitmap*, gint64, gint64);
 
 /***
  *** build.h
@@ -519,6 +541,7 @@ CrcBuf *GetCRCFromRS02_obsolete(void*, void*, LargeFile*);
 void FreeCrcBuf(CrcBuf*);
 
 int CheckAgainstCrcBuffer(CrcBuf*, gint64, unsigned char*);
+int CheckCrcAgainstCrcBuffer(CrcBuf*, gint64, guint32);
 
 /***
  *** curve.c
@@ -570,6 +593,11 @@ void RedrawCurve(Curve*, int);
 
 void HexDump(unsigned char*, int, int);
 void LaTeXify(gint32*, int, int);
+void BenchCodec(char*);
+void Benchmark(char*);
+void BenchMissingSectors(char*);
+void BenchPQDecode(char*);
+void BenchRawRecovery(char*);
 void CopySector(char*);
 void Byteset(char*);
 void Erase(char*);
@@ -643,9 +671,8 @@ void CreateFixWindow(GtkWidget*);
  *** galois.c
  ***
  * This is currently the hardcoded GF(2**8).
- * gint32 gives abundant space for the GF.
- * Squeezing it down to guint8 won't probably gain much,
- * so we implement this defensively here.
+ * The log/antilog tables are kept as guint8 so that
+ * they occupy as few cache lines as possible.
  *
  * Note that some performance critical stuff needs to
  * be #included from galois-inlines.h
@@ -669,9 +696,12 @@ void CreateFixWindow(GtkWidget*);
 
 typedef struct _GaloisTables
 {  gint32 gfGenerator;  /* GF generator polynomial */ 
-   gint32 *indexOf;     /* log */
-   gint32 *alphaTo;     /* inverse log */
-   gint32 *encAlphaTo; /* inverse log optimized for encoder */
+   guint8 *indexOf;     /* log */
+   guint8 *alphaTo;     /* inverse log */
+   guint8 *encAlphaTo;  /* inverse log optimized for encoder */
+
+   guint8 *arena;       /* memory holding the above tables */
+   struct _GaloisTables *next;  /* tables are cached; see galois.c */
 } GaloisTables;
 
 /* Lookup and working tables for the ReedSolomon codecs */
@@ -687,6 +717,9 @@ typedef struct _ReedSolomonTables
 
    guint8 *bLut[GF_FIELDSIZE];   /* 8bit encoder lookup table */
    guint8 *synLut;       /* Syndrome calculation speedup */
+
+   guint8 *arena;        /* memory holding the above tables */
+   struct _ReedSolomonTables *next;  /* tables are cached; see galois.c */
 } ReedSolomonTables;
 
 GaloisTables* CreateGaloisTables(gint32);
@@ -694,6 +727,50 @@ void FreeGaloisTables(GaloisTables*);
 
 ReedSolomonTables *CreateReedSolomonTables(GaloisTables*, gint32, gint32, int);
 void FreeReedSolomonTables(ReedSolomonTables*);
+void FreeGaloisTableCache(void);
+
+/***
+ *** hash-queue.c
+ ***/
+
+typedef void (*HashDoneFunc)(gpointer);
+
+typedef struct _HashQueue
+{  GMutex *lock;
+   GCond *idle;                     /* signaled when no jobs are pending */
+   struct _hash_worker *worker;
+   int nWorkers;
+   int pending;                     /* jobs submitted but not yet finished */
+   int shutdown;
+} HashQueue;
+
+#define HASH_STREAM_BUFS 4
+#define HASH_STREAM_BUFSIZE (256*1024)
+
+typedef struct _HashStreamBuffer
+{  struct _HashStream *stream;
+   unsigned char *buf;
+   int fill;
+   int busy;                        /* queued for hashing */
+} HashStreamBuffer;
+
+typedef struct _HashStream
+{  HashQueue *queue;
+   struct MD5Context *ctxt;
+   GMutex *lock;                    /* protects buffer[].busy */
+   GCond *cond;
+   HashStreamBuffer buffer[HASH_STREAM_BUFS];
+   int current;                     /* buffer being filled */
+} HashStream;
+
+HashQueue* CreateHashQueue(int);
+void FreeHashQueue(HashQueue*);
+void HashQueueSubmit(HashQueue*, struct MD5Context*, unsigned char*, int, gint*, HashDoneFunc, gpointer);
+void HashQueueSync(HashQueue*);
+
+HashStream* OpenHashStream(HashQueue*, struct MD5Context*);
+void HashStreamWrite(HashStream*, unsigned char*, int);
+void CloseHashStream(HashStream*);
 
 /***
  *** help-dialogs.c
@@ -740,10 +817,6 @@ void AboutTextWithLink(GtkWidget*, char*, char*);
  *** heuristic-lec.c
  ***/
 
-void UpdateByteCounts(struct _RawBuffer*);
-void CalculatePQLoad(struct _RawBuffer*);
-void UpdatePQParityList(struct _RawBuffer*, unsigned char*);
-
 int HeuristicLEC(unsigned char*, struct _RawBuffer*, unsigned char*);
 int SearchPlausibleSector(struct _RawBuffer*, int);
 int BruteForceSearchPlausibleSector(struct _RawBuffer*);
@@ -826,6 +899,7 @@ ssize_t LargeWrite(LargeFile*, void*, size_t);
 int LargeClose(LargeFile*);
 int LargeTruncate(LargeFile*, off_t);
 int LargeStat(char*, guint64*);
+int LargeFileStampGet(char*, LargeFileStamp*);
 int LargeUnlink(char*);
 
 int DirStat(char*);
@@ -866,6 +940,33 @@ void OrQVector(unsigned char*, unsigned char, int);
 
 int DecodePQ(ReedSolomonTables*, unsigned char*, int, int*, int);
 
+void PSyndromes(unsigned char*, unsigned char*, unsigned char*);
+void QSyndromes(unsigned char*, unsigned char*, unsigned char*);
+int DecodePVectors(ReedSolomonTables*, unsigned char*, int*, int*, unsigned char*);
+int DecodeQVectors(ReedSolomonTables*, unsigned char*, int*, int*, unsigned char*);
+
+typedef struct _PQState
+{  GaloisTables *gt;
+   unsigned char *frame;              /* the tracked frame */
+   unsigned char pS0[N_P_VECTORS];    /* live syndromes of the P vectors */
+   unsigned char pS1[N_P_VECTORS];
+   unsigned char qS0[N_Q_VECTORS];    /* live syndromes of the Q vectors */
+   unsigned char qS1[N_Q_VECTORS];
+} PQState;
+
+#define PVectorOK(pq,p) (!(pq)->pS0[p] && !(pq)->pS1[p])
+#define QVectorOK(pq,q) (!(pq)->qS0[q] && !(pq)->qS1[q])
+
+void InitPQState(PQState*, GaloisTables*, unsigned char*);
+void PQStateSetByte(PQState*, int, unsigned char);
+void PQStateSetPVector(PQState*, unsigned char*, int);
+void PQStateSetQVector(PQState*, unsigned char*, int);
+void PQStateCopyFrame(PQState*, unsigned char*, int);
+int PQStateDecodePVectors(ReedSolomonTables*, PQState*, int*, int*, unsigned char*);
+int PQStateDecodeQVectors(ReedSolomonTables*, PQState*, int*, int*, unsigned char*);
+int PQStateDecodePVector(ReedSolomonTables*, PQState*, int, unsigned char*, int*);
+int PQStateDecodeQVector(ReedSolomonTables*, PQState*, int, unsigned char*, int*);
+
 int CountC2Errors(unsigned char*);
 
 /***
@@ -1139,6 +1240,12 @@ gint32  Random(void);
 void    SRandom(gint32);
 guint32 Random32(void);
 
+/***
+ *** raw-batch.c
+ ***/
+
+void RawRecoverImage(char*);
+
 /***
  *** raw-editor.c
  ***/
@@ -1165,10 +1272,37 @@ enum                                 /* for ->properties above */
    DSH_XA_MODE         = (1<<1)
 };
 
+typedef struct _RawSectorCache
+{  char *path;                     /* path of the store file */
+   LargeFile *file;
+   unsigned char *base;            /* mapped records or NULL */
+   size_t mapSize;
+   gint64 mappedRecords;           /* number of records covered by the mapping */
+   gint64 nRecords;                /* number of records in the store */
+   struct _RawCacheRecord *record; /* record being added */
+   struct _RawCacheRecord *scratch;/* record read when not mapped */
+   struct _RawCacheEntry *entry;   /* per record index information */
+   gint64 entriesMax;
+   gint32 *lbaTable;               /* LBA -> most recent record */
+   gint32 *contentTable;           /* (LBA, CRC32) -> record */
+   guint32 tableMask;
+   gint32 pass;                    /* counts SaveDefectiveSector() calls */
+   int validFP;                    /* store header carries a fingerprint */
+   guint8 mediumFP[16];
+} RawSectorCache;
+
+void CloseRawSectorCache(RawSectorCache*);
 int SaveDefectiveSector(struct _RawBuffer*, int);
 int TryDefectiveSectorCache(struct _RawBuffer*, unsigned char*);
 void ReadDefectiveSectorFile(DefectiveSectorHeader *, struct _RawBuffer*, char*);
 
+RawSectorCache* OpenRawSectorCache(struct _RawBuffer*);
+gint64* CachedSectorList(RawSectorCache*, int*);
+unsigned char* GetCachedSectors(RawSectorCache*, gint64, int*, int*);
+
+RawSectorCache* OpenRawSectorCacheFile(struct _RawBuffer*, char*);
+void ReadCachedSectors(DefectiveSectorHeader*, struct _RawBuffer*, RawSectorCache*, gint64);
+
 /*** 
  *** read-linear.c
  ***/
@@ -1215,6 +1349,51 @@ void UpdateAdaptiveResults(gint64, gint64, gint64, int);
 void ChangeSegmentColor(GdkColor*, int);
 void RemoveFillMarkers();
 
+/***
+ *** read-profile.c
+ ***/
+
+#define PROFILE_SUB_BUCKETS 16     /* linear sub buckets per power of two */
+#define PROFILE_EXPONENTS   36     /* covers latencies up to 2^40 usecs */
+#define PROFILE_BUCKETS     (PROFILE_SUB_BUCKETS*(PROFILE_EXPONENTS+1))
+#define PROFILE_ZONES       100    /* medium is profiled in 1% steps */
+#define PROFILE_SENSE_CODES 32     /* distinct sense codes recorded */
+
+typedef struct _ProfileZone
+{  gint64 requests;
+   gint64 sectorsRead;
+   gint64 failedSectors;
+   gint64 usecs;
+} ProfileZone;
+
+typedef struct _ProfileSense
+{  int key, asc, ascq;
+   gint64 count;
+} ProfileSense;
+
+typedef struct _ReadProfile
+{  GTimer *timer;                  /* time base for the latency measurements */
+   gint64 sectors;                 /* medium size */
+   gint64 zoneSize;                /* sectors per zone */
+   gint64 requests;                /* ReadSectors() calls */
+   gint64 failedRequests;
+   gint64 attempts;                /* including retries */
+   gint64 sectorsRead;
+   gint64 totalLatency;
+   gint64 minLatency, maxLatency;
+   gint64 histogram[PROFILE_BUCKETS];
+   ProfileZone zones[PROFILE_ZONES];
+   ProfileSense sense[PROFILE_SENSE_CODES];
+   int nSense;
+   gint64 otherSense;              /* sense codes which did not fit above */
+} ReadProfile;
+
+ReadProfile* CreateReadProfile(gint64);
+void ExportReadProfile(ReadProfile*, struct _DeviceHandle*, char*);
+void FreeReadProfile(ReadProfile*);
+void ReadProfileAdd(ReadProfile*, gint64, int, gint64, int, int);
+gint64 ReadProfileTimestamp(ReadProfile*);
+
 /***
  *** recover-raw.c
  ***/
@@ -1236,22 +1415,33 @@ typedef struct _RawBuffer
    int dataOffset;            /* offset to user data in frame */
    int xaMode;                /* frame is in XA21 mode */
    int recommendedAttempts;   /* number of retries recommended by reading heuristics */
+   int threads;               /* threads for the heuristics; 0 means Closure->codecThreads */
+   GTimer *deadlineTimer;     /* if set, the heuristics give up once it passes deadline */
+   double deadline;           /* in seconds on deadlineTimer */
 
    unsigned char *recovered;  /* working buffer for cd frame recovery */
    unsigned char *byteState;  /* state of error correction */
    unsigned char *reference;  /* NULL or the correct sector (for debugging purposes) */
    unsigned char *byteCount;  /* stores how many different bytes were read for each position in a sector */   
+   guint32 *byteSeen;         /* bitset of the byte values read for each position (8 words per position) */
+   int statsSamples;          /* number of samples accounted for in the above statistics */
    gint64 lba;                /* sector number were currently working on */
 
    guint8 mediumFP[16];       /* medium fingerprint for raw sector cache validation */
    int validFP;               /* indicates valid fingerprint */
+   RawSectorCache *cache;     /* defective sector cache; opened on first use */
+
+   unsigned char *sampleSlab; /* memory for rawBuf[] */
+   int sampleAlloc;           /* allocated size of each sample */
+   unsigned char *listSlab;   /* memory for the vectors in pList/qList */
+   unsigned char **listPtrs;  /* memory for the pointer arrays in pList/qList */
 
-   unsigned char *pParity1[N_P_VECTORS];
-   unsigned char *pParity2[N_P_VECTORS];
+   unsigned char pParity1[N_P_VECTORS][256];  /* different P/Q parity bytes seen */
+   unsigned char pParity2[N_P_VECTORS][256];
    int pParityN[N_P_VECTORS][2];
 
-   unsigned char *qParity1[N_Q_VECTORS];
-   unsigned char *qParity2[N_Q_VECTORS];
+   unsigned char qParity1[N_Q_VECTORS][256];
+   unsigned char qParity2[N_Q_VECTORS][256];
    int qParityN[N_Q_VECTORS][2];
 
    int *pLoad,*qLoad;
@@ -1277,6 +1467,7 @@ enum                          /* values for byteState */
 
 RawBuffer* CreateRawBuffer(int);
 void ReallocRawBuffer(RawBuffer*, int);
+void ReserveRawSample(RawBuffer*);
 void ResetRawBuffer(RawBuffer*);
 void FreeRawBuffer(RawBuffer*);
 
@@ -1335,6 +1526,35 @@ void EncodeNextLayer(ReedSolomonTables*, unsigned char*, unsigned char*, guint64
 int ProbeSSE2(void);
 int ProbeAltiVec(void);
 
+/***
+ *** sector-map.c
+ ***/
+
+#define SECTOR_MAP_UPDATE   0
+#define SECTOR_MAP_READONLY 1
+
+typedef struct _SectorMap
+{  char *path;                     /* path of the map file */
+   char *imageName;                /* image the map belongs to */
+   LargeFile *file;
+   unsigned char *base;            /* mapped file contents */
+   size_t mapSize;
+   struct _SectorMapHeader *header;
+   Bitmap present;                 /* bit set = sector is present in image; lives in the map file */
+   guint32 *crc;                   /* CRC32 of each present sector */
+   guint64 sectors;
+   int writeable;
+   int resumed;                    /* contents were taken over from previous session */
+} SectorMap;
+
+#define SectorMapPresent(map,s) ((s) < (map)->sectors && GetBit((&(map)->present),(s)))
+
+SectorMap* OpenSectorMap(char*, guint64, int);
+void CloseSectorMap(SectorMap*);
+void SectorMapClear(SectorMap*, guint64);
+void SectorMapSet(SectorMap*, guint64, unsigned char*);
+void SectorMapSetCrc(SectorMap*, guint64, guint32);
+
 /***
  *** show-manual.c
  ***/
@@ -1385,6 +1605,64 @@ void DrawSpiralLabel(Spiral*, PangoLayout*, char*, GdkColor*, int, int);
 void ChangeSpiralCursor(Spiral*, int);
 void MoveSpiralCursor(Spiral*, int);
 
+/***
+ *** stats.c
+ ***/
+
+enum
+{  STAT_IO_WAIT,           /* timers: reading image or medium data */
+   STAT_FLUSH,             /* writing ecc data or repaired sectors */
+   STAT_ENCODE_WAIT,       /* I/O thread waiting for the encoders */
+   STAT_ENCODE,
+   STAT_CRC,
+   STAT_MD5,
+   STAT_SYNDROME,
+   STAT_DECODE,
+   STAT_BYTES_READ,        /* counters */
+   STAT_BYTES_WRITTEN,
+   STAT_ECC_BLOCKS,
+   STAT_ERASURES,
+   STAT_CORRECTED,
+   STAT_UNCORRECTABLE,
+   STAT_READ_ERRORS,
+   STAT_CPU_BOUND,
+   STAT_IO_BOUND,
+   STAT_READ_SPEED,        /* gauges */
+   STAT_CODEC_THREADS,
+   STAT_COUNT
+};
+
+void StartStats(char*);
+void StopStats(void);
+gint64 StatsTimestamp(void);
+void StatsTime(int, gint64);
+void StatsCount(int, gint64);
+void StatsGauge(int, gint64);
+
+/***
+ *** trace.c
+ ***/
+
+enum
+{  TRACE_READ_CHUNK,       /* RS03 encoding pipeline */
+   TRACE_FLUSH_CRC,
+   TRACE_FLUSH_PARITY,
+   TRACE_ENCODER_WAIT,     /* I/O thread waiting for the encoders */
+   TRACE_ENCODE,
+   TRACE_DATA_WAIT,        /* encoder waiting for the next chunk */
+   TRACE_SLICE_WAIT,       /* encoder waiting for the parity to be written */
+   TRACE_FIX_CACHE,        /* RS03 repair */
+   TRACE_FIX_DECODE,
+   TRACE_READ_SECTORS,     /* reading from the drive */
+   TRACE_COUNT
+};
+
+void StartTrace(void);
+void StopTrace(void);
+gint64 TraceBegin(void);
+void TraceEnd(int, gint64);
+void TraceThreadName(char*, ...);
+
 /***
  *** welcome-window.c
  ***/
@@ -78,7 +78,12 @@ void register_rs01(void)
 
 static void destroy(Method *method)
 {  RS01Widgets *wl = (RS01Widgets*)method->widgetList;
+   RS01CksumClosure *csc = (RS01CksumClosure*)method->ckSumClosure;
 
+   if(csc->md5Stream)
+      CloseHashStream(csc->md5Stream);
+   if(csc->hashQueue)
+      FreeHashQueue(csc->hashQueue);
    g_free(method->ckSumClosure);
 
    if(wl)
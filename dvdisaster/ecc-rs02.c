@@ -84,6 +84,12 @@ static void destroy(Method *method)
 
    if(csc->lay)
       g_free(csc->lay);
+   if(csc->md5Stream)
+   {  CloseHashStream(csc->md5Stream);
+      CloseHashStream(csc->dataStream);
+   }
+   if(csc->hashQueue)
+      FreeHashQueue(csc->hashQueue);
    g_free(method->ckSumClosure);
 
    if(wl)
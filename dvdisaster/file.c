@@ -204,6 +204,9 @@ char *ApplyAutoSuffix(char *filename, char *suffix)
    if(!filename || !*filename || strrchr(filename, '.')) 
      return filename;
 
+   if(!strcmp(filename, "-"))   /* standard input */
+     return filename;
+
    out = g_strdup_printf("%s.%s",filename,suffix);
    g_free(filename);
    
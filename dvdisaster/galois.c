@@ -35,11 +35,38 @@
  * they only work for the case of GF(p**n) with p being prime.
  */
 
-/* Initialize the Galois field tables */
+/***
+ *** Table storage.
+ ***
+ * The tables only depend on the code parameters, so they are created
+ * once and then shared by all encoders, decoders and verifiers
+ * of the process (they are never written to after creation).
+ * Free*Tables() therefore do nothing; the memory is released
+ * by FreeGaloisTableCache() when the program ends.
+ *
+ * All tables of a given GaloisTables / ReedSolomonTables struct
+ * live in one contiguous block with 64 byte aligned subtables,
+ * so that the working set of the codecs is kept small and
+ * does not share cache lines with unrelated data.
+ */
 
+#define ARENA_ALIGN(x) (((x)+63) & ~63)
 
-GaloisTables* CreateGaloisTables(gint32 gf_generator)
+static GStaticMutex cache_mutex = G_STATIC_MUTEX_INIT;
+static GaloisTables *gt_cache;
+static ReedSolomonTables *rt_cache;
+
+static guint8* alloc_arena(gsize size, guint8 **base)
+{  *base = g_malloc0(size + 63);
+
+   return (guint8*)ARENA_ALIGN((gsize)*base);
+}
+
+/* Initialize the Galois field tables */
+
+static GaloisTables* create_galois_tables(gint32 gf_generator)
 {  GaloisTables *gt = g_malloc0(sizeof(GaloisTables));
+   guint8 *arena;
    gint32 b,log;
 
    /* Allocate the tables.
@@ -48,9 +75,10 @@ GaloisTables* CreateGaloisTables(gint32 gf_generator)
 
    gt->gfGenerator = gf_generator;
 
-   gt->indexOf     = g_malloc(GF_FIELDSIZE * sizeof(gint32));
-   gt->alphaTo     = g_malloc(GF_FIELDSIZE * sizeof(gint32));
-   gt->encAlphaTo  = g_malloc(2*GF_FIELDSIZE * sizeof(gint32));
+   arena = alloc_arena(4*GF_FIELDSIZE, &gt->arena);
+   gt->indexOf     = arena;
+   gt->alphaTo     = arena + GF_FIELDSIZE;
+   gt->encAlphaTo  = arena + 2*GF_FIELDSIZE;
    
    /* create the log/ilog values */
 
@@ -75,13 +103,28 @@ GaloisTables* CreateGaloisTables(gint32 gf_generator)
    return gt;
 }
 
+GaloisTables* CreateGaloisTables(gint32 gf_generator)
+{  GaloisTables *gt;
+
+   g_static_mutex_lock(&cache_mutex);
+
+   for(gt = gt_cache; gt; gt = gt->next)
+     if(gt->gfGenerator == gf_generator)
+       break;
+
+   if(!gt)
+   {  gt = create_galois_tables(gf_generator);
+      gt->next = gt_cache;
+      gt_cache = gt;
+   }
+
+   g_static_mutex_unlock(&cache_mutex);
+
+   return gt;
+}
+
 void FreeGaloisTables(GaloisTables *gt)
 {
-  if(gt->indexOf)     g_free(gt->indexOf);
-  if(gt->alphaTo)     g_free(gt->alphaTo);
-  if(gt->encAlphaTo) g_free(gt->encAlphaTo);
-
-  g_free(gt);
 }
 
 /***
@@ -89,14 +132,15 @@ void FreeGaloisTables(GaloisTables *gt)
  *** and some auxiliary data structures.
  */
 
-ReedSolomonTables *CreateReedSolomonTables(GaloisTables *gt,
-					   gint32 first_consecutive_root,
-					   gint32 prim_elem,
-					   int nroots_in)
+static ReedSolomonTables *create_reed_solomon_tables(GaloisTables *gt,
+						     gint32 first_consecutive_root,
+						     gint32 prim_elem,
+						     int nroots_in)
 {  ReedSolomonTables *rt = g_malloc0(sizeof(ReedSolomonTables));
    int lut_size, feedback;
    gint32 i,j,root;
-   guint8 *lut;
+   gsize gpoly_size, blut_size;
+   guint8 *arena, *lut;
 
    rt->gfTables = gt;
    rt->fcr      = first_consecutive_root;
@@ -104,7 +148,25 @@ ReedSolomonTables *CreateReedSolomonTables(GaloisTables *gt,
    rt->nroots   = nroots_in;
    rt->ndata    = GF_FIELDMAX - rt->nroots;
 
-   rt->gpoly    = g_malloc((rt->nroots+1) * sizeof(gint32));
+   /*
+    * The lookup tables for both encoder types have two copies of
+    * each row so that they can be read starting at any shift position.
+    * The 32bit portable encoder will shift them to word boundaries,
+    * while the SSE2 encoder does direct unaligned reads.
+    */
+
+   lut_size = (rt->nroots+15)&~15;
+   lut_size += 16;
+
+   gpoly_size = ARENA_ALIGN((rt->nroots+1) * sizeof(gint32));
+   blut_size  = GF_FIELDSIZE * 2*lut_size;
+
+   arena = alloc_arena(gpoly_size + blut_size + rt->nroots * GF_FIELDSIZE, &rt->arena);
+
+   rt->gpoly    = (gint32*)arena;
+   for(i=0; i<GF_FIELDSIZE; i++)
+      rt->bLut[i] = arena + gpoly_size + i*2*lut_size;
+   rt->synLut   = arena + gpoly_size + blut_size;
 
    /* Create the RS code generator polynomial */
 
@@ -152,25 +214,16 @@ ReedSolomonTables *CreateReedSolomonTables(GaloisTables *gt,
    if(rt->shiftInit == rt->nroots)
      rt->shiftInit = 0;
 
-   /*
-    * Initialize lookup tables for both encoder types.
-    * The 32bit portable encoder will shift them to word boundaries,
-    * while the SSE2 encoder does direct unaligned reads.
-    */
-
-   lut_size = (rt->nroots+15)&~15;
-   lut_size += 16;
-   for(i=0; i<GF_FIELDSIZE; i++)
-      rt->bLut[i] = g_malloc0(2*lut_size);
+   /* Fill in the encoder lookup tables */
 
    for(feedback=0; feedback<256; feedback++)
    {  gint32 *gpoly        = rt->gpoly + rt->nroots;
-      gint32 *enc_alpha_to = gt->encAlphaTo;
+      guint8 *enc_alpha_to = gt->encAlphaTo;
       int nroots = rt->nroots;
 
       for(i=0; i<nroots; i++)
       {  guint8 value = (guint8)enc_alpha_to[feedback + *--gpoly];
-	 rt->bLut[feedback][i] = rt->bLut[feedback][nroots+i] = value; 
+	 rt->bLut[feedback][i] = rt->bLut[feedback][nroots+i] = value;
       }
    }
 
@@ -178,7 +231,7 @@ ReedSolomonTables *CreateReedSolomonTables(GaloisTables *gt,
     * Prepare lookup table for syndrome calculation.
     */
 
-   lut = rt->synLut = g_malloc(rt->nroots * GF_FIELDSIZE * sizeof(int));
+   lut = rt->synLut;
    for(i=0; i<rt->nroots; i++)
      for(j=0; j<GF_FIELDSIZE; j++)
        *lut++ = gt->alphaTo[mod_fieldmax(gt->indexOf[j] + (rt->fcr+i)*rt->primElem)];
@@ -186,15 +239,53 @@ ReedSolomonTables *CreateReedSolomonTables(GaloisTables *gt,
    return rt;
 }
 
+ReedSolomonTables *CreateReedSolomonTables(GaloisTables *gt,
+					   gint32 first_consecutive_root,
+					   gint32 prim_elem,
+					   int nroots)
+{  ReedSolomonTables *rt;
+
+   g_static_mutex_lock(&cache_mutex);
+
+   for(rt = rt_cache; rt; rt = rt->next)
+     if(   rt->gfTables == gt && rt->fcr == first_consecutive_root
+	&& rt->primElem == prim_elem && rt->nroots == nroots)
+       break;
+
+   if(!rt)
+   {  rt = create_reed_solomon_tables(gt, first_consecutive_root, prim_elem, nroots);
+      rt->next = rt_cache;
+      rt_cache = rt;
+   }
+
+   g_static_mutex_unlock(&cache_mutex);
+
+   return rt;
+}
+
 void FreeReedSolomonTables(ReedSolomonTables *rt)
-{ int i;
+{
+}
 
-  if(rt->gpoly)        g_free(rt->gpoly);
+/*
+ * Release all cached tables at program end.
+ */
 
-  for(i=0; i<GF_FIELDSIZE; i++)
-  {  g_free(rt->bLut[i]);
+void FreeGaloisTableCache(void)
+{
+  while(rt_cache)
+  {  ReedSolomonTables *next = rt_cache->next;
+
+     g_free(rt_cache->arena);
+     g_free(rt_cache);
+     rt_cache = next;
   }
-  g_free(rt->synLut);
 
-  g_free(rt);
+  while(gt_cache)
+  {  GaloisTables *next = gt_cache->next;
+
+     g_free(gt_cache->arena);
+     g_free(gt_cache);
+     gt_cache = next;
+  }
 }
@@ -0,0 +1,284 @@
+/*  dvdisaster: Additional error correction for optical media.
+ *  Copyright (C) 2004-2012 Carsten Gnoerlich.
+ *
+ *  Email: carsten@dvdisaster.org  -or-  cgnoerlich@fsfe.org
+ *  Project homepage: http://www.dvdisaster.org
+ *
+ *  This file is part of dvdisaster.
+ *
+ *  dvdisaster is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dvdisaster is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dvdisaster. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dvdisaster.h"
+
+/***
+ *** Offloaded md5sum calculation.
+ ***
+ * A small pool of threads doing MD5Update() on behalf of the readers
+ * and encoders. Each submitted job names a md5 context and a buffer.
+ * All jobs for the same context are handled by the same thread in
+ * submission order, so the resulting md5sum is the same as with
+ * inline MD5Update() calls.
+ * A buffer may be submitted for several contexts at once. In that case
+ * the caller passes a shared reference counter which it has set to the
+ * number of submissions; the completion callback is only invoked by
+ * the job which drops the counter to zero.
+ */
+
+typedef struct _hash_job
+{  struct MD5Context *ctxt;
+   unsigned char *buf;
+   int len;
+   gint *refcount;
+   HashDoneFunc done;
+   gpointer data;
+   struct _hash_job *next;
+} hash_job;
+
+typedef struct _hash_worker
+{  struct _HashQueue *queue;
+   GThread *thread;
+   GCond *cond;                     /* signals new jobs or shutdown */
+   hash_job *head, *tail;           /* FIFO of pending jobs */
+} hash_worker;
+
+static gpointer hash_worker_thread(gpointer data)
+{  hash_worker *hw = (hash_worker*)data;
+   HashQueue *hq = hw->queue;
+
+   g_mutex_lock(hq->lock);
+
+   for(;;)
+   {  hash_job *job;
+      gint64 stats_start;
+
+      while(!hw->head && !hq->shutdown)
+	 g_cond_wait(hw->cond, hq->lock);
+
+      if(!hw->head)   /* shutdown and nothing left to do */
+	 break;
+
+      job = hw->head;
+      hw->head = job->next;
+      if(!hw->head) hw->tail = NULL;
+      g_mutex_unlock(hq->lock);
+
+      stats_start = StatsTimestamp();
+      MD5Update(job->ctxt, job->buf, job->len);
+      StatsTime(STAT_MD5, stats_start);
+
+      if(job->done && (!job->refcount || g_atomic_int_dec_and_test(job->refcount)))
+	 job->done(job->data);
+      g_free(job);
+
+      g_mutex_lock(hq->lock);
+      if(!--hq->pending)
+	 g_cond_broadcast(hq->idle);
+   }
+
+   g_mutex_unlock(hq->lock);
+
+   return NULL;
+}
+
+/*
+ * Create and destroy the hashing threads
+ */
+
+HashQueue* CreateHashQueue(int n_threads)
+{  HashQueue *hq = g_malloc0(sizeof(HashQueue));
+   int i;
+
+   if(n_threads < 1) n_threads = 1;
+
+   hq->lock     = g_mutex_new();
+   hq->idle     = g_cond_new();
+   hq->nWorkers = n_threads;
+   hq->worker   = g_malloc0(n_threads*sizeof(hash_worker));
+
+   for(i=0; i<n_threads; i++)
+   {  hash_worker *hw = &hq->worker[i];
+      GError *err = NULL;
+
+      hw->queue  = hq;
+      hw->cond   = g_cond_new();
+      hw->thread = g_thread_create(hash_worker_thread, (gpointer)hw, TRUE, &err);
+      if(!hw->thread)
+	 Stop("Could not create hashing thread: %s", err->message);
+   }
+
+   return hq;
+}
+
+void FreeHashQueue(HashQueue *hq)
+{  int i;
+
+   g_mutex_lock(hq->lock);
+   hq->shutdown = TRUE;
+   for(i=0; i<hq->nWorkers; i++)
+      g_cond_signal(hq->worker[i].cond);
+   g_mutex_unlock(hq->lock);
+
+   for(i=0; i<hq->nWorkers; i++)
+   {  g_thread_join(hq->worker[i].thread);
+      g_cond_free(hq->worker[i].cond);
+   }
+
+   g_mutex_free(hq->lock);
+   g_cond_free(hq->idle);
+   g_free(hq->worker);
+   g_free(hq);
+}
+
+/*
+ * Queue a buffer for hashing into the given context.
+ * The buffer must stay untouched until the callback has been invoked
+ * or HashQueueSync() has returned.
+ */
+
+void HashQueueSubmit(HashQueue *hq, struct MD5Context *ctxt, unsigned char *buf, int len,
+		     gint *refcount, HashDoneFunc done, gpointer data)
+{  hash_job *job = g_malloc(sizeof(hash_job));
+   hash_worker *hw = &hq->worker[(GPOINTER_TO_SIZE(ctxt) / sizeof(struct MD5Context)) % hq->nWorkers];
+
+   job->ctxt     = ctxt;
+   job->buf      = buf;
+   job->len      = len;
+   job->refcount = refcount;
+   job->done     = done;
+   job->data     = data;
+   job->next     = NULL;
+
+   g_mutex_lock(hq->lock);
+   if(hw->tail) hw->tail->next = job;
+   else         hw->head = job;
+   hw->tail = job;
+   hq->pending++;
+   g_cond_signal(hw->cond);
+   g_mutex_unlock(hq->lock);
+}
+
+/*
+ * Wait until all submitted jobs have been processed
+ */
+
+void HashQueueSync(HashQueue *hq)
+{
+   g_mutex_lock(hq->lock);
+   while(hq->pending)
+      g_cond_wait(hq->idle, hq->lock);
+   g_mutex_unlock(hq->lock);
+}
+
+/***
+ *** Buffered hashing streams.
+ ***
+ * Drop-in replacement for a sequence of MD5Update() calls on the same
+ * context. Data is collected in a few large buffers which are handed
+ * over to the hash queue once full; the caller only blocks if it runs
+ * HASH_STREAM_BUFS buffers ahead of the hashing thread.
+ * Since the context is updated asynchronously, it must not be touched
+ * before CloseHashStream() has returned.
+ */
+
+static void stream_buffer_done(gpointer data)
+{  HashStreamBuffer *hsb = (HashStreamBuffer*)data;
+   HashStream *hs = hsb->stream;
+
+   g_mutex_lock(hs->lock);
+   hsb->busy = FALSE;
+   g_cond_signal(hs->cond);
+   g_mutex_unlock(hs->lock);
+}
+
+static void flush_stream_buffer(HashStream *hs)
+{  HashStreamBuffer *hsb = &hs->buffer[hs->current];
+
+   if(!hsb->fill)
+      return;
+
+   hsb->busy = TRUE;
+   HashQueueSubmit(hs->queue, hs->ctxt, hsb->buf, hsb->fill, NULL, stream_buffer_done, hsb);
+
+   /* Move on to the next buffer, waiting for it if necessary */
+
+   if(++hs->current >= HASH_STREAM_BUFS)
+      hs->current = 0;
+   hsb = &hs->buffer[hs->current];
+
+   g_mutex_lock(hs->lock);
+   while(hsb->busy)
+      g_cond_wait(hs->cond, hs->lock);
+   g_mutex_unlock(hs->lock);
+
+   hsb->fill = 0;
+}
+
+HashStream* OpenHashStream(HashQueue *hq, struct MD5Context *ctxt)
+{  HashStream *hs = g_malloc0(sizeof(HashStream));
+   int i;
+
+   hs->queue = hq;
+   hs->ctxt  = ctxt;
+   hs->lock  = g_mutex_new();
+   hs->cond  = g_cond_new();
+
+   for(i=0; i<HASH_STREAM_BUFS; i++)
+   {  hs->buffer[i].stream = hs;
+      hs->buffer[i].buf    = g_malloc(HASH_STREAM_BUFSIZE);
+   }
+
+   return hs;
+}
+
+void HashStreamWrite(HashStream *hs, unsigned char *buf, int len)
+{
+   while(len > 0)
+   {  HashStreamBuffer *hsb = &hs->buffer[hs->current];
+      int n = HASH_STREAM_BUFSIZE - hsb->fill;
+
+      if(n > len) n = len;
+      memcpy(hsb->buf + hsb->fill, buf, n);
+      hsb->fill += n;
+      buf += n;
+      len -= n;
+
+      if(hsb->fill == HASH_STREAM_BUFSIZE)
+	 flush_stream_buffer(hs);
+   }
+}
+
+/*
+ * Hash the remaining data and wait until the context is up to date.
+ * The context can be used again (e.g. for MD5Final()) afterwards.
+ */
+
+void CloseHashStream(HashStream *hs)
+{  int i;
+
+   flush_stream_buffer(hs);
+
+   g_mutex_lock(hs->lock);
+   for(i=0; i<HASH_STREAM_BUFS; i++)
+      while(hs->buffer[i].busy)
+	 g_cond_wait(hs->cond, hs->lock);
+   g_mutex_unlock(hs->lock);
+
+   for(i=0; i<HASH_STREAM_BUFS; i++)
+      g_free(hs->buffer[i].buf);
+
+   g_mutex_free(hs->lock);
+   g_cond_free(hs->cond);
+   g_free(hs);
+}
@@ -23,144 +23,12 @@
 
 #include "dvdisaster.h"
 
-/***
- *** Auxiliary functions for collecting some stuff incrementally
- ***/
-
-/*
- * Update count of different bytes read for each position
- */
-
-void UpdateByteCounts(RawBuffer *rb)
-{
-   int i, j;
-
-   /* The first time there is not much to do */
-   if(rb->samplesRead == 1)
-   {
-      memset(rb->byteCount, 1, rb->sampleSize);
-      return;
-   }
-
-   /* Update byte counts */
-   for(i = 0; i < rb->sampleSize; i++)
-   {
-      char found = 0;
-      for(j = 0; j < rb->samplesRead - 1; j++)
-      {
-         if(rb->rawBuf[rb->samplesRead - 1][i] == rb->rawBuf[j][i]) 
-         {
-            found = 1;
-            break;
-         }
-      }
-      
-      if(!found) rb->byteCount[i]++;
-   }
-}
-
-/*
- * Determine work load of P/Q vectors in the given frame
- */
-
-void CalculatePQLoad(RawBuffer *rb)
-{  unsigned char p_vector[P_VECTOR_SIZE];
-   unsigned char q_vector[Q_VECTOR_SIZE];
-   int frame_idx = rb->samplesRead - 1;
-   unsigned char *new_frame = rb->rawBuf[frame_idx];
-   int ignore[2];
-   int q, p;
-   int err;
-        
-   for(q = 0; q < N_Q_VECTORS; q++)
-   {
-     GetQVector(new_frame, q_vector, q);
-     err = DecodePQ(rb->rt, q_vector, Q_PADDING, ignore, 0);
-     if(err <  0) rb->qLoad[frame_idx] += 2;
-     if(err == 1) rb->qLoad[frame_idx]++; /* We assume without any erasures specified there can't be more than 1 errors corrected. */
-   }      
-
-   for(p = 0; p < N_P_VECTORS; p++)
-   {
-     GetPVector(new_frame, p_vector, p);
-     err = DecodePQ(rb->rt, p_vector, P_PADDING, ignore, 0);
-     if(err <  0) rb->pLoad[frame_idx] += 2;
-     if(err == 1) rb->pLoad[frame_idx]++; /* We assume without any erasures specified there can't be more than 1 errors corrected. */
-   }      
-}   
-
-/*
- * Collect a list of all seen P/Q parity bytes.
- */
-
-void UpdatePQParityList(RawBuffer *rb, unsigned char *new_frame)
-{  unsigned char p_vector[P_VECTOR_SIZE];
-   unsigned char q_vector[Q_VECTOR_SIZE];
-   int i,p,q;
-
-   /*** See if new frame has any Q parity bytes different from the existing ones. */
-
-   for(q=0; q<N_Q_VECTORS; q++)
-   {  int qfound = FALSE;
-
-      GetQVector(new_frame, q_vector, q);
-
-      for(i=0; i<rb->qParityN[q][0]; i++)
-        if(rb->qParity1[q][i] == q_vector[43])
-        {  qfound = TRUE;
-           break;
-        }
-
-      if(!qfound)
-        rb->qParity1[q][rb->qParityN[q][0]++] = q_vector[43];
-
-      qfound = FALSE;
-
-      for(i=0; i<rb->qParityN[q][1]; i++)
-        if(rb->qParity2[q][i] == q_vector[44])
-        {  qfound = TRUE;
-           break;
-        }
-
-      if(!qfound)
-        rb->qParity2[q][rb->qParityN[q][1]++] = q_vector[44];
-   }
-
-   /*** See if new frame has any P parity bytes different from the existing ones. */
-
-   for(p=0; p<N_P_VECTORS; p++)
-   {  int pfound = FALSE;
-
-      GetPVector(new_frame, p_vector, p);
-
-      for(i=0; i<rb->pParityN[p][0]; i++)
-        if(rb->pParity1[p][i] == p_vector[24])
-        {  pfound = TRUE;
-           break;
-        }
-
-      if(!pfound)
-        rb->pParity1[p][rb->pParityN[p][0]++] = p_vector[24];
-
-      pfound = FALSE;
-
-      for(i=0; i<rb->pParityN[p][1]; i++)
-        if(rb->pParity2[p][i] == p_vector[25])
-        {  pfound = TRUE;
-           break;
-        }
-
-      if(!pfound)
-        rb->pParity2[p][rb->pParityN[p][1]++] = p_vector[25];
-   }
-}
-
 /***
  *** Heuristic L-EC attempt
  *** Andrei Grecu, 2006
  */
 
-static int eval_q_candidate(RawBuffer *rb, unsigned char *q_vector, int q, 
+static int eval_q_candidate(RawBuffer *rb, PQState *pq, unsigned char *q_vector, int q, 
                             int *p_failures_out, int *p_errors_out)
 {
    unsigned char     p_vector[P_VECTOR_SIZE];
@@ -171,19 +39,18 @@ static int eval_q_candidate(RawBuffer *rb, unsigned char *q_vector, int q,
    int err;
    
    GetQVector(rb->recovered, old_q_vector, q);
-   SetQVector(rb->recovered,     q_vector, q);
+   PQStateSetQVector(pq,         q_vector, q);
    
    /* Count P failures after setting our Q vector. */
 
    for(p = 0; p < N_P_VECTORS; p++)
    {
-      GetPVector(rb->recovered, p_vector, p);
-      err = DecodePQ(rb->rt, p_vector, P_PADDING, ignore, 0);
+      err = PQStateDecodePVector(rb->rt, pq, p, p_vector, ignore);
       if(err <  0) p_failures++;
       else if(err == 1) p_errors++;
    }            
 
-   SetQVector(rb->recovered, old_q_vector, q);
+   PQStateSetQVector(pq, old_q_vector, q);
 
    *p_failures_out = p_failures;
    *p_errors_out   = p_errors;
@@ -191,7 +58,7 @@ static int eval_q_candidate(RawBuffer *rb, unsigned char *q_vector, int q,
    return TRUE;
 }
 
-static void eval_p_candidate(RawBuffer *rb, unsigned char *p_vector, int p, 
+static void eval_p_candidate(RawBuffer *rb, PQState *pq, unsigned char *p_vector, int p, 
                             int *q_failures_out, int *q_errors_out)
 {
    unsigned char     q_vector[Q_VECTOR_SIZE];
@@ -202,19 +69,18 @@ static void eval_p_candidate(RawBuffer *rb, unsigned char *p_vector, int p,
    int err;
    
    GetPVector(rb->recovered, old_p_vector, p);
-   SetPVector(rb->recovered,     p_vector, p);
+   PQStateSetPVector(pq,         p_vector, p);
    
    /* Count Q failures after setting our P vector. */
 
    for(q = 0; q < N_Q_VECTORS; q++)
    {
-      GetQVector(rb->recovered, q_vector, q);
-      err = DecodePQ(rb->rt, q_vector, Q_PADDING, ignore, 0);
+      err = PQStateDecodeQVector(rb->rt, pq, q, q_vector, ignore);
       if(err <  0) q_failures++;
       else if(err == 1) q_errors++;
    }            
 
-   SetPVector(rb->recovered, old_p_vector, p);
+   PQStateSetPVector(pq, old_p_vector, p);
 
    *q_failures_out = q_failures;
    *q_errors_out = q_errors;
@@ -250,15 +116,20 @@ int HeuristicLEC(unsigned char *cd_frame, RawBuffer *rb, unsigned char *out)
    int max_q_failures = 0;
    int max_q_errors = 0;
    int err;
+   PQState pq;
 
    memset(rb->byteState, FRAME_BYTE_UNKNOWN, rb->sampleSize);
+
+   /* All changes to rb->recovered go through pq,
+      so that good vectors need not be decoded. */
+
+   InitPQState(&pq, rb->gt, rb->recovered);
    
    /* Count initial P failures */
 
    for(p = 0; p < N_P_VECTORS; p++)
    {
-      GetPVector(rb->recovered, p_vector, p);
-      err = DecodePQ(rb->rt, p_vector, P_PADDING, ignore, 0);
+      err = PQStateDecodePVector(rb->rt, &pq, p, p_vector, ignore);
       if(err < 0) max_p_failures++;
       if(err == 1) max_p_errors++;
    }
@@ -267,8 +138,7 @@ int HeuristicLEC(unsigned char *cd_frame, RawBuffer *rb, unsigned char *out)
 
    for(q = 0; q < N_Q_VECTORS; q++)
    {
-      GetQVector(rb->recovered, q_vector, q);
-      err = DecodePQ(rb->rt, q_vector, Q_PADDING, ignore, 0);
+      err = PQStateDecodeQVector(rb->rt, &pq, q, q_vector, ignore);
       if(err < 0) max_q_failures++;
       if(err == 1) max_q_errors++;
    }   
@@ -299,12 +169,11 @@ int HeuristicLEC(unsigned char *cd_frame, RawBuffer *rb, unsigned char *out)
 
          /* First try to see whether P is correctable without erasure markings. */
 
-         GetPVector(rb->recovered, p_vector, p);
-         err = DecodePQ(rb->rt, p_vector, P_PADDING, ignore, 0);
+         err = PQStateDecodePVector(rb->rt, &pq, p, p_vector, ignore);
          
          if(err == 1) /* Store back corrected vector */ 
          {  
-            SetPVector(rb->recovered, p_vector, p);
+            PQStateSetPVector(&pq, p_vector, p);
             FillPVector(rb->byteState, FRAME_BYTE_GOOD, p);
             p_corrected++;
             p_err += err;
@@ -336,7 +205,7 @@ int HeuristicLEC(unsigned char *cd_frame, RawBuffer *rb, unsigned char *out)
                   {  int q_err, q_fail;
 
                      candidate = TRUE;
-                     eval_p_candidate(rb, p_vector, p, &q_fail, &q_err);
+                     eval_p_candidate(rb, &pq, p_vector, p, &q_fail, &q_err);
 
                      if(q_fail <= best_q_failures && q_err <= best_q_errors)
                      {  best_q_failures = q_fail;
@@ -350,7 +219,7 @@ int HeuristicLEC(unsigned char *cd_frame, RawBuffer *rb, unsigned char *out)
             if(!candidate) err = -1; /* If P failed */
             else
             {  FillPVector(rb->byteState, FRAME_BYTE_GOOD, p);
-               SetPVector(rb->recovered, best_p, p);
+               PQStateSetPVector(&pq, best_p, p);
                
                err = 0;
                p_err += 2;
@@ -383,12 +252,11 @@ int HeuristicLEC(unsigned char *cd_frame, RawBuffer *rb, unsigned char *out)
 
          /* First try to see whether Q is correctable without erasure markings. */
 
-         GetQVector(rb->recovered, q_vector, q);
-         err = DecodePQ(rb->rt, q_vector, Q_PADDING, ignore, 0);
+         err = PQStateDecodeQVector(rb->rt, &pq, q, q_vector, ignore);
 
          if(err == 1) /* Store back corrected vector */ 
          {  
-            SetQVector(rb->recovered, q_vector, q);
+            PQStateSetQVector(&pq, q_vector, q);
             FillQVector(rb->byteState, FRAME_BYTE_GOOD, q);
             q_corrected++;
             q_err++;
@@ -418,7 +286,7 @@ int HeuristicLEC(unsigned char *cd_frame, RawBuffer *rb, unsigned char *out)
                   {  int p_err, p_fail;
 
                      candidate = TRUE;
-                     eval_q_candidate(rb, q_vector, q, &p_fail, &p_err);
+                     eval_q_candidate(rb, &pq, q_vector, q, &p_fail, &p_err);
 
                      if(p_fail <= best_p_failures && p_err <= best_p_errors)
                      {  best_p_failures = p_fail;
@@ -432,7 +300,7 @@ int HeuristicLEC(unsigned char *cd_frame, RawBuffer *rb, unsigned char *out)
             if(!candidate) err = -1; /* If Q failed */
             else
             {  FillQVector(rb->byteState, FRAME_BYTE_GOOD, q);
-               SetQVector(rb->recovered, best_q, q);
+               PQStateSetQVector(&pq, best_q, q);
                
                err = 0;
                q_err += 2;
@@ -1887,6 +1755,160 @@ int AckHeuristic(RawBuffer *rb)
    return 1;
 }
 
+/***
+ *** Brute force search for plausible sectors
+ ***
+ * For a damaged P or Q vector, all combinations of the byte values 
+ * seen at each vector position are tried in the RS decoder.
+ * The combinations are numbered in mixed radix, position 0 being
+ * the fastest changing digit, and may be enumerated by several threads
+ * working on chunks of numbers. The lowest numbered combination
+ * which decodes without error is taken, or if the vector was
+ * uncorrectable, the lowest one which decodes with a single error.
+ * Thus the result does not depend on the number of threads.
+ * Finding an error free combination is broadcast to all threads, 
+ * which then skip everything numbered above it.
+ */
+
+#define BRUTE_FORCE_MAX_COMPLEXITY 65536   /* max. number of combinations per vector */
+#define BRUTE_FORCE_THREADED 4096          /* use threads above this complexity */
+#define BRUTE_FORCE_CHUNK 512              /* combinations handed out at once */
+#define BRUTE_FORCE_TIME_BUDGET 60.0       /* seconds per sector */
+
+typedef struct _bf_search
+{  RawBuffer *rb;
+   unsigned char (*zList)[256];
+   unsigned char *czList;
+   int length;                     /* vector length */
+   int padding;                    /* P_PADDING or Q_PADDING */
+   int referr;                     /* decoder result for the current vector */
+   gint64 complexity;              /* number of combinations */
+
+   GMutex *lock;
+   gint64 next;                    /* start of next chunk */
+   gint64 first0;                  /* lowest combination decoding with 0 errors */
+   gint64 first1;                  /* lowest combination decoding with 1 error */
+
+   GTimer *timer;
+   double budget;                  /* seconds until timedOut */
+   int timedOut;
+} bf_search;
+
+static void combination_to_vector(bf_search *bf, gint64 n, int *digit, unsigned char *vector)
+{  int a;
+
+   for(a=0; a<bf->length; a++)
+   {  digit[a]  = n % bf->czList[a];
+      vector[a] = bf->zList[a][digit[a]];
+      n /= bf->czList[a];
+   }
+}
+
+static gpointer brute_force_worker(gpointer data)
+{  bf_search *bf = (bf_search*)data;
+   unsigned char vector[45], trial[45];
+   int digit[45];
+   int ignore[2];
+
+   while(TRUE)
+   {  gint64 n,start,end;
+
+      /* Fetch the next chunk */
+
+      g_mutex_lock(bf->lock);
+      if(g_timer_elapsed(bf->timer, NULL) > bf->budget)
+	 bf->timedOut = TRUE;
+      start = bf->next;
+      end   = MIN(start + BRUTE_FORCE_CHUNK, bf->first0);
+      bf->next = start + BRUTE_FORCE_CHUNK;
+      g_mutex_unlock(bf->lock);
+
+      if(bf->timedOut || start >= end)
+	 break;
+
+      /* Try its combinations */
+
+      combination_to_vector(bf, start, digit, vector);
+
+      for(n=start; n<end; n++)
+      {  int a,err;
+
+	 memcpy(trial, vector, bf->length);
+	 err = DecodePQ(bf->rb->rt, trial, bf->padding, ignore, 0);
+
+	 if(err == 0)
+	 {  g_mutex_lock(bf->lock);
+	    if(n < bf->first0) bf->first0 = n;
+	    g_mutex_unlock(bf->lock);
+	    break;
+	 }
+
+	 if(err == 1 && bf->referr < 0 && n < bf->first1)
+	 {  g_mutex_lock(bf->lock);
+	    if(n < bf->first1) bf->first1 = n;
+	    g_mutex_unlock(bf->lock);
+	 }
+
+	 /* Next combination */
+
+	 for(a=0; a<bf->length; a++)
+	 {  if(++digit[a] < bf->czList[a])
+	    {  vector[a] = bf->zList[a][digit[a]];
+	       break;
+	    }
+	    digit[a]  = 0;
+	    vector[a] = bf->zList[a][0];
+	 }
+      }
+   }
+
+   return NULL;
+}
+
+/*
+ * Enumerate all combinations for a vector. 
+ * Returns the decoder result for the chosen combination
+ * which is then left in vector[], or the unchanged referr
+ * if nothing better was found.
+ */
+
+static int brute_force_vector(bf_search *bf, unsigned char *vector)
+{  int n_threads = bf->rb->threads ? bf->rb->threads : Closure->codecThreads;
+   int digit[45];
+   int ignore[2];
+   gint64 n;
+   int i;
+
+   bf->next   = 0;
+   bf->first0 = bf->complexity;
+   bf->first1 = bf->complexity;
+
+   if(n_threads > 1 && bf->complexity > BRUTE_FORCE_THREADED)
+   {  GThread *thread[n_threads];
+
+      for(i=0; i<n_threads; i++)
+      {  GError *err = NULL;
+
+	 thread[i] = g_thread_create(brute_force_worker, (gpointer)bf, TRUE, &err);
+	 if(!thread[i])
+	    Stop("Could not create brute force search thread: %s", err->message);
+      }
+
+      for(i=0; i<n_threads; i++)
+	 g_thread_join(thread[i]);
+   }
+   else brute_force_worker(bf);
+
+   if(bf->first0 < bf->complexity)
+        n = bf->first0;
+   else if(bf->first1 < bf->complexity)
+        n = bf->first1;
+   else return bf->referr;
+
+   combination_to_vector(bf, n, digit, vector);
+   return DecodePQ(bf->rb->rt, vector, bf->padding, ignore, 0);
+}
+
 int BruteForceSearchPlausibleSector(RawBuffer *rb)
 {
    unsigned char p_vector[26];
@@ -1908,10 +1930,23 @@ int BruteForceSearchPlausibleSector(RawBuffer *rb)
    
    unsigned char  zList[45][256]; /* stores different bytes which were read for each position in a sector */   
    unsigned char czList[45];	   /* counts different bytes which were read for each position in a sector */
-   int zStack[45], pzStack;
+   bf_search bf;
+   PQState pq;
 
    /* Re-Initialize sector */     
    InitializeCDFrame(rb->recovered, rb->lba, rb->xaMode, 1);
+   InitPQState(&pq, rb->gt, rb->recovered);
+
+   memset(&bf, 0, sizeof(bf_search));
+   bf.rb    = rb;
+   bf.lock  = g_mutex_new();
+   bf.timer = g_timer_new();
+
+   /* Do not run beyond the deadline of the caller */
+
+   bf.budget = BRUTE_FORCE_TIME_BUDGET;
+   if(rb->deadlineTimer)
+      bf.budget = MIN(bf.budget, rb->deadline - g_timer_elapsed(rb->deadlineTimer, NULL));
 
    for(; ;) /* iterate over P- and Q-Parity until failures converge */
    {   
@@ -1925,8 +1960,10 @@ int BruteForceSearchPlausibleSector(RawBuffer *rb)
       {  
 	 int referr;
 	 /* Check whether Q is correct. */
-	 GetQVector(rb->recovered, q_vector, q);
-	 referr = DecodePQ(rb->rt, q_vector, Q_PADDING, ignore, 0);
+	 if(QVectorOK(&pq, q))
+	    continue;
+
+	 referr = PQStateDecodeQVector(rb->rt, &pq, q, q_vector, ignore);
 
 	 /* If it is not correct. */
 	 if(referr == 1 || referr < 0)
@@ -1947,11 +1984,9 @@ int BruteForceSearchPlausibleSector(RawBuffer *rb)
 		  int idx = QToByteIndex(q, a); 
 		  ByteIndexToP(idx, &p, &ppos);
 		  
-		  GetPVector(rb->recovered, p_vector, p);
-		  err = DecodePQ(rb->rt, p_vector, P_PADDING, ignore, 0);
-		  if(!err) 
+		  if(PVectorOK(&pq, p)) 
 		  {
-		     zList[a][czList[a]] = p_vector[ppos];
+		     zList[a][czList[a]] = rb->recovered[idx];
 		     czList[a]++;
 		     continue;
 		  }
@@ -1975,46 +2010,32 @@ int BruteForceSearchPlausibleSector(RawBuffer *rb)
 	       }
 	       
 	       complexity *= czList[a];
-	       if(complexity > 65536) break;
+	       if(complexity > BRUTE_FORCE_MAX_COMPLEXITY) break;
 	    }
 
 	    /* do not let the enumeration get too complex */
-	    if(complexity > 65536) continue;
-	    /* no degrees of freedom */
-	    if(complexity == 1) continue; 
-
-	    memset(zStack, 0, 45 * sizeof(int));
-	    while(1)
-	    {
-	       for(a = 0; a < 45; a++)
-	       {
-		  cq_vector[a] = zList[a][zStack[a]];
-	       }					
-	       
-	       err = DecodePQ(rb->rt, cq_vector, Q_PADDING, ignore, 0);
-	       if((referr < 0 && err >= 0) || (referr == 1 && err == 0)) 
-	       {
-		  SetQVector(rb->recovered, cq_vector, q);
-		  q_corrected++;
-
-		  referr = err;
-		  if(referr == 0) break;
-	       }
-	       
-	       pzStack = 0;
-	       while(pzStack < 45)
-	       {
-		  zStack[pzStack]++;
-		  if(zStack[pzStack] == czList[pzStack]) 
-		  {
-		     zStack[pzStack] = 0;
-		     pzStack++;
-		  }
-		  else break;
-	       }
-	       
-	       if(pzStack == 45) break;
+	    if(complexity > BRUTE_FORCE_MAX_COMPLEXITY) continue;
+	    /* no degrees of freedom (0: a position had all 256 values) */
+	    if(complexity <= 1) continue; 
+
+	    bf.zList      = zList;
+	    bf.czList     = czList;
+	    bf.length     = 45;
+	    bf.padding    = Q_PADDING;
+	    bf.referr     = referr;
+	    bf.complexity = complexity;
+
+	    err = brute_force_vector(&bf, cq_vector);
+	    if(err != referr)
+	    {  PQStateSetQVector(&pq, cq_vector, q);
+	       q_corrected++;
+
+	       if(CheckEDC(rb->recovered, rb->xaMode))
+		  goto finished;
 	    }
+
+	    if(bf.timedOut)
+	       goto finished;
 	 }
       }
 
@@ -2022,9 +2043,11 @@ int BruteForceSearchPlausibleSector(RawBuffer *rb)
       for(p = 0; p < N_P_VECTORS; p++)
       {  
 	 int referr;
-	 /* Check whether Q is correct. */
-	 GetPVector(rb->recovered, p_vector, p);
-	 referr = DecodePQ(rb->rt, p_vector, P_PADDING, ignore, 0);
+	 /* Check whether P is correct. */
+	 if(PVectorOK(&pq, p))
+	    continue;
+
+	 referr = PQStateDecodePVector(rb->rt, &pq, p, p_vector, ignore);
 
 	 /* If it is not correct. */
 	 if(referr == 1 || referr < 0)
@@ -2044,11 +2067,9 @@ int BruteForceSearchPlausibleSector(RawBuffer *rb)
 		  int idx = PToByteIndex(p, a); 
 		  ByteIndexToQ(idx, &q, &qpos);
 		  
-		  GetQVector(rb->recovered, q_vector, q);
-		  err = DecodePQ(rb->rt, q_vector, Q_PADDING, ignore, 0);
-		  if(!err) 
+		  if(QVectorOK(&pq, q)) 
 		  {
-		     zList[a][czList[a]] = q_vector[qpos];
+		     zList[a][czList[a]] = rb->recovered[idx];
 		     czList[a]++;
 		     continue;
 		  }
@@ -2072,46 +2093,32 @@ int BruteForceSearchPlausibleSector(RawBuffer *rb)
 	       }
 	       
 	       complexity *= czList[a];
-	       if(complexity > 65536) break;
+	       if(complexity > BRUTE_FORCE_MAX_COMPLEXITY) break;
 	    }
 	    
 	    /* do not let the enumeration get too complex */
-	    if(complexity > 65536) continue;
-	    /* no degrees of freedom */
-	    if(complexity == 1) continue; 
+	    if(complexity > BRUTE_FORCE_MAX_COMPLEXITY) continue;
+	    /* no degrees of freedom (0: a position had all 256 values) */
+	    if(complexity <= 1) continue; 
 	    
-	    memset(zStack, 0, 26 * sizeof(int));
-	    while(1)
-	    {
-	       for(a = 0; a < 26; a++)
-	       {
-		  cp_vector[a] = zList[a][zStack[a]];
-	       }					
-
-	       err = DecodePQ(rb->rt, cp_vector, P_PADDING, ignore, 0);
-	       if((referr < 0 && err >= 0) || (referr == 1 && err == 0)) 
-	       {
-		  SetPVector(rb->recovered, cp_vector, p);
-		  p_corrected++;
-		  
-		  referr = err;
-		  if(referr == 0) break;
-	       }
-	       
-	       pzStack = 0;
-	       while(pzStack < 26)
-	       {
-		  zStack[pzStack]++;
-		  if(zStack[pzStack] == czList[pzStack]) 
-		  {
-		     zStack[pzStack] = 0;
-		     pzStack++;
-		  }
-		  else break;
-	       }
-	       
-	       if(pzStack == 26) break;
+	    bf.zList      = zList;
+	    bf.czList     = czList;
+	    bf.length     = 26;
+	    bf.padding    = P_PADDING;
+	    bf.referr     = referr;
+	    bf.complexity = complexity;
+
+	    err = brute_force_vector(&bf, cp_vector);
+	    if(err != referr)
+	    {  PQStateSetPVector(&pq, cp_vector, p);
+	       p_corrected++;
+
+	       if(CheckEDC(rb->recovered, rb->xaMode))
+		  goto finished;
 	    }
+
+	    if(bf.timedOut)
+	       goto finished;
 	 }
       }
 
@@ -2138,6 +2145,13 @@ int BruteForceSearchPlausibleSector(RawBuffer *rb)
       last_q_failures = q_failures;
       iteration++;
    }	
+
+finished:
+   if(bf.timedOut)
+      Verbose("Sector %lld: brute force search exceeded its time budget\n", rb->lba);
+
+   g_timer_destroy(bf.timer);
+   g_mutex_free(bf.lock);
    
    return 1;
 }
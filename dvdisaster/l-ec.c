@@ -42,14 +42,53 @@ void ByteIndexToP(int b, int *p, int *i)
    *i = (b-12)/86;
 }
 
-int QToByteIndex(int q, int i)
-{  int offset = 12 + (q & 1);
+/*
+ * Frame offsets of the Q vector bytes, and the reverse mapping
+ * from frame bytes to the P and Q vectors containing them.
+ * Filled in on first use; g_once() makes this safe for the
+ * threaded heuristics which may get there at the same time.
+ */
+
+static int q_index[N_Q_VECTORS][Q_VECTOR_SIZE];
+static gint8 byte_p[CD_RAW_SECTOR_SIZE], byte_q[CD_RAW_SECTOR_SIZE];      /* -1: none */
+static gint8 byte_p_pos[CD_RAW_SECTOR_SIZE], byte_q_pos[CD_RAW_SECTOR_SIZE];
+static GOnce q_index_once = G_ONCE_INIT;
+
+static gpointer init_q_index(gpointer unused)
+{  int p,q,i;
 
-   if(i == 43) return 2248+q;
-   if(i == 44) return 2300+q;
+   memset(byte_p, 0xff, sizeof(byte_p));
+   memset(byte_q, 0xff, sizeof(byte_q));
 
-   q&=~1;
-   return offset + (q*43 + i*88) % 2236;
+   for(q=0; q<N_Q_VECTORS; q++)
+   {  int offset = 12 + (q & 1);
+
+      for(i=0; i<43; i++)
+	 q_index[q][i] = offset + ((q&~1)*43 + i*88) % 2236;
+
+      q_index[q][43] = 2248+q;
+      q_index[q][44] = 2300+q;
+
+      for(i=0; i<Q_VECTOR_SIZE; i++)
+      {  byte_q[q_index[q][i]]     = q;
+	 byte_q_pos[q_index[q][i]] = i;
+      }
+   }
+
+   for(p=0; p<N_P_VECTORS; p++)
+      for(i=0; i<P_VECTOR_SIZE; i++)
+      {  byte_p[12+p+86*i]     = p;
+	 byte_p_pos[12+p+86*i] = i;
+      }
+
+   return NULL;
+}
+
+#define Q_INDEX_INIT() g_once(&q_index_once, init_q_index, NULL)
+#define Q_INDEX(q) (Q_INDEX_INIT(), q_index[q])
+
+int QToByteIndex(int q, int i)
+{  return Q_INDEX(q)[i];
 }
 
 void ByteIndexToQ(int b, int *q, int *i)
@@ -140,63 +179,43 @@ void AndPVector(unsigned char *frame, unsigned char value, int n)
  */
 
 void GetQVector(unsigned char *frame, unsigned char *data, int n)
-{  int offset = 12 + (n & 1);
-   int w_idx  = (n&~1) * 43;
+{  int *idx = Q_INDEX(n);
    int i;
 
-   for(i=0; i<43; i++, w_idx+=88)
-     data[i] = frame[(w_idx % 2236) + offset];
-
-   data[43] = frame[2248 + n];
-   data[44] = frame[2300 + n];
+   for(i=0; i<Q_VECTOR_SIZE; i++)
+     data[i] = frame[idx[i]];
 }
 
 void SetQVector(unsigned char *frame, unsigned char *data, int n)
-{  int offset = 12 + (n & 1);
-   int w_idx  = (n&~1) * 43;
+{  int *idx = Q_INDEX(n);
    int i;
 
-   for(i=0; i<43; i++, w_idx+=88)
-     frame[(w_idx % 2236) + offset] = data[i];
-
-   frame[2248 + n] = data[43];
-   frame[2300 + n] = data[44];
+   for(i=0; i<Q_VECTOR_SIZE; i++)
+     frame[idx[i]] = data[i];
 }
 
 void FillQVector(unsigned char *frame, unsigned char data, int n)
-{  int offset = 12 + (n & 1);
-   int w_idx  = (n&~1) * 43;
+{  int *idx = Q_INDEX(n);
    int i;
 
-   for(i=0; i<43; i++, w_idx+=88)
-     frame[(w_idx % 2236) + offset] = data;
-
-   frame[2248 + n] = data;
-   frame[2300 + n] = data;
+   for(i=0; i<Q_VECTOR_SIZE; i++)
+     frame[idx[i]] = data;
 }
 
 void OrQVector(unsigned char *frame, unsigned char data, int n)
-{  int offset = 12 + (n & 1);
-   int w_idx  = (n&~1) * 43;
+{  int *idx = Q_INDEX(n);
    int i;
 
-   for(i=0; i<43; i++, w_idx+=88)
-     frame[(w_idx % 2236) + offset] |= data;
-
-   frame[2248 + n] |= data;
-   frame[2300 + n] |= data;
+   for(i=0; i<Q_VECTOR_SIZE; i++)
+     frame[idx[i]] |= data;
 }
 
 void AndQVector(unsigned char *frame, unsigned char data, int n)
-{  int offset = 12 + (n & 1);
-   int w_idx  = (n&~1) * 43;
+{  int *idx = Q_INDEX(n);
    int i;
 
-   for(i=0; i<43; i++, w_idx+=88)
-     frame[(w_idx % 2236) + offset] &= data;
-
-   frame[2248 + n] &= data;
-   frame[2300 + n] &= data;
+   for(i=0; i<Q_VECTOR_SIZE; i++)
+     frame[idx[i]] &= data;
 }
 
 /***
@@ -204,18 +223,28 @@ void AndQVector(unsigned char *frame, unsigned char data, int n)
  ***/
 
 int CountC2Errors(unsigned char *frame)
-{  int i,count = 0;
+{  guint64 word;
+   int i,count = 0;
+
    frame += 2352;
 
-   for(i=0; i<294; i++, frame++)
-   {  if(*frame & 0x01) count++;
-      if(*frame & 0x02) count++;
-      if(*frame & 0x04) count++;
-      if(*frame & 0x08) count++;
-      if(*frame & 0x10) count++;
-      if(*frame & 0x20) count++;
-      if(*frame & 0x40) count++;
-      if(*frame & 0x80) count++;
+   /* 294 bytes = 36 words + 6 bytes */
+
+   for(i=0; i<288; i+=8)
+   {  memcpy(&word, frame+i, 8);
+#ifdef __GNUC__
+      count += __builtin_popcountll(word);
+#else
+      for(; word; word &= word-1)
+	 count++;
+#endif
+   }
+
+   for(; i<294; i++)
+   {  int byte = frame[i];
+
+      for(; byte; byte &= byte-1)
+	 count++;
    }
 
    return count;
@@ -489,3 +518,280 @@ int DecodePQ(ReedSolomonTables *rt, unsigned char *data, int padding,
 }
 
 
+
+/***
+ *** Batched syndrome calculation and decoding
+ ***
+ * Byte i of P vector n sits at frame[12+86*i+n], so the i-th bytes of
+ * all 86 P vectors form a contiguous row of the frame. For the Q vectors
+ * the rows are gathered through the index table.
+ * The two L-EC syndromes of a vector are 
+ *   s0 = d[0] + d[1] + ... + d[n-1]   and
+ *   s1 = (...(d[0]*a + d[1])*a + ...)*a + d[n-1]   (a = alpha),
+ * which can be evaluated for eight vectors at once in a 64bit word.
+ * Multiplication by alpha over the L-EC field polynomial 0x11d
+ * amounts to a shift and a conditional xor with 0x1d per byte.
+ */
+
+#define BYTES_7F G_GUINT64_CONSTANT(0x7f7f7f7f7f7f7f7f)
+#define BYTES_01 G_GUINT64_CONSTANT(0x0101010101010101)
+
+static inline guint64 mul_alpha64(guint64 x)
+{  return ((x & BYTES_7F) << 1) ^ (((x >> 7) & BYTES_01) * 0x1d);
+}
+
+#define P_WORDS ((N_P_VECTORS+7)/8)
+#define Q_WORDS ((N_Q_VECTORS+7)/8)
+
+/*
+ * Calculate s0 and s1 for all P resp. Q vectors of a frame.
+ * s0, s1 must hold N_P_VECTORS resp. N_Q_VECTORS bytes.
+ */
+
+void PSyndromes(unsigned char *frame, unsigned char *s0, unsigned char *s1)
+{  guint64 row[P_WORDS], sum[P_WORDS], horner[P_WORDS];
+   int i,w;
+
+   memset(row, 0, sizeof(row));
+   memset(sum, 0, sizeof(sum));
+   memset(horner, 0, sizeof(horner));
+
+   for(i=0; i<P_VECTOR_SIZE; i++)
+   {  memcpy(row, frame+12+86*i, N_P_VECTORS);
+
+      for(w=0; w<P_WORDS; w++)
+      {  sum[w]   ^= row[w];
+	 horner[w] = mul_alpha64(horner[w]) ^ row[w];
+      }
+   }
+
+   memcpy(s0, sum, N_P_VECTORS);
+   memcpy(s1, horner, N_P_VECTORS);
+}
+
+void QSyndromes(unsigned char *frame, unsigned char *s0, unsigned char *s1)
+{  guint64 row[Q_WORDS], sum[Q_WORDS], horner[Q_WORDS];
+   unsigned char *row_bytes = (unsigned char*)row;
+   int i,q,w;
+
+   Q_INDEX_INIT();
+
+   memset(row, 0, sizeof(row));
+   memset(sum, 0, sizeof(sum));
+   memset(horner, 0, sizeof(horner));
+
+   for(i=0; i<Q_VECTOR_SIZE; i++)
+   {  for(q=0; q<N_Q_VECTORS; q++)
+	 row_bytes[q] = frame[q_index[q][i]];
+
+      for(w=0; w<Q_WORDS; w++)
+      {  sum[w]   ^= row[w];
+	 horner[w] = mul_alpha64(horner[w]) ^ row[w];
+      }
+   }
+
+   memcpy(s0, sum, N_Q_VECTORS);
+   memcpy(s1, horner, N_Q_VECTORS);
+}
+
+/*
+ * Decode all P resp. Q vectors of a frame without erasures.
+ * Only vectors with non-zero syndromes are passed to DecodePQ().
+ * For each vector, err[] receives the DecodePQ() result
+ * (0, 1 or negative for uncorrectable vectors). For err == 1, 
+ * pos[] and value[] receive the position and the corrected value of 
+ * the wrong byte. The frame itself is not changed.
+ * Returns the number of vectors with non-zero syndromes.
+ */
+
+static int decode_p_vectors(ReedSolomonTables *rt, unsigned char *frame, 
+			    unsigned char *s0, unsigned char *s1,
+			    int *err, int *pos, unsigned char *value)
+{  int p,count = 0;
+
+   for(p=0; p<N_P_VECTORS; p++)
+   {  unsigned char vector[P_VECTOR_SIZE];
+      int eras[2];
+
+      if(!s0[p] && !s1[p])
+      {  err[p] = 0;
+	 continue;
+      }
+
+      count++;
+      GetPVector(frame, vector, p);
+      err[p] = DecodePQ(rt, vector, P_PADDING, eras, 0);
+      if(err[p] == 1)
+      {  pos[p]   = eras[0];
+	 value[p] = vector[eras[0]];
+      }
+   }
+
+   return count;
+}
+
+static int decode_q_vectors(ReedSolomonTables *rt, unsigned char *frame, 
+			    unsigned char *s0, unsigned char *s1,
+			    int *err, int *pos, unsigned char *value)
+{  int q,count = 0;
+
+   for(q=0; q<N_Q_VECTORS; q++)
+   {  unsigned char vector[Q_VECTOR_SIZE];
+      int eras[2];
+
+      if(!s0[q] && !s1[q])
+      {  err[q] = 0;
+	 continue;
+      }
+
+      count++;
+      GetQVector(frame, vector, q);
+      err[q] = DecodePQ(rt, vector, Q_PADDING, eras, 0);
+      if(err[q] == 1)
+      {  pos[q]   = eras[0];
+	 value[q] = vector[eras[0]];
+      }
+   }
+
+   return count;
+}
+
+int DecodePVectors(ReedSolomonTables *rt, unsigned char *frame, 
+		   int *err, int *pos, unsigned char *value)
+{  unsigned char s0[N_P_VECTORS], s1[N_P_VECTORS];
+
+   PSyndromes(frame, s0, s1);
+   return decode_p_vectors(rt, frame, s0, s1, err, pos, value);
+}
+
+int DecodeQVectors(ReedSolomonTables *rt, unsigned char *frame, 
+		   int *err, int *pos, unsigned char *value)
+{  unsigned char s0[N_Q_VECTORS], s1[N_Q_VECTORS];
+
+   QSyndromes(frame, s0, s1);
+   return decode_q_vectors(rt, frame, s0, s1, err, pos, value);
+}
+
+/***
+ *** Incrementally maintained P/Q syndromes
+ ***
+ * A PQState tracks a frame together with the syndromes of all its
+ * P and Q vectors. Changing a byte through the PQState updates the
+ * syndromes of the one P and one Q vector containing it 
+ * (Q parity bytes are not part of any P vector):
+ * s0 changes by the byte difference d, and s1 by d * alpha^(n-1-i)
+ * for position i in a vector of length n.
+ * Callers can therefore ask for the state of any vector at no cost,
+ * and only need to run DecodePQ() on vectors which are known to be bad.
+ */
+
+void InitPQState(PQState *pq, GaloisTables *gt, unsigned char *frame)
+{
+   Q_INDEX_INIT();
+
+   pq->gt    = gt;
+   pq->frame = frame;
+   PSyndromes(frame, pq->pS0, pq->pS1);
+   QSyndromes(frame, pq->qS0, pq->qS1);
+}
+
+void PQStateSetByte(PQState *pq, int idx, unsigned char value)
+{  GaloisTables *gt = pq->gt;
+   int delta = pq->frame[idx] ^ value;
+   int log_delta;
+
+   if(!delta)
+      return;
+
+   pq->frame[idx] = value;
+   log_delta = gt->indexOf[delta];
+
+   if(byte_p[idx] >= 0)
+   {  int p = byte_p[idx];
+
+      pq->pS0[p] ^= delta;
+      pq->pS1[p] ^= gt->alphaTo[mod_fieldmax(log_delta + P_VECTOR_SIZE-1-byte_p_pos[idx])];
+   }
+
+   if(byte_q[idx] >= 0)
+   {  int q = byte_q[idx];
+
+      pq->qS0[q] ^= delta;
+      pq->qS1[q] ^= gt->alphaTo[mod_fieldmax(log_delta + Q_VECTOR_SIZE-1-byte_q_pos[idx])];
+   }
+}
+
+void PQStateSetPVector(PQState *pq, unsigned char *vector, int n)
+{  int i;
+
+   for(i=0; i<P_VECTOR_SIZE; i++)
+      PQStateSetByte(pq, 12+n+86*i, vector[i]);
+}
+
+void PQStateSetQVector(PQState *pq, unsigned char *vector, int n)
+{  int i;
+
+   Q_INDEX_INIT();
+
+   for(i=0; i<Q_VECTOR_SIZE; i++)
+      PQStateSetByte(pq, q_index[n][i], vector[i]);
+}
+
+/*
+ * Copy size bytes from new_frame into the tracked frame,
+ * updating the syndromes only for the bytes which differ.
+ */
+
+void PQStateCopyFrame(PQState *pq, unsigned char *new_frame, int size)
+{  int i;
+
+   memcpy(pq->frame, new_frame, 12);
+
+   for(i=12; i<CD_RAW_SECTOR_SIZE; i++)
+      if(pq->frame[i] != new_frame[i])
+	 PQStateSetByte(pq, i, new_frame[i]);
+
+   if(size > CD_RAW_SECTOR_SIZE)
+      memcpy(pq->frame+CD_RAW_SECTOR_SIZE, new_frame+CD_RAW_SECTOR_SIZE, size-CD_RAW_SECTOR_SIZE);
+}
+
+/*
+ * Same as DecodePVectors() resp. DecodeQVectors(),
+ * but taking the syndromes from the PQState.
+ */
+
+int PQStateDecodePVectors(ReedSolomonTables *rt, PQState *pq, 
+			  int *err, int *pos, unsigned char *value)
+{  return decode_p_vectors(rt, pq->frame, pq->pS0, pq->pS1, err, pos, value);
+}
+
+int PQStateDecodeQVectors(ReedSolomonTables *rt, PQState *pq, 
+			  int *err, int *pos, unsigned char *value)
+{  return decode_q_vectors(rt, pq->frame, pq->qS0, pq->qS1, err, pos, value);
+}
+
+/*
+ * Fetch P resp. Q vector n of the tracked frame into vector and
+ * run DecodePQ() on it without erasures. Vectors with zero syndromes
+ * are known to be good and are not decoded at all.
+ */
+
+int PQStateDecodePVector(ReedSolomonTables *rt, PQState *pq, int n,
+			 unsigned char *vector, int *erasure_list)
+{  
+   GetPVector(pq->frame, vector, n);
+   if(PVectorOK(pq, n))
+      return 0;
+
+   return DecodePQ(rt, vector, P_PADDING, erasure_list, 0);
+}
+
+int PQStateDecodeQVector(ReedSolomonTables *rt, PQState *pq, int n,
+			 unsigned char *vector, int *erasure_list)
+{  
+   GetQVector(pq->frame, vector, n);
+   if(QVectorOK(pq, n))
+      return 0;
+
+   return DecodePQ(rt, vector, Q_PADDING, erasure_list, 0);
+}
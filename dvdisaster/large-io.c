@@ -103,6 +103,47 @@ int LargeStat(char *path, guint64 *length_return)
    return TRUE;
 }
 
+/*
+ * Stat() variant for recognizing changes to a file:
+ * size, identity and the modification and status change times.
+ * The status change time is updated by the system on every write,
+ * so it also catches rewrites which preserve the modification time.
+ * Sub-second resolution is not available on all systems.
+ */
+
+int LargeFileStampGet(char *path, LargeFileStamp *stamp)
+{  struct stat mystat;
+   gchar *cp_path = os_path(path);
+
+   if(!cp_path) return FALSE;
+
+   if(stat(cp_path, &mystat) == -1)
+   {  g_free(cp_path);
+      return FALSE;
+   }
+   g_free(cp_path);
+
+   if(!S_ISREG(mystat.st_mode))
+      return FALSE;
+
+   memset(stamp, 0, sizeof(LargeFileStamp));
+   stamp->size   = mystat.st_size;
+   stamp->device = mystat.st_dev;
+   stamp->inode  = mystat.st_ino;
+   stamp->mtime  = mystat.st_mtime;
+   stamp->ctime  = mystat.st_ctime;
+
+#if defined(SYS_LINUX)
+   stamp->mtimeNsec = mystat.st_mtim.tv_nsec;
+   stamp->ctimeNsec = mystat.st_ctim.tv_nsec;
+#elif defined(SYS_FREEBSD) || defined(SYS_NETBSD) || defined(SYS_DARWIN)
+   stamp->mtimeNsec = mystat.st_mtimespec.tv_nsec;
+   stamp->ctimeNsec = mystat.st_ctimespec.tv_nsec;
+#endif
+
+   return TRUE;
+}
+
 /*
  * Stat() variant for testing directories
  */
@@ -0,0 +1,178 @@
+/*  dvdisaster: Additional error correction for optical media.
+ *  Copyright (C) 2004-2012 Carsten Gnoerlich.
+ *
+ *  Email: carsten@dvdisaster.org  -or-  cgnoerlich@fsfe.org
+ *  Project homepage: http://www.dvdisaster.org
+ *
+ *  This file is part of dvdisaster.
+ *
+ *  dvdisaster is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dvdisaster is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dvdisaster. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dvdisaster.h"
+
+#ifdef HAVE_SSE2
+  #include <emmintrin.h>
+#endif
+
+/***
+ *** MD5 over four independent streams using SSE2 intrinsics
+ ***
+ * Each 32bit lane of the SSE2 registers carries one MD5 context,
+ * so four contexts are advanced in lockstep by one pass over the
+ * MD5 rounds. See MD5UpdateMulti() in md5.c for the dispatcher.
+ */
+
+#ifdef HAVE_SSE2
+
+#define ROTL(x, s) _mm_or_si128(_mm_slli_epi32(x, s), _mm_srli_epi32(x, 32-(s)))
+
+#define G1(x, y, z) _mm_xor_si128(z, _mm_and_si128(x, _mm_xor_si128(y, z)))
+#define G2(x, y, z) G1(z, x, y)
+#define G3(x, y, z) _mm_xor_si128(_mm_xor_si128(x, y), z)
+#define G4(x, y, z) _mm_xor_si128(y, _mm_or_si128(x, _mm_xor_si128(z, ones)))
+
+#define MD5STEP4(f, w, x, y, z, k, t, s) \
+	( w = _mm_add_epi32(w, _mm_add_epi32(f(x, y, z), \
+			_mm_add_epi32(in[k], _mm_set1_epi32((gint32)t)))), \
+	  w = _mm_add_epi32(ROTL(w, s), x) )
+
+/*
+ * Process blocks*64 bytes from each of the four buffers.
+ * The contexts must not have any bytes pending; 
+ * the bit counts are left to the caller.
+ */
+
+void md5_transform_sse2(struct MD5Context **ctx, unsigned char **buf, unsigned blocks)
+{  const __m128i ones = _mm_set1_epi32(-1);
+   __m128i a, b, c, d;
+   __m128i in[16];
+   guint32 out[4][4];
+   unsigned off;
+   int i;
+
+   a = _mm_set_epi32(ctx[3]->buf[0], ctx[2]->buf[0], ctx[1]->buf[0], ctx[0]->buf[0]);
+   b = _mm_set_epi32(ctx[3]->buf[1], ctx[2]->buf[1], ctx[1]->buf[1], ctx[0]->buf[1]);
+   c = _mm_set_epi32(ctx[3]->buf[2], ctx[2]->buf[2], ctx[1]->buf[2], ctx[0]->buf[2]);
+   d = _mm_set_epi32(ctx[3]->buf[3], ctx[2]->buf[3], ctx[1]->buf[3], ctx[0]->buf[3]);
+
+   for(off=0; off<64*blocks; off+=64)
+   {  __m128i sa = a, sb = b, sc = c, sd = d;
+
+      /* Transpose the input so that in[k] holds word k of each lane */
+
+      for(i=0; i<16; i+=4)
+      {  __m128i r0 = _mm_loadu_si128((__m128i*)(buf[0]+off+4*i));
+	 __m128i r1 = _mm_loadu_si128((__m128i*)(buf[1]+off+4*i));
+	 __m128i r2 = _mm_loadu_si128((__m128i*)(buf[2]+off+4*i));
+	 __m128i r3 = _mm_loadu_si128((__m128i*)(buf[3]+off+4*i));
+	 __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+	 __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+	 __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+	 __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+	 in[i]   = _mm_unpacklo_epi64(t0, t1);
+	 in[i+1] = _mm_unpackhi_epi64(t0, t1);
+	 in[i+2] = _mm_unpacklo_epi64(t2, t3);
+	 in[i+3] = _mm_unpackhi_epi64(t2, t3);
+      }
+
+      MD5STEP4(G1, a, b, c, d, 0, 0xd76aa478, 7);
+      MD5STEP4(G1, d, a, b, c, 1, 0xe8c7b756, 12);
+      MD5STEP4(G1, c, d, a, b, 2, 0x242070db, 17);
+      MD5STEP4(G1, b, c, d, a, 3, 0xc1bdceee, 22);
+      MD5STEP4(G1, a, b, c, d, 4, 0xf57c0faf, 7);
+      MD5STEP4(G1, d, a, b, c, 5, 0x4787c62a, 12);
+      MD5STEP4(G1, c, d, a, b, 6, 0xa8304613, 17);
+      MD5STEP4(G1, b, c, d, a, 7, 0xfd469501, 22);
+      MD5STEP4(G1, a, b, c, d, 8, 0x698098d8, 7);
+      MD5STEP4(G1, d, a, b, c, 9, 0x8b44f7af, 12);
+      MD5STEP4(G1, c, d, a, b, 10, 0xffff5bb1, 17);
+      MD5STEP4(G1, b, c, d, a, 11, 0x895cd7be, 22);
+      MD5STEP4(G1, a, b, c, d, 12, 0x6b901122, 7);
+      MD5STEP4(G1, d, a, b, c, 13, 0xfd987193, 12);
+      MD5STEP4(G1, c, d, a, b, 14, 0xa679438e, 17);
+      MD5STEP4(G1, b, c, d, a, 15, 0x49b40821, 22);
+
+      MD5STEP4(G2, a, b, c, d, 1, 0xf61e2562, 5);
+      MD5STEP4(G2, d, a, b, c, 6, 0xc040b340, 9);
+      MD5STEP4(G2, c, d, a, b, 11, 0x265e5a51, 14);
+      MD5STEP4(G2, b, c, d, a, 0, 0xe9b6c7aa, 20);
+      MD5STEP4(G2, a, b, c, d, 5, 0xd62f105d, 5);
+      MD5STEP4(G2, d, a, b, c, 10, 0x02441453, 9);
+      MD5STEP4(G2, c, d, a, b, 15, 0xd8a1e681, 14);
+      MD5STEP4(G2, b, c, d, a, 4, 0xe7d3fbc8, 20);
+      MD5STEP4(G2, a, b, c, d, 9, 0x21e1cde6, 5);
+      MD5STEP4(G2, d, a, b, c, 14, 0xc33707d6, 9);
+      MD5STEP4(G2, c, d, a, b, 3, 0xf4d50d87, 14);
+      MD5STEP4(G2, b, c, d, a, 8, 0x455a14ed, 20);
+      MD5STEP4(G2, a, b, c, d, 13, 0xa9e3e905, 5);
+      MD5STEP4(G2, d, a, b, c, 2, 0xfcefa3f8, 9);
+      MD5STEP4(G2, c, d, a, b, 7, 0x676f02d9, 14);
+      MD5STEP4(G2, b, c, d, a, 12, 0x8d2a4c8a, 20);
+
+      MD5STEP4(G3, a, b, c, d, 5, 0xfffa3942, 4);
+      MD5STEP4(G3, d, a, b, c, 8, 0x8771f681, 11);
+      MD5STEP4(G3, c, d, a, b, 11, 0x6d9d6122, 16);
+      MD5STEP4(G3, b, c, d, a, 14, 0xfde5380c, 23);
+      MD5STEP4(G3, a, b, c, d, 1, 0xa4beea44, 4);
+      MD5STEP4(G3, d, a, b, c, 4, 0x4bdecfa9, 11);
+      MD5STEP4(G3, c, d, a, b, 7, 0xf6bb4b60, 16);
+      MD5STEP4(G3, b, c, d, a, 10, 0xbebfbc70, 23);
+      MD5STEP4(G3, a, b, c, d, 13, 0x289b7ec6, 4);
+      MD5STEP4(G3, d, a, b, c, 0, 0xeaa127fa, 11);
+      MD5STEP4(G3, c, d, a, b, 3, 0xd4ef3085, 16);
+      MD5STEP4(G3, b, c, d, a, 6, 0x04881d05, 23);
+      MD5STEP4(G3, a, b, c, d, 9, 0xd9d4d039, 4);
+      MD5STEP4(G3, d, a, b, c, 12, 0xe6db99e5, 11);
+      MD5STEP4(G3, c, d, a, b, 15, 0x1fa27cf8, 16);
+      MD5STEP4(G3, b, c, d, a, 2, 0xc4ac5665, 23);
+
+      MD5STEP4(G4, a, b, c, d, 0, 0xf4292244, 6);
+      MD5STEP4(G4, d, a, b, c, 7, 0x432aff97, 10);
+      MD5STEP4(G4, c, d, a, b, 14, 0xab9423a7, 15);
+      MD5STEP4(G4, b, c, d, a, 5, 0xfc93a039, 21);
+      MD5STEP4(G4, a, b, c, d, 12, 0x655b59c3, 6);
+      MD5STEP4(G4, d, a, b, c, 3, 0x8f0ccc92, 10);
+      MD5STEP4(G4, c, d, a, b, 10, 0xffeff47d, 15);
+      MD5STEP4(G4, b, c, d, a, 1, 0x85845dd1, 21);
+      MD5STEP4(G4, a, b, c, d, 8, 0x6fa87e4f, 6);
+      MD5STEP4(G4, d, a, b, c, 15, 0xfe2ce6e0, 10);
+      MD5STEP4(G4, c, d, a, b, 6, 0xa3014314, 15);
+      MD5STEP4(G4, b, c, d, a, 13, 0x4e0811a1, 21);
+      MD5STEP4(G4, a, b, c, d, 4, 0xf7537e82, 6);
+      MD5STEP4(G4, d, a, b, c, 11, 0xbd3af235, 10);
+      MD5STEP4(G4, c, d, a, b, 2, 0x2ad7d2bb, 15);
+      MD5STEP4(G4, b, c, d, a, 9, 0xeb86d391, 21);
+
+      a = _mm_add_epi32(a, sa);
+      b = _mm_add_epi32(b, sb);
+      c = _mm_add_epi32(c, sc);
+      d = _mm_add_epi32(d, sd);
+   }
+
+   _mm_storeu_si128((__m128i*)out[0], a);
+   _mm_storeu_si128((__m128i*)out[1], b);
+   _mm_storeu_si128((__m128i*)out[2], c);
+   _mm_storeu_si128((__m128i*)out[3], d);
+
+   for(i=0; i<4; i++)
+   {  ctx[i]->buf[0] = out[0][i];
+      ctx[i]->buf[1] = out[1][i];
+      ctx[i]->buf[2] = out[2][i];
+      ctx[i]->buf[3] = out[3][i];
+   }
+}
+
+#endif /* HAVE_SSE2 */
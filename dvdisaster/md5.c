@@ -283,6 +283,79 @@ void AsciiDigest(char *out, unsigned char *in)
    out[o] = 0;
 }
 
+/*
+ * Update n independent contexts with len bytes each.
+ * With SSE2, four contexts at a time are advanced in lockstep;
+ * contexts with pending bytes and the remaining tail of less 
+ * than 64 bytes go through the normal MD5Update().
+ */
+
+#if !defined(PNGPACK) && !defined(SIMPLE_MD5SUM)
+
+#ifdef HAVE_SSE2
+void md5_transform_sse2(struct MD5Context**, unsigned char**, unsigned);
+#endif
+
+void MD5UpdateMulti(struct MD5Context **ctx, unsigned char **buf, int n, unsigned len)
+{  int i = 0;
+
+#ifdef HAVE_SSE2
+   if(Closure->useSSE2 && len >= 64)
+   {  struct MD5Context dummy;
+      struct MD5Context *lane_ctx[4];
+      unsigned char *lane_buf[4];
+      unsigned done = len & ~63;
+
+      while(i < n)
+      {  int lanes = 0;
+	 int j;
+
+	 while(lanes < 4 && i < n)
+	 {  if(ctx[i]->bits[0] & 0x1ff)   /* bytes pending in context */
+	       MD5Update(ctx[i], buf[i], len);
+	    else
+	    {  lane_ctx[lanes] = ctx[i];
+	       lane_buf[lanes] = buf[i];
+	       lanes++;
+	    }
+	    i++;
+	 }
+
+	 if(!lanes)
+	    break;
+
+	 /* Fill up unused lanes */
+
+	 MD5Init(&dummy);
+	 for(j=lanes; j<4; j++)
+	 {  lane_ctx[j] = &dummy;
+	    lane_buf[j] = lane_buf[0];
+	 }
+
+	 md5_transform_sse2(lane_ctx, lane_buf, done >> 6);
+
+	 for(j=0; j<lanes; j++)
+	 {  struct MD5Context *c = lane_ctx[j];
+	    guint32 t = c->bits[0];
+
+	    if((c->bits[0] = t + ((guint32) done << 3)) < t)
+	       c->bits[1]++;
+	    c->bits[1] += done >> 29;
+
+	    MD5Update(c, lane_buf[j]+done, len-done);
+	 }
+      }
+
+      return;
+   }
+#endif
+
+   for(i=0; i<n; i++)
+      MD5Update(ctx[i], buf[i], len);
+}
+
+#endif
+
 /*
  * Wrapper for creating a simple md5sum binary.
  * This emulates "md5sum -b", as md5sum is not available per
@@ -17,5 +17,6 @@ void MD5Update(struct MD5Context *context, unsigned char const *buf,
 void MD5Final(unsigned char digest[16], struct MD5Context *context);
 
 void AsciiDigest(char*, unsigned char*);
+void MD5UpdateMulti(struct MD5Context**, unsigned char**, int, unsigned);
 
 #endif /* MD5_H */
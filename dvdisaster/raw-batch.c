@@ -0,0 +1,325 @@
+/*  dvdisaster: Additional error correction for optical media.
+ *  Copyright (C) 2004-2012 Carsten Gnoerlich.
+ *
+ *  Email: carsten@dvdisaster.org  -or-  cgnoerlich@fsfe.org
+ *  Project homepage: http://www.dvdisaster.org
+ *
+ *  This file is part of dvdisaster.
+ *
+ *  dvdisaster is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dvdisaster is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dvdisaster. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dvdisaster.h"
+
+/***
+ *** Offline recovery of raw sectors.
+ ***
+ * Runs the raw sector recovery over all sectors in the defective
+ * sector cache which are still missing in the image, so that the
+ * CPU bound heuristics do not have to hold up the drive.
+ * Sectors are distributed over Closure->codecThreads worker threads,
+ * each with its own RawBuffer. The cached samples of a sector are
+ * fed into TryCDFrameRecovery() one by one just like during reading.
+ * The time budget is passed down as the deadline of the RawBuffer,
+ * so that it is also observed between and within the heuristics.
+ * Since the sectors already keep all threads busy, the heuristics 
+ * are told not to start threads of their own.
+ */
+
+#define RAW_BATCH_DEFAULT_BUDGET 120  /* seconds per sector */
+
+enum
+{  BATCH_PENDING,
+   BATCH_PRESENT,       /* sector is already in the image */
+   BATCH_OUTSIDE,       /* sector is beyond the end of the image */
+   BATCH_RECOVERED,
+   BATCH_FAILED,
+   BATCH_TIMEOUT
+};
+
+typedef struct _raw_batch
+{  Image *image;
+   SectorMap *map;
+   RawSectorCache *cache;
+   GMutex *cacheLock;       /* protects cache */
+   GMutex *imageLock;       /* protects image and map */
+   GMutex *jobLock;         /* protects nextJob */
+
+   gint64 *lba;             /* sectors to work on */
+   int *status;             /* BATCH_* for each of them */
+   int *samples;            /* number of cached samples for each of them */
+   double *seconds;         /* time spent on each of them */
+   int nJobs;
+   int nextJob;
+
+   double budget;           /* seconds per sector */
+   guint8 mediumFP[16];
+   int validFP;
+} raw_batch;
+
+/*
+ * Work on a single sector
+ */
+
+static int recover_sector(raw_batch *rbt, RawBuffer *rb, int job,
+			  unsigned char *sector, GTimer *timer)
+{  unsigned char *samples;
+   gint64 lba = rbt->lba[job];
+   int n_samples,xa;
+   int i;
+
+   if(lba >= rbt->image->sectorSize)
+      return BATCH_OUTSIDE;
+
+   /* Skip sectors which are present in the image by now */
+
+   g_mutex_lock(rbt->imageLock);
+   if(!LargeSeek(rbt->image->file, 2048*lba))
+      Stop(_("Failed seeking to sector %lld in image: %s"), lba, strerror(errno));
+   if(LargeRead(rbt->image->file, sector, 2048) != 2048)
+      Stop(_("Failed reading sector %lld in image: %s"), lba, strerror(errno));
+   g_mutex_unlock(rbt->imageLock);
+
+   if(CheckForMissingSector(sector, lba, rbt->validFP ? rbt->mediumFP : NULL,
+			    FINGERPRINT_SECTOR) == SECTOR_PRESENT)
+      return BATCH_PRESENT;
+
+   /* Get the cached samples */
+
+   g_mutex_lock(rbt->cacheLock);
+   samples = GetCachedSectors(rbt->cache, lba, &n_samples, &xa);
+   g_mutex_unlock(rbt->cacheLock);
+
+   rbt->samples[job] = n_samples;
+
+   ResetRawBuffer(rb);
+   rb->lba        = lba;
+   rb->xaMode     = xa;
+   rb->dataOffset = xa ? 24 : 16;
+
+   /* Feed them into the recovery */
+
+   g_timer_start(timer);
+
+   for(i=0; i<n_samples; i++)
+   {  memcpy(rb->workBuf->buf, samples + i*CD_RAW_DUMP_SIZE, CD_RAW_DUMP_SIZE);
+
+      if(!TryCDFrameRecovery(rb, sector))
+      {  g_free(samples);
+	 return BATCH_RECOVERED;
+      }
+
+      if(g_timer_elapsed(timer, NULL) > rbt->budget)
+      {  g_free(samples);
+	 return BATCH_TIMEOUT;
+      }
+   }
+
+   g_free(samples);
+   return BATCH_FAILED;
+}
+
+static gpointer batch_worker(gpointer data)
+{  raw_batch *rbt = (raw_batch*)data;
+   RawBuffer *rb = CreateRawBuffer(MAX_RAW_TRANSFER_SIZE);
+   GTimer *timer = g_timer_new();
+   unsigned char sector[2048];
+
+   rb->validFP = rbt->validFP;
+   memcpy(rb->mediumFP, rbt->mediumFP, 16);
+   rb->threads       = 1;
+   rb->deadlineTimer = timer;
+   rb->deadline      = rbt->budget;
+
+   while(!Closure->stopActions)
+   {  int job,status;
+
+      g_mutex_lock(rbt->jobLock);
+      job = rbt->nextJob++;
+      g_mutex_unlock(rbt->jobLock);
+
+      if(job >= rbt->nJobs)
+	 break;
+
+      status = recover_sector(rbt, rb, job, sector, timer);
+      rbt->status[job]  = status;
+
+      /* The timer is only started once recovery begins */
+
+      if(status == BATCH_PRESENT || status == BATCH_OUTSIDE)
+           rbt->seconds[job] = 0.0;
+      else rbt->seconds[job] = g_timer_elapsed(timer, NULL);
+
+      if(status != BATCH_RECOVERED)
+	 continue;
+
+      /* Patch the recovered sector into the image */
+
+      g_mutex_lock(rbt->imageLock);
+      if(!LargeSeek(rbt->image->file, 2048*rbt->lba[job]))
+	 Stop(_("Failed seeking to sector %lld in image: %s"), rbt->lba[job], strerror(errno));
+      if(LargeWrite(rbt->image->file, sector, 2048) != 2048)
+	 Stop(_("Failed writing sector %lld to image: %s"), rbt->lba[job], strerror(errno));
+      if(rbt->map)
+	 SectorMapSet(rbt->map, rbt->lba[job], sector);
+      g_mutex_unlock(rbt->imageLock);
+   }
+
+   g_timer_destroy(timer);
+   FreeRawBuffer(rb);
+
+   return NULL;
+}
+
+/*
+ * Print the summary
+ */
+
+static void print_summary(raw_batch *rbt, double elapsed)
+{  int count[BATCH_TIMEOUT+1];
+   int samples = 0;
+   double busy = 0.0;
+   int i;
+
+   memset(count, 0, sizeof(count));
+   for(i=0; i<rbt->nJobs; i++)
+   {  count[rbt->status[i]]++;
+      samples += rbt->samples[i];
+      busy    += rbt->seconds[i];
+   }
+
+   PrintLog(_("\nRaw recovery summary:\n"
+	      "%8d sectors in defective sector cache (%d samples examined)\n"
+	      "%8d already present in image\n"
+	      "%8d beyond the end of the image\n"
+	      "%8d recovered and written to image\n"
+	      "%8d not recoverable\n"
+	      "%8d given up after %.0f seconds\n"),
+	    rbt->nJobs, samples,
+	    count[BATCH_PRESENT], count[BATCH_OUTSIDE],
+	    count[BATCH_RECOVERED], count[BATCH_FAILED],
+	    count[BATCH_TIMEOUT], rbt->budget);
+
+   if(count[BATCH_PENDING])
+      PrintLog(_("%8d not processed (aborted)\n"), count[BATCH_PENDING]);
+
+   PrintLog(_("Elapsed: %.1fs, recovery time %.1fs on %d threads.\n"),
+	    elapsed, busy, Closure->codecThreads);
+
+   if(count[BATCH_FAILED] + count[BATCH_TIMEOUT])
+   {  PrintLog(_("Unrecovered sectors:"));
+      for(i=0; i<rbt->nJobs; i++)
+	 if(rbt->status[i] == BATCH_FAILED || rbt->status[i] == BATCH_TIMEOUT)
+	    PrintLog(" %lld%s", rbt->lba[i], rbt->status[i] == BATCH_TIMEOUT ? "(t)" : "");
+      PrintLog("\n");
+   }
+}
+
+/*
+ * The offline recovery mode
+ */
+
+void RawRecoverImage(char *arg)
+{  raw_batch *rbt = g_malloc0(sizeof(raw_batch));
+   RawBuffer *rb;
+   GThread *thread[Closure->codecThreads];
+   SectorMap *probe;
+   GTimer *timer;
+   int i;
+
+   rbt->budget = arg ? atof(arg) : RAW_BATCH_DEFAULT_BUDGET;
+   if(rbt->budget <= 0)
+      Stop(_("--raw-recover: time budget must be positive"));
+
+   /* Open the image */
+
+   rbt->image = OpenImageFromFile(Closure->imageName, O_RDWR, IMG_PERMS);
+   if(!rbt->image)
+      Stop(_("Can't open %s:\n%s"), Closure->imageName, strerror(errno));
+
+   if(rbt->image->fpState == 2)
+   {  memcpy(rbt->mediumFP, rbt->image->imageFP, 16);
+      rbt->validFP = TRUE;
+   }
+
+   /* Keep an existing sector map up to date, but do not create one */
+
+   probe = OpenSectorMap(Closure->imageName, rbt->image->sectorSize, SECTOR_MAP_READONLY);
+   if(probe)
+   {  CloseSectorMap(probe);
+      rbt->map = OpenSectorMap(Closure->imageName, rbt->image->sectorSize, SECTOR_MAP_UPDATE);
+   }
+
+   /* Open the defective sector cache matching the image */
+
+   rb = CreateRawBuffer(MAX_RAW_TRANSFER_SIZE);
+   rb->validFP = rbt->validFP;
+   memcpy(rb->mediumFP, rbt->mediumFP, 16);
+   rbt->cache = OpenRawSectorCache(rb);
+   FreeRawBuffer(rb);
+
+   if(!rbt->cache)
+   {  PrintLog(_("No cached defective sectors for %s in %s.\n"),
+	       Closure->imageName, Closure->dDumpDir);
+      if(rbt->map) CloseSectorMap(rbt->map);
+      CloseImage(rbt->image);
+      g_free(rbt);
+      return;
+   }
+
+   rbt->lba     = CachedSectorList(rbt->cache, &rbt->nJobs);
+   rbt->status  = g_malloc0(rbt->nJobs*sizeof(int));
+   rbt->samples = g_malloc0(rbt->nJobs*sizeof(int));
+   rbt->seconds = g_malloc0(rbt->nJobs*sizeof(double));
+
+   PrintLog(_("Recovering %d cached sectors from %s into %s using %d threads.\n"),
+	    rbt->nJobs, rbt->cache->path, Closure->imageName, Closure->codecThreads);
+
+   /* Run the workers */
+
+   rbt->cacheLock = g_mutex_new();
+   rbt->imageLock = g_mutex_new();
+   rbt->jobLock   = g_mutex_new();
+   timer = g_timer_new();
+
+   for(i=0; i<Closure->codecThreads; i++)
+   {  GError *err = NULL;
+
+      thread[i] = g_thread_create(batch_worker, (gpointer)rbt, TRUE, &err);
+      if(!thread[i])
+	 Stop("Could not create raw recovery thread: %s", err->message);
+   }
+
+   for(i=0; i<Closure->codecThreads; i++)
+      g_thread_join(thread[i]);
+
+   print_summary(rbt, g_timer_elapsed(timer, NULL));
+
+   /* Clean up */
+
+   g_timer_destroy(timer);
+   g_mutex_free(rbt->cacheLock);
+   g_mutex_free(rbt->imageLock);
+   g_mutex_free(rbt->jobLock);
+
+   CloseRawSectorCache(rbt->cache);
+   if(rbt->map) CloseSectorMap(rbt->map);
+   CloseImage(rbt->image);
+
+   g_free(rbt->lba);
+   g_free(rbt->status);
+   g_free(rbt->samples);
+   g_free(rbt->seconds);
+   g_free(rbt);
+}
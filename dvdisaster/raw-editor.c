@@ -32,6 +32,8 @@ enum
    ACTION_BROWSE_SAVE,
    ACTION_BROWSE_PREV,
    ACTION_BROWSE_NEXT,
+   ACTION_BROWSE_PREV_LBA,
+   ACTION_BROWSE_NEXT_LBA,
    ACTION_SORT_BY_P,
    ACTION_SORT_BY_Q,
    ACTION_LOAD_BUFFER,
@@ -93,6 +95,10 @@ typedef struct _raw_editor_context
    int byteHeight;
 
    char *filepath;
+   RawSectorCache *cache;   /* raw sector store being browsed, if any */
+   gint64 *cacheLBAs;       /* sorted LBAs in the store */
+   int nCacheLBAs;
+   int cacheIdx;            /* index of the LBA currently shown */
    int p2,p1,q2,q1;         /* error states of P/Q vectors */
    int currentSample;
    int sectorChanged;
@@ -140,6 +146,9 @@ void FreeRawEditorContext(void *rptr)
    FreeRawBuffer(rec->rb);
    if(rec->filepath)
       g_free(rec->filepath);
+   if(rec->cache)
+      CloseRawSectorCache(rec->cache);
+   g_free(rec->cacheLBAs);
    g_free(rec->dsh);
    if(rec->rbInfo)
       g_free(rec->rbInfo);
@@ -280,7 +289,48 @@ static void calculate_failures(raw_editor_context *rec)
  ***/
 
 /*
- * raw sector file selection
+ * Show the samples just loaded into the raw buffer
+ */
+
+static void sector_loaded(raw_editor_context *rec)
+{
+   PrintPQStats(rec->rb);
+   memcpy(rec->rb->recovered, rec->rb->rawBuf[0], rec->rb->sampleSize);
+   memcpy(rec->undoRing[0], rec->rb->rawBuf[0], rec->rb->sampleSize);
+   rec->currentSample = 0;
+   calculate_failures(rec);
+   evaluate_vectors(rec);
+   render_sector(rec);
+}
+
+/*
+ * Load the current LBA from the raw sector store
+ */
+
+static void load_cached_sector(raw_editor_context *rec)
+{
+   ResetRawBuffer(rec->rb);
+   ReadCachedSectors(rec->dsh, rec->rb, rec->cache, rec->cacheLBAs[rec->cacheIdx]);
+   sector_loaded(rec);
+   SetLabelText(GTK_LABEL(rec->rightLabel), _("%s loaded, LBA %lld (%d of %d), %d samples."),
+		rec->filepath, rec->rb->lba, rec->cacheIdx+1, rec->nCacheLBAs, rec->rb->samplesRead);
+}
+
+static void close_cache(raw_editor_context *rec)
+{
+   if(rec->cache)
+      CloseRawSectorCache(rec->cache);
+   g_free(rec->cacheLBAs);
+
+   rec->cache = NULL;
+   rec->cacheLBAs = NULL;
+   rec->nCacheLBAs = 0;
+}
+
+/*
+ * raw sector file selection.
+ * Old style files hold one sector; 
+ * stores (*.rsc) hold all sectors of a medium which can be stepped through.
  */
 
 static void file_select_cb(GtkWidget *widget, gpointer data)
@@ -316,14 +366,28 @@ static void file_select_cb(GtkWidget *widget, gpointer data)
 	    g_free(rec->filepath);
 	 rec->filepath = g_strdup(gtk_file_selection_get_filename(GTK_FILE_SELECTION(rec->fileSel)));
 	 gtk_widget_hide(rec->fileSel);
+	 close_cache(rec);
+
+	 if(g_str_has_suffix(rec->filepath, ".rsc"))
+	 {  rec->cache = OpenRawSectorCacheFile(rec->rb, rec->filepath);
+	    if(!rec->cache)
+	       break;
+
+	    rec->cacheLBAs = CachedSectorList(rec->cache, &rec->nCacheLBAs);
+	    if(!rec->nCacheLBAs)
+	    {  close_cache(rec);
+	       Stop(_("%s contains no sectors."), rec->filepath);
+	       break;
+	    }
+
+	    rec->cacheIdx = 0;
+	    load_cached_sector(rec);
+	    break;
+	 }
+
 	 ResetRawBuffer(rec->rb);
 	 ReadDefectiveSectorFile(rec->dsh, rec->rb, rec->filepath);
-	 PrintPQStats(rec->rb);
-	 memcpy(rec->rb->recovered, rec->rb->rawBuf[0], rec->rb->sampleSize);
-	 memcpy(rec->undoRing[0], rec->rb->rawBuf[0], rec->rb->sampleSize);
-	 calculate_failures(rec);
-	 evaluate_vectors(rec);
-	 render_sector(rec);
+	 sector_loaded(rec);
 	 SetLabelText(GTK_LABEL(rec->rightLabel), _("%s loaded, LBA %lld, %d samples."),
 		      rec->filepath, rec->rb->lba, rec->rb->samplesRead);
 	 break;
@@ -875,6 +939,28 @@ static void action_cb(GtkWidget *widget, gpointer data)
 		      rec->currentSample, rec->rb->samplesRead);
 	 break;
 
+      case ACTION_BROWSE_PREV_LBA:
+	 if(!rec->cache)
+	    break;
+	 if(rec->cacheIdx)
+	      rec->cacheIdx--;
+	 else rec->cacheIdx = rec->nCacheLBAs-1;
+	 rec->sectorChanged = FALSE;
+	 load_cached_sector(rec);
+	 undo_remember(rec);
+	 break;
+
+      case ACTION_BROWSE_NEXT_LBA:
+	 if(!rec->cache)
+	    break;
+	 if(rec->cacheIdx<rec->nCacheLBAs-1)
+	      rec->cacheIdx++;
+	 else rec->cacheIdx = 0;
+	 rec->sectorChanged = FALSE;
+	 load_cached_sector(rec);
+	 undo_remember(rec);
+	 break;
+
       case ACTION_UNTAG:
 	 memset(rec->tags, 0, 2352);
 	 render_sector(rec);
@@ -1027,6 +1113,16 @@ void CreateRawEditor(void)
 		       (gpointer)ACTION_BROWSE_NEXT);
       gtk_box_pack_start(GTK_BOX(vbox2), button, FALSE, FALSE, 0);
 
+      button = gtk_button_new_with_label(_utf("button|Prev. LBA"));
+      g_signal_connect(G_OBJECT(button), "clicked", G_CALLBACK(action_cb), 
+		       (gpointer)ACTION_BROWSE_PREV_LBA);
+      gtk_box_pack_start(GTK_BOX(vbox1), button, FALSE, FALSE, 0);
+
+      button = gtk_button_new_with_label(_utf("button|Next LBA"));
+      g_signal_connect(G_OBJECT(button), "clicked", G_CALLBACK(action_cb), 
+		       (gpointer)ACTION_BROWSE_NEXT_LBA);
+      gtk_box_pack_start(GTK_BOX(vbox2), button, FALSE, FALSE, 0);
+
       button = gtk_button_new_with_label(_utf("button|Sort by P"));
       g_signal_connect(G_OBJECT(button), "clicked", G_CALLBACK(action_cb), 
 		       (gpointer)ACTION_SORT_BY_P);
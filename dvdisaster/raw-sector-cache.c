@@ -22,44 +22,10 @@
 
 #include "dvdisaster.h"
 
-/*
- * Write the raw dump header
- */
-
-static void init_defective_sector_file(char *path, RawBuffer *rb, LargeFile **file, DefectiveSectorHeader *dsh)
-{   int n;
-
-    *file = LargeOpen(path, O_RDWR | O_CREAT, IMG_PERMS);
-
-    if(!*file)
-       Stop(_("Could not open %s: %s"), path, strerror(errno));
-
-    memset(dsh, 0, sizeof(DefectiveSectorHeader));
-    dsh->lba        = rb->lba;
-    dsh->sectorSize = CD_RAW_DUMP_SIZE;
-
-    if(rb->xaMode)
-       dsh->properties |= DSH_XA_MODE;
-
-    if(rb->validFP)
-    {  memcpy(dsh->mediumFP, rb->mediumFP, 16);
-       dsh->properties |= DSH_HAS_FINGERPRINT;
-    }
-
-#ifdef HAVE_BIG_ENDIAN
-    SwapDefectiveHeaderBytes(dsh);
-#endif
-
-    n = LargeWrite(*file, dsh, sizeof(DefectiveSectorHeader));
-
-#ifdef HAVE_BIG_ENDIAN
-    SwapDefectiveHeaderBytes(dsh);
+#ifdef HAVE_MMAP
+  #include <sys/mman.h>
 #endif
 
-    if(n != sizeof(DefectiveSectorHeader))
-       Stop(_("Failed writing to defective sector file: %s"), strerror(errno));
-}
-
 /*
  * Open raw dump, read the header
  */
@@ -170,157 +136,514 @@ static void open_defective_sector_file(RawBuffer *rb, char *path, LargeFile **fi
     }
 }
 
+/***
+ *** Indexed raw sector cache store
+ ***
+ * All raw samples of defective sectors from one medium are kept
+ * in a single append-only file "<prefix><fingerprint>.rsc"
+ * (or "<prefix>unknown-<image name>.rsc" without a fingerprint).
+ * Each record holds one sample together with its LBA and the CRC32
+ * of its contents. At open time an in-memory index is built
+ * from the record headers which gives us
+ * - the chain of records belonging to a given LBA, and
+ * - a (LBA, CRC32) lookup table for detecting duplicate samples,
+ * so that neither saving nor retrying needs to reread all samples.
+ * Records are looked up through a read-only mapping of the file
+ * when mmap() is available.
+ *
+ * Like the sector map, the store is not portable between
+ * architectures of different byte order.
+ */
+
+#define RAW_CACHE_VERSION 1
+#define RAW_CACHE_BYTE_ORDER 0x01020304
+#define RAW_CACHE_DEDUP_SIZE (CD_RAW_DUMP_SIZE-1)  /* last byte holds the C2 flag */
+#define RAW_CACHE_INITIAL_TABLE 1024
+
+typedef struct _RawCacheHeader
+{  gint8 cookie[12];               /* "*dvdisaster*" */
+   gint8 method[4];                /* "RAWC" */
+   gint32 version;                 /* RAW_CACHE_VERSION */
+   guint32 byteOrder;              /* RAW_CACHE_BYTE_ORDER */
+   gint32 recordSize;              /* sizeof(RawCacheRecord) */
+   gint32 properties;              /* DSH_HAS_FINGERPRINT */
+   guint8 mediumFP[16];            /* Medium fingerprint */
+   gint8 padding[16];              /* pad to 64 bytes */
+} RawCacheHeader;
+
+typedef struct _RawCacheRecord
+{  aligned_gint64 lba;             /* LBA of this sample */
+   guint32 crc;                    /* CRC32 over the first RAW_CACHE_DEDUP_SIZE bytes */
+   gint32 properties;              /* DSH_XA_MODE */
+   unsigned char data[CD_RAW_DUMP_SIZE];
+} RawCacheRecord;
+
+typedef struct _RawCacheEntry
+{  gint64 lba;
+   guint32 crc;
+   gint32 prev;                    /* previous record for same LBA or -1 */
+   gint32 pass;                    /* last SaveDefectiveSector() call which saw it */
+} RawCacheEntry;
+
+static guint64 record_offset(gint64 idx)
+{  return sizeof(RawCacheHeader) + idx*sizeof(RawCacheRecord);
+}
+
+static guint32 hash_key(gint64 lba, guint32 crc)
+{  guint64 h = (guint64)lba * 0x9e3779b97f4a7c15ULL ^ crc;
+
+   h ^= h >> 29;
+   h *= 0xbf58476d1ce4e5b9ULL;
+   return (guint32)(h ^ (h >> 32));
+}
+
 /*
- * Append RawBuffer contents to defective sector dump
+ * Map the records into memory.
+ * Without mmap() or if mapping fails, records are read on demand.
  */
 
-int SaveDefectiveSector(RawBuffer *rb, int can_c2_scan)
-{  LargeFile *file;
-   DefectiveSectorHeader *dsh = alloca(sizeof(DefectiveSectorHeader));
-   unsigned char *cache_sectors = NULL;
-   char *filename;
-   guint64 length,offset;
-   int count=0;
-   int i,j,idx;
+static void unmap_records(RawSectorCache *rsc)
+{
+#ifdef HAVE_MMAP
+   if(rsc->base)
+      munmap(rsc->base, rsc->mapSize);
+#endif
+   rsc->base = NULL;
+   rsc->mappedRecords = 0;
+}
 
-   if(!rb->samplesRead) 
-     return 0;  /* Nothing to be done */
+static void map_records(RawSectorCache *rsc)
+{
+   unmap_records(rsc);
+
+#ifdef HAVE_MMAP
+   if(!rsc->nRecords)
+      return;
+
+   rsc->mapSize = record_offset(rsc->nRecords);
+   rsc->base = mmap(NULL, rsc->mapSize, PROT_READ, MAP_SHARED, rsc->file->fileHandle, 0);
+   if(rsc->base == MAP_FAILED)
+   {  rsc->base = NULL;
+      return;
+   }
+   rsc->mappedRecords = rsc->nRecords;
+#endif
+}
+
+/*
+ * Return a pointer to the given record.
+ * The pointer is only valid until the next call.
+ */
+
+static RawCacheRecord* get_record(RawSectorCache *rsc, gint64 idx)
+{
+#ifdef HAVE_MMAP
+   if(idx >= rsc->mappedRecords)
+      map_records(rsc);
 
-   /* Open cache file */
+   if(rsc->base)
+      return (RawCacheRecord*)(rsc->base + record_offset(idx));
+#endif
+
+   if(!LargeSeek(rsc->file, record_offset(idx)))
+      Stop(_("Failed seeking in defective sector file: %s"), strerror(errno));
+   if(LargeRead(rsc->file, rsc->scratch, sizeof(RawCacheRecord)) != sizeof(RawCacheRecord))
+      Stop(_("Failed reading from defective sector file: %s"), strerror(errno));
+
+   return rsc->scratch;
+}
+
+/*
+ * Index maintenance.
+ * Both tables use open addressing with linear probing
+ * and are kept at most half full.
+ * lbaTable holds the most recent record of each LBA; older
+ * ones are reached through the prev chain of the entries.
+ */
 
-   filename = g_strdup_printf("%s/%s%lld.raw", 
-			      Closure->dDumpDir, Closure->dDumpPrefix, 
-			      (long long)rb->lba);
+static gint32 lookup_lba(RawSectorCache *rsc, gint64 lba)
+{  guint32 slot = hash_key(lba, 0) & rsc->tableMask;
 
-   if(!LargeStat(filename, &length))
-   {  PrintCLIorLabel(Closure->status,_(" [Creating new cache file %s]\n"), filename);
-      init_defective_sector_file(filename, rb, &file, dsh);
+   while(rsc->lbaTable[slot] >= 0)
+   {  if(rsc->entry[rsc->lbaTable[slot]].lba == lba)
+	 return rsc->lbaTable[slot];
+      slot = (slot+1) & rsc->tableMask;
    }
-   else 
-   {  open_defective_sector_file(rb, filename, &file, dsh);
-      if(!file)
-	 Stop(_("Could not open %s: %s"), filename, strerror(errno));
+
+   return -1;
+}
+
+static void insert_index(RawSectorCache *rsc, gint32 idx)
+{  RawCacheEntry *e = &rsc->entry[idx];
+   guint32 slot;
+
+   slot = hash_key(e->lba, 0) & rsc->tableMask;
+   while(rsc->lbaTable[slot] >= 0 && rsc->entry[rsc->lbaTable[slot]].lba != e->lba)
+      slot = (slot+1) & rsc->tableMask;
+   rsc->lbaTable[slot] = idx;
+
+   slot = hash_key(e->lba, e->crc) & rsc->tableMask;
+   while(rsc->contentTable[slot] >= 0)
+      slot = (slot+1) & rsc->tableMask;
+   rsc->contentTable[slot] = idx;
+}
+
+static void rebuild_tables(RawSectorCache *rsc, guint32 size)
+{  gint32 i;
+
+   g_free(rsc->lbaTable);
+   g_free(rsc->contentTable);
+
+   rsc->tableMask    = size-1;
+   rsc->lbaTable     = g_malloc(size*sizeof(gint32));
+   rsc->contentTable = g_malloc(size*sizeof(gint32));
+   memset(rsc->lbaTable, 0xff, size*sizeof(gint32));
+   memset(rsc->contentTable, 0xff, size*sizeof(gint32));
+
+   for(i=0; i<rsc->nRecords; i++)   /* ascending, so lbaTable ends up at the newest */
+      insert_index(rsc, i);
+}
+
+static void add_entry(RawSectorCache *rsc, gint64 lba, guint32 crc)
+{  RawCacheEntry *e;
+
+   if(rsc->nRecords >= rsc->entriesMax)
+   {  rsc->entriesMax *= 2;
+      rsc->entry = g_realloc(rsc->entry, rsc->entriesMax*sizeof(RawCacheEntry));
    }
 
-   /* Read already cached sectors */
+   e = &rsc->entry[rsc->nRecords];
+   e->lba  = lba;
+   e->crc  = crc;
+   e->prev = lookup_lba(rsc, lba);
+   e->pass = rsc->pass;
 
-   if(dsh->nSectors > 0)
-   {  if(!LargeSeek(file, sizeof(DefectiveSectorHeader)))
-	 Stop(_("Failed seeking in defective sector file: %s"), strerror(errno));
+   rsc->nRecords++;
 
-      cache_sectors = g_malloc(dsh->sectorSize*dsh->nSectors);
-      for(i=0, idx=0; i<dsh->nSectors; i++, idx+=dsh->sectorSize)
-      {  int n=LargeRead(file, cache_sectors+idx, dsh->sectorSize);
-	 
-	 if(n != dsh->sectorSize)
-	    Stop(_("Failed reading from defective sector file: %s"), strerror(errno));
+   if(2*rsc->nRecords > rsc->tableMask)
+        rebuild_tables(rsc, 2*(rsc->tableMask+1));
+   else insert_index(rsc, rsc->nRecords-1);
+}
+
+/*
+ * Add the sample in rsc->record unless it is already in the store.
+ * Returns TRUE if the sample was appended.
+ */
+
+static int add_record(RawSectorCache *rsc)
+{  RawCacheRecord *rec = rsc->record;
+   guint32 slot;
+   int n;
+
+   rec->crc = Crc32(rec->data, RAW_CACHE_DEDUP_SIZE);
+
+   slot = hash_key(rec->lba, rec->crc) & rsc->tableMask;
+   while(rsc->contentTable[slot] >= 0)
+   {  gint32 idx = rsc->contentTable[slot];
+      RawCacheEntry *e = &rsc->entry[idx];
+
+      if(e->lba == rec->lba && e->crc == rec->crc
+	 && !memcmp(get_record(rsc, idx)->data, rec->data, RAW_CACHE_DEDUP_SIZE))
+      {  e->pass = rsc->pass;
+	 return FALSE;
       }
+      slot = (slot+1) & rsc->tableMask;
    }
 
-   /* Store sectors which are not already cached */
-   
-   offset = sizeof(DefectiveSectorHeader) + dsh->sectorSize*dsh->nSectors;
-   if(!LargeSeek(file, offset))
+   if(!LargeSeek(rsc->file, record_offset(rsc->nRecords)))
       Stop(_("Failed seeking in defective sector file: %s"), strerror(errno));
 
-   for(i=0; i<rb->samplesRead; i++)
-   {  int new_sector = TRUE;
+   n = LargeWrite(rsc->file, rec, sizeof(RawCacheRecord));
+   if(n != sizeof(RawCacheRecord))
+      Stop(_("Failed writing to defective sector file: %s"), strerror(errno));
 
-      /* See comment below on C2 mask field to understand rb->sampleSize-1 */
+   add_entry(rsc, rec->lba, rec->crc);
 
-      if(cache_sectors)  /* Sector already in cache? */
-      {  
-	 for(j=0, idx=0; j<dsh->nSectors; j++, idx+=dsh->sectorSize) 
-	 {  if(!memcmp(rb->rawBuf[i], cache_sectors+idx, rb->sampleSize-1))
-	    {  new_sector = FALSE;
-	       break;
-	    }
-	 }
-      }
+   return TRUE;
+}
 
-      for(j=0; j<i; j++) /* Some drives return cached data after first read */
-      {  if(!memcmp(rb->rawBuf[i], rb->rawBuf[j], rb->sampleSize-1))
-	 {  new_sector = FALSE;
-	    break;
-	 }
-      }
+/*
+ * Open or create the store for the current medium
+ */
+
+static void write_cache_header(RawSectorCache *rsc, RawCacheHeader *rch)
+{  
+   if(!LargeSeek(rsc->file, 0))
+      Stop(_("Failed seeking in defective sector file: %s"), strerror(errno));
+
+   if(LargeWrite(rsc->file, rch, sizeof(RawCacheHeader)) != sizeof(RawCacheHeader))
+      Stop(_("Failed writing to defective sector file: %s"), strerror(errno));
+}
 
-      if(new_sector)   /* same sector already in cache */
-      {  int n;
+/*
+ * The store is named after the medium fingerprint.
+ * Media without a fingerprint are told apart by the image name
+ * so that their sectors do not end up in a common store.
+ */
 
-        /* The C2 mask field is not used; so we put a flag into it
-	   to mark raw sectors containing C2 error information. */
+static char* cache_path(RawBuffer *rb)
+{  char fp[33];
+   char *base,*path;
+   int i;
 
-	 if(can_c2_scan)
-	    rb->rawBuf[i][CD_RAW_DUMP_SIZE-1] = 1;
+   if(rb->validFP)
+   {  for(i=0; i<16; i++)
+	 sprintf(fp+2*i, "%02x", rb->mediumFP[i]);
 
-	 n=LargeWrite(file, rb->rawBuf[i], dsh->sectorSize);
-	 
-	 if(n != dsh->sectorSize)
-	    Stop(_("Failed writing to defective sector file: %s"), strerror(errno));
-	 count++;
+      return g_strdup_printf("%s/%s%s.rsc", Closure->dDumpDir, Closure->dDumpPrefix, fp);
+   }
+
+   base = g_path_get_basename(Closure->imageName);
+   path = g_strdup_printf("%s/%sunknown-%s.rsc", Closure->dDumpDir, Closure->dDumpPrefix, base);
+   g_free(base);
+
+   return path;
+}
+
+/*
+ * Open the store at the given path, creating it if necessary.
+ * Takes over the path string.
+ */
+
+static RawSectorCache* open_raw_sector_cache(RawBuffer *rb, char *path)
+{  RawSectorCache *rsc = g_malloc0(sizeof(RawSectorCache));
+   RawCacheHeader rch;
+   guint64 length;
+   gint64 records;
+
+   rsc->path = path;
+
+   if(!LargeStat(rsc->path, &length))
+      length = 0;
+
+   rsc->file = LargeOpen(rsc->path, O_RDWR | O_CREAT, IMG_PERMS);
+   if(!rsc->file)
+      Stop(_("Could not open %s: %s"), rsc->path, strerror(errno));
+
+   /* Create a new store */
+
+   if(length < sizeof(RawCacheHeader))
+   {  PrintCLIorLabel(Closure->status,_(" [Creating new cache file %s]\n"), rsc->path);
+
+      memset(&rch, 0, sizeof(RawCacheHeader));
+      memcpy(rch.cookie, "*dvdisaster*", 12);
+      memcpy(rch.method, "RAWC", 4);
+      rch.version    = RAW_CACHE_VERSION;
+      rch.byteOrder  = RAW_CACHE_BYTE_ORDER;
+      rch.recordSize = sizeof(RawCacheRecord);
+      if(rb->validFP)
+      {  memcpy(rch.mediumFP, rb->mediumFP, 16);
+	 rch.properties |= DSH_HAS_FINGERPRINT;
       }
+      write_cache_header(rsc, &rch);
+      length = sizeof(RawCacheHeader);
    }
 
-   LargeClose(file);
+   /* or verify the existing one */
 
-   PrintCLIorLabel(Closure->status,
-		   _(" [Appended %d/%d sectors to cache file %s; LBA=%lld, ssize=%d, %d sectors]\n"), 
-		   count, rb->samplesRead, filename, dsh->lba, dsh->sectorSize, dsh->nSectors);
+   else
+   {  if(LargeRead(rsc->file, &rch, sizeof(RawCacheHeader)) != sizeof(RawCacheHeader))
+	 Stop(_("Failed reading from defective sector file: %s"), strerror(errno));
 
-   g_free(filename);
-   if(cache_sectors)
-      g_free(cache_sectors);
+      if(   strncmp((char*)rch.cookie, "*dvdisaster*", 12)
+	 || strncmp((char*)rch.method, "RAWC", 4)
+	 || rch.version != RAW_CACHE_VERSION
+	 || rch.byteOrder != RAW_CACHE_BYTE_ORDER
+	 || rch.recordSize != sizeof(RawCacheRecord))
+	 Stop(_("%s is not a usable raw sector cache file"), rsc->path);
 
-   return count;
+      if((rch.properties & DSH_HAS_FINGERPRINT) && rb->validFP
+	 && memcmp(rch.mediumFP, rb->mediumFP, 16))
+	 Stop(_("Fingerprints of medium and defective sector cache do not match!"));
+   }
+
+   if(rch.properties & DSH_HAS_FINGERPRINT)
+   {  memcpy(rsc->mediumFP, rch.mediumFP, 16);
+      rsc->validFP = TRUE;
+   }
+
+   /* A partially written record at the end is ignored
+      and will be overwritten by the next append. */
+
+   records         = (length-sizeof(RawCacheHeader))/sizeof(RawCacheRecord);
+   rsc->record     = g_malloc0(sizeof(RawCacheRecord));
+   rsc->scratch    = g_malloc(sizeof(RawCacheRecord));
+   rsc->entriesMax = RAW_CACHE_INITIAL_TABLE/2;
+   while(rsc->entriesMax <= records)
+      rsc->entriesMax *= 2;
+   rsc->entry = g_malloc(rsc->entriesMax*sizeof(RawCacheEntry));
+   rebuild_tables(rsc, 2*rsc->entriesMax);
+
+   /* Build the index from the record headers */
+
+   rsc->nRecords = records;
+   map_records(rsc);
+
+   for(rsc->nRecords=0; rsc->nRecords<records; )
+   {  RawCacheRecord *rec = get_record(rsc, rsc->nRecords);
+
+      add_entry(rsc, rec->lba, rec->crc);
+   }
+
+   return rsc;
+}
+void CloseRawSectorCache(RawSectorCache *rsc)
+{
+   unmap_records(rsc);
+   LargeClose(rsc->file);
+
+   g_free(rsc->path);
+   g_free(rsc->record);
+   g_free(rsc->scratch);
+   g_free(rsc->entry);
+   g_free(rsc->lbaTable);
+   g_free(rsc->contentTable);
+   g_free(rsc);
 }
 
 /*
- * Read sectors from the defective sector dump,
- * feed them into the raw buffer one by one
- * and retry recovery.
+ * Take over the samples from an old style per sector cache file.
+ * Only done while the store has no samples for that LBA,
+ * so each old file is read at most once.
  */
 
-int TryDefectiveSectorCache(RawBuffer *rb, unsigned char *outbuf)
+static void import_defective_sector_file(RawSectorCache *rsc, RawBuffer *rb)
 {  DefectiveSectorHeader dsh;
+   RawCacheRecord *rec = rsc->record;
    LargeFile *file;
    char *path;
-   int status;
-   int last_sector;
+   guint64 length;
+   int count = 0;
    int i;
 
    path = g_strdup_printf("%s/%s%lld.raw", 
 			  Closure->dDumpDir, Closure->dDumpPrefix, 
 			  (long long)rb->lba);
+
+   if(!LargeStat(path, &length))
+   {  g_free(path);
+      return;
+   }
+
    open_defective_sector_file(rb, path, &file, &dsh);
+   if(!file)
+      Stop(_("Could not open %s: %s"), path, strerror(errno));
+
+   if(dsh.sectorSize != CD_RAW_DUMP_SIZE)
+      Stop(_("Unsupported sector size %d in defective sector file %s"), dsh.sectorSize, path);
+
+   for(i=0; i<dsh.nSectors; i++)
+   {  memset(rec, 0, sizeof(RawCacheRecord));
+      if(LargeRead(file, rec->data, dsh.sectorSize) != dsh.sectorSize)
+	 Stop(_("Failed reading from defective sector file: %s"), strerror(errno));
+
+      rec->lba = dsh.lba;
+      rec->properties = dsh.properties & DSH_XA_MODE;
+      if(add_record(rsc))
+	 count++;
+   }
+
+   LargeClose(file);
+
+   PrintCLIorLabel(Closure->status,
+		   _(" [Imported %d/%d sectors from cache file %s]\n"), 
+		   count, dsh.nSectors, path);
    g_free(path);
+}
+
+/*
+ * Append RawBuffer contents to the defective sector cache
+ */
+
+int SaveDefectiveSector(RawBuffer *rb, int can_c2_scan)
+{  RawSectorCache *rsc;
+   RawCacheRecord *rec;
+   int count=0;
+   int i;
+
+   if(!rb->samplesRead) 
+     return 0;  /* Nothing to be done */
+
+   if(!rb->cache)
+      rb->cache = open_raw_sector_cache(rb, cache_path(rb));
+
+   rsc = rb->cache;
+   rec = rsc->record;
+
+   if(lookup_lba(rsc, rb->lba) < 0)
+      import_defective_sector_file(rsc, rb);
+
+   /* Samples seen in this pass are already in the RawBuffer;
+      TryDefectiveSectorCache() will skip them. */
+
+   rsc->pass++;
+
+   for(i=0; i<rb->samplesRead; i++)
+   {  memset(rec, 0, sizeof(RawCacheRecord));
+      rec->lba = rb->lba;
+      rec->properties = rb->xaMode ? DSH_XA_MODE : 0;
+      memcpy(rec->data, rb->rawBuf[i], MIN(rb->sampleSize, RAW_CACHE_DEDUP_SIZE));
 
-   if(!file)   /* No cache file */
+      /* The C2 mask field is not used; so we put a flag into it
+	 to mark raw sectors containing C2 error information. */
+
+      if(can_c2_scan)
+	 rec->data[CD_RAW_DUMP_SIZE-1] = 1;
+
+      /* Duplicates are dropped; this includes the cached data 
+	 some drives return after the first read. */
+
+      if(add_record(rsc))
+	 count++;
+   }
+
+   PrintCLIorLabel(Closure->status,
+		   _(" [Appended %d/%d sectors to cache file %s; LBA=%lld, %lld sectors]\n"), 
+		   count, rb->samplesRead, rsc->path, (long long)rb->lba, (long long)rsc->nRecords);
+
+   return count;
+}
+
+/*
+ * Feed the cached sectors from earlier passes 
+ * into the raw buffer one by one and retry recovery.
+ */
+
+int TryDefectiveSectorCache(RawBuffer *rb, unsigned char *outbuf)
+{  RawSectorCache *rsc = rb->cache;
+   int candidates = 0;
+   int tried = 0;
+   gint32 idx;
+
+   if(!rsc)   /* No cache file */
       return -1;
 
-   /* skip sectors added in current pass */
+   for(idx = lookup_lba(rsc, rb->lba); idx >= 0; idx = rsc->entry[idx].prev)
+      if(rsc->entry[idx].pass != rsc->pass)
+	 candidates++;
 
-   last_sector = dsh.nSectors - rb->samplesRead; 
+   if(!candidates)
+      return -1;
 
-   ReallocRawBuffer(rb, dsh.nSectors);
+   ReallocRawBuffer(rb, rb->samplesRead + candidates);
 
-   for(i=0; i<last_sector; i++)
-   {  int n;
-  
-      n = LargeRead(file, rb->workBuf->buf, dsh.sectorSize);
-      if(n != dsh.sectorSize)
-	 Stop(_("Failed reading from defective sector file: %s"), strerror(errno));
+   for(idx = lookup_lba(rsc, rb->lba); idx >= 0; idx = rsc->entry[idx].prev)
+   {  int status;
+
+      if(rsc->entry[idx].pass == rsc->pass)
+	 continue;
+
+      memcpy(rb->workBuf->buf, get_record(rsc, idx)->data, CD_RAW_DUMP_SIZE);
+      tried++;
 
       status = TryCDFrameRecovery(rb, outbuf);
       if(!status) 
       {  PrintCLIorLabel(Closure->status,
-			 " [Success after processing cached sector %d]\n", i+1);
+			 " [Success after processing cached sector %d]\n", tried);
 	 return status; 
       }
    }
 
-   LargeClose(file);
-   
    return -1;
 }
 
@@ -330,6 +653,7 @@ int TryDefectiveSectorCache(RawBuffer *rb, unsigned char *outbuf)
 
 void ReadDefectiveSectorFile(DefectiveSectorHeader *dsh, RawBuffer *rb, char *path)
 {  LargeFile *file;
+   int i;
 
    open_defective_sector_file(rb, path, &file, dsh);
    if(!file)
@@ -345,8 +669,11 @@ void ReadDefectiveSectorFile(DefectiveSectorHeader *dsh, RawBuffer *rb, char *pa
 
    ReallocRawBuffer(rb, dsh->nSectors);
 
-   for(rb->samplesRead=0; rb->samplesRead<dsh->nSectors; )
-   {  int n=LargeRead(file, rb->rawBuf[rb->samplesRead], dsh->sectorSize);
+   for(i=0; i<dsh->nSectors; i++)
+   {  int n;
+
+      ReserveRawSample(rb);
+      n=LargeRead(file, rb->rawBuf[rb->samplesRead], dsh->sectorSize);
 
       if(n != dsh->sectorSize)
       {  Stop(_("Failed reading from defective sector file: %s"), strerror(errno));
@@ -360,3 +687,185 @@ void ReadDefectiveSectorFile(DefectiveSectorHeader *dsh, RawBuffer *rb, char *pa
 
    LargeClose(file);
 }
+
+/***
+ *** Access to the whole cache for the offline recovery (raw-batch.c)
+ ***/
+
+/*
+ * Open the store for the medium described by rb->mediumFP, 
+ * taking over all old style per sector files from the dump directory.
+ * Returns NULL if there is neither a store nor an old style file.
+ */
+
+RawSectorCache* OpenRawSectorCache(RawBuffer *rb)
+{  RawSectorCache *rsc;
+   GDir *dir;
+   const char *name;
+   char *path;
+   gint64 *legacy = NULL;
+   int n_legacy = 0, max_legacy = 0;
+   int prefix_len = strlen(Closure->dDumpPrefix);
+   guint64 length;
+   int i;
+
+   /* Collect the old style "<prefix><lba>.raw" files */
+
+   dir = g_dir_open(Closure->dDumpDir, 0, NULL);
+   if(dir)
+   {  while((name = g_dir_read_name(dir)))
+      {  const char *digits = name + prefix_len;
+	 char *end;
+	 gint64 lba;
+
+	 if(strncmp(name, Closure->dDumpPrefix, prefix_len)
+	    || !isdigit((unsigned char)*digits))
+	    continue;
+
+	 lba = strtoll(digits, &end, 10);
+	 if(strcmp(end, ".raw"))
+	    continue;
+
+	 if(n_legacy >= max_legacy)
+	 {  max_legacy = max_legacy ? 2*max_legacy : 64;
+	    legacy = g_realloc(legacy, max_legacy*sizeof(gint64));
+	 }
+	 legacy[n_legacy++] = lba;
+      }
+      g_dir_close(dir);
+   }
+
+   path = cache_path(rb);
+   if(!LargeStat(path, &length) && !n_legacy)
+   {  g_free(path);
+      return NULL;
+   }
+
+   rsc = open_raw_sector_cache(rb, path);
+
+   for(i=0; i<n_legacy; i++)
+   {  rb->lba = legacy[i];
+      if(lookup_lba(rsc, rb->lba) < 0)
+	 import_defective_sector_file(rsc, rb);
+   }
+
+   g_free(legacy);
+   return rsc;
+}
+
+static int compare_lba(const void *a, const void *b)
+{  gint64 la = *(gint64*)a;
+   gint64 lb = *(gint64*)b;
+
+   if(la < lb) return -1;
+   if(la > lb) return 1;
+   return 0;
+}
+
+/*
+ * Return the sorted list of all LBAs in the store.
+ */
+
+gint64* CachedSectorList(RawSectorCache *rsc, int *n_out)
+{  gint64 *list = g_malloc((rsc->tableMask+1)*sizeof(gint64));
+   guint32 slot;
+   int n = 0;
+
+   for(slot=0; slot<=rsc->tableMask; slot++)
+      if(rsc->lbaTable[slot] >= 0)
+	 list[n++] = rsc->entry[rsc->lbaTable[slot]].lba;
+
+   qsort(list, n, sizeof(gint64), compare_lba);
+
+   *n_out = n;
+   return list;
+}
+
+/*
+ * Return a copy of all samples for the given LBA, oldest first.
+ * Each sample takes CD_RAW_DUMP_SIZE bytes.
+ */
+
+unsigned char* GetCachedSectors(RawSectorCache *rsc, gint64 lba, int *n_out, int *xa_out)
+{  unsigned char *buf;
+   gint32 idx;
+   int n = 0;
+
+   for(idx = lookup_lba(rsc, lba); idx >= 0; idx = rsc->entry[idx].prev)
+      n++;
+
+   buf = g_malloc(MAX(n,1)*CD_RAW_DUMP_SIZE);
+   *n_out  = n;
+   *xa_out = FALSE;
+
+   for(idx = lookup_lba(rsc, lba); idx >= 0; idx = rsc->entry[idx].prev)
+   {  RawCacheRecord *rec = get_record(rsc, idx);
+
+      memcpy(buf + (--n)*CD_RAW_DUMP_SIZE, rec->data, CD_RAW_DUMP_SIZE);
+      if(rec->properties & DSH_XA_MODE)
+	 *xa_out = TRUE;
+   }
+
+   return buf;
+}
+
+/***
+ *** Access to single sectors for the raw editor
+ ***/
+
+/*
+ * Open an existing store by its file name.
+ */
+
+RawSectorCache* OpenRawSectorCacheFile(RawBuffer *rb, char *path)
+{  guint64 length;
+
+   if(!LargeStat(path, &length))
+   {  Stop(_("Could not open %s: %s"), path, strerror(errno));
+      return NULL;
+   }
+
+   return open_raw_sector_cache(rb, g_strdup(path));
+}
+
+/*
+ * Read all samples of the given LBA from the store.
+ * This is the counterpart of ReadDefectiveSectorFile();
+ * dsh is filled in as if the samples came from an old style file.
+ */
+
+void ReadCachedSectors(DefectiveSectorHeader *dsh, RawBuffer *rb, RawSectorCache *rsc, gint64 lba)
+{  unsigned char *samples;
+   int n_samples,xa;
+   int i;
+
+   samples = GetCachedSectors(rsc, lba, &n_samples, &xa);
+
+   memset(dsh, 0, sizeof(DefectiveSectorHeader));
+   dsh->lba        = lba;
+   dsh->sectorSize = CD_RAW_DUMP_SIZE;
+   dsh->nSectors   = n_samples;
+   if(xa)
+      dsh->properties |= DSH_XA_MODE;
+   if(rsc->validFP)
+   {  memcpy(dsh->mediumFP, rsc->mediumFP, 16);
+      dsh->properties |= DSH_HAS_FINGERPRINT;
+   }
+
+   rb->lba        = lba;
+   rb->xaMode     = xa;
+   rb->dataOffset = xa ? 24 : 16;
+
+   ReallocRawBuffer(rb, n_samples);
+
+   for(i=0; i<n_samples; i++)
+   {  ReserveRawSample(rb);
+      memcpy(rb->rawBuf[rb->samplesRead], samples + i*CD_RAW_DUMP_SIZE, CD_RAW_DUMP_SIZE);
+
+      rb->samplesRead++;
+      UpdateFrameStats(rb);
+      CollectGoodVectors(rb);
+   }
+
+   g_free(samples);
+}
@@ -51,6 +51,7 @@ typedef struct
    unsigned char *buf;          /* buffer component from above */
    Bitmap *map;                 /* bitmap for keeping track of read sectors */
    CrcBuf *crcBuf;              /* preloaded CRC info from ecc data */
+   SectorMap *sectorMap;        /* persistent map of sectors present in image */
 
    unsigned char *fingerprint;  /* needed for missing sector */
    char *volumeLabel;           /* generation */
@@ -91,6 +92,19 @@ typedef struct
 
 } read_closure;
 
+/*
+ * Record a rewritten RS02 header (which spans two sectors) in the sector map
+ */
+
+static void map_rs02_header(read_closure *rc, guint64 hpos)
+{  unsigned char *eh = (unsigned char*)rc->eh;
+
+   if(!rc->sectorMap) return;
+
+   SectorMapSet(rc->sectorMap, hpos, eh);
+   SectorMapSet(rc->sectorMap, hpos+1, eh+2048);
+}
+
 static void cleanup(gpointer data)
 {  read_closure *rc = (read_closure*)data;
 
@@ -124,6 +138,7 @@ static void cleanup(gpointer data)
    
       if(LargeWrite(rc->image, rc->eh, sizeof(EccHeader)) != sizeof(EccHeader))
 	goto bail_out;
+      map_rs02_header(rc, lay->firstEccHeader);
 
       hpos = (lay->protectedSectors + lay->headerModulo - 1) / lay->headerModulo;
       hpos *= lay->headerModulo;
@@ -134,6 +149,7 @@ static void cleanup(gpointer data)
 
 	if(LargeWrite(rc->image, rc->eh, sizeof(EccHeader)) != sizeof(EccHeader))
 	  break;
+	map_rs02_header(rc, hpos);
 
 	hpos += lay->headerModulo;
       }
@@ -151,6 +167,14 @@ bail_out:
      if(!LargeClose(rc->image))
        Stop(_("Error closing image file:\n%s"), strerror(errno));
 
+   if(rc->sectorMap) CloseSectorMap(rc->sectorMap);
+
+   if(rc->dh && rc->dh->readProfile)
+   {  ExportReadProfile(rc->dh->readProfile, rc->dh, Closure->readProfile);
+      FreeReadProfile(rc->dh->readProfile);
+      rc->dh->readProfile = NULL;
+   }
+
    if(rc->medium) CloseImage(rc->medium);
  
    if(rc->ei) FreeEccInfo(rc->ei);
@@ -387,6 +411,8 @@ static void open_and_determine_mode(read_closure *rc)
 
    rc->medium = OpenImageFromDevice(Closure->device);
    rc->dh = rc->medium->dh;
+   if(Closure->readProfile)
+     rc->dh->readProfile = CreateReadProfile(rc->dh->sectors);
    rc->readMode = IMAGE_ONLY;
 
    /* save some useful information for the missing sector marker */
@@ -688,6 +714,177 @@ static void load_crc_buf(read_closure *rc)
    }
 }
 
+/*
+ * If a correctable sector <correctable> lies beyond rc->highestWrittenSector,
+ * fill the gap with dead sector markers.
+ * So when reading resumes there will be no holes in the image.
+ */
+
+void fill_correctable_gap(read_closure *rc, gint64 correctable)
+{  
+   if(correctable > rc->highestWrittenSector)
+   {  gint64 ds = rc->highestWrittenSector+1;
+      unsigned char buf[2048];
+
+      if(!LargeSeek(rc->image, (gint64)(2048*ds)))
+	Stop(_("Failed seeking to sector %lld in image [%s]: %s"),
+	     ds, "skip-corr", strerror(errno));
+
+      for(ds=rc->highestWrittenSector+1; ds<=correctable; ds++)
+      {  CreateMissingSector(buf, ds, rc->fingerprint, FINGERPRINT_SECTOR, rc->volumeLabel);
+	 if(LargeWrite(rc->image, buf, 2048) != 2048)
+	  Stop(_("Failed writing to sector %lld in image [%s]: %s"),
+	       ds, "skip-corr", strerror(errno));
+	 if(rc->sectorMap)
+	   SectorMapClear(rc->sectorMap, ds);
+      }
+      rc->highestWrittenSector = correctable;
+   }
+}
+
+/***
+ *** Determine correctable sectors
+ ***
+ * Ecc blocks are processed in groups of up to 64 adjacent blocks:
+ * For each layer the presence bits of all blocks in the group are
+ * fetched from rc->map as one word, and the present sectors are
+ * counted per block in bit-sliced counters (plane[i] holds bit i
+ * of the 64 counts). Only the missing sectors of blocks which turn
+ * out to be correctable are then visited one by one.
+ */
+
+/*
+ * Sector holding the given layer of ecc block pos; -1 for padding sectors
+ */
+
+static gint64 block_sector(read_closure *rc, int layer, gint64 pos)
+{
+   if(rc->readMode == ECC_IN_FILE)
+   {  gint64 sector = layer*rc->rs01LayerSectors + pos;
+
+      return sector < rc->ei->sectors ? sector : -1;
+   }
+
+   return RS02SectorIndex(rc->lay, layer, pos);
+}
+
+/*
+ * Presence bits of the given layer for blocks [pos..pos+n-1].
+ * valid receives the lanes which are not padding sectors;
+ * first the sector of lane 0 if the lanes map to a contiguous
+ * run of sectors, or -1 otherwise.
+ */
+
+static guint64 layer_word(read_closure *rc, int layer, gint64 pos, int n,
+			  guint64 *valid, gint64 *first)
+{  gint64 s0 = block_sector(rc, layer, pos);
+   gint64 s1 = block_sector(rc, layer, pos+n-1);
+   guint64 lanes = n < 64 ? ((guint64)1<<n)-1 : ~(guint64)0;
+   guint64 word = 0;
+   int b;
+
+   /* Contiguous sectors; the common case */
+
+   if(s0 >= 0 && s1 == s0+n-1)
+   {  *valid = lanes;
+      *first = s0;
+      return GetBitWord(rc->map, s0) & lanes;
+   }
+
+   /* Padding sectors only appear at the end of a layer */
+
+   *valid = 0;
+   *first = -1;
+
+   if(s0 < 0 && s1 < 0)
+      return 0;
+
+   /* Run crosses the padding area or an interleaved RS02 header */
+
+   for(b=0; b<n; b++)
+   {  gint64 sector = block_sector(rc, layer, pos+b);
+
+      if(sector >= 0)
+      {  *valid |= (guint64)1<<b;
+	 if(GetBit(rc->map, sector))
+	   word |= (guint64)1<<b;
+      }
+   }
+
+   return word;
+}
+
+/*
+ * Mark the missing sectors of blocks [pos..pos+n-1] (n <= 64)
+ * as visited if they can be corrected from the present ones.
+ */
+
+static void mark_correctable(read_closure *rc, gint64 pos, int n, int fill_gap)
+{  int layers = rc->readMode == ECC_IN_FILE ? rc->eh->dataBytes : 255;
+   int needed = layers - rc->eh->eccBytes;  /* present sectors needed for correction */
+   guint64 word[255], valid[255];
+   gint64 first[255];
+   guint64 plane[8];
+   guint64 lanes = n < 64 ? ((guint64)1<<n)-1 : ~(guint64)0;
+   guint64 correctable = 0;
+   int i,j,b;
+
+   /* Count available sectors; padding sectors count as available */
+
+   memset(plane, 0, sizeof(plane));
+
+   for(j=0; j<layers; j++)
+   {  guint64 carry;
+
+      word[j] = layer_word(rc, j, pos, n, &valid[j], &first[j]);
+      carry = (word[j] | ~valid[j]) & lanes;
+
+      for(i=0; i<8 && carry; i++)
+      {  guint64 c = plane[i] & carry;
+
+	 plane[i] ^= carry;
+	 carry = c;
+      }
+   }
+
+   for(b=0; b<n; b++)
+   {  int count = 0;
+
+      for(i=0; i<8; i++)
+	count |= ((plane[i]>>b) & 1) << i;
+
+      if(count >= needed)
+	correctable |= (guint64)1<<b;
+   }
+
+   if(!correctable)
+      return;
+
+   /* Mark the remaining sectors of correctable blocks as visited */
+
+   for(j=0; j<layers; j++)
+   {  guint64 missing = ~word[j] & valid[j] & correctable;
+
+      for(b=0; missing; b++, missing>>=1)
+	if(missing & 1)
+	{  gint64 sector = first[j] >= 0 ? first[j]+b : block_sector(rc, j, pos+b);
+
+	   SetBit(rc->map, sector);
+	   rc->correctable++;
+	   mark_sector(rc, sector, Closure->greenSector);
+#ifdef CHECK_VISITED
+	   rc->count[sector]++;
+#endif
+
+	   /* If the correctable sector lies beyond the highest written sector,
+	      fill the gap with dead sector markers */
+
+	   if(fill_gap)
+	      fill_correctable_gap(rc, sector);
+	}
+   }
+}
+
 /***
  *** Examine existing image file.
  ***
@@ -700,12 +897,16 @@ static void build_interval_from_image(read_closure *rc)
    int tail_included = FALSE;
    int last_percent = 0;
    int crc_result;
+   int use_map = rc->sectorMap && rc->sectorMap->resumed;
 
    /*** Rewind image file */
 
    LargeSeek(rc->image, 0);
    first_missing = last_missing = -1;
 
+   if(use_map)
+     PrintLog(_("Using sector map from previous session.\n"));
+
    /*** Go through all sectors in the image file.
 	Check them for "dead sector markers" 
 	and for checksum failures if ecc data is present. */
@@ -724,26 +925,43 @@ static void build_interval_from_image(read_closure *rc)
 	 cleanup((gpointer)rc);
       }
 
-      /* Read the next sector */
+      /* A sector map from the previous session already knows
+	 which sectors are present and their checksums. */
 
-      n = LargeRead(rc->image, rc->buf, 2048);
-      if(n != 2048) /* && (s != rc->sectors - 1 || n != ii->inLast)) */
-	Stop(_("premature end in image (only %d bytes): %s\n"),n,strerror(errno));
+      if(use_map)
+      {  current_missing = SectorMapPresent(rc->sectorMap, s) ? SECTOR_PRESENT : SECTOR_MISSING;
 
-      /* Look for the dead sector marker */
+	 if(current_missing)
+	   mark_sector(rc, s, Closure->redSector);
 
-      current_missing = CheckForMissingSector(rc->buf, s, NULL, 0);
-
-      if(current_missing)
-      {  mark_sector(rc, s, Closure->redSector);
-	 ExplainMissingSector(rc->buf, s, current_missing, TRUE);
+	 if(rc->crcBuf && !current_missing)
+	      crc_result = CheckCrcAgainstCrcBuffer(rc->crcBuf, s, rc->sectorMap->crc[s]);
+	 else crc_result = CRC_UNKNOWN;
       }
+      else
+      {  /* Read the next sector */
 
-      /* Compare checksums if available */
+	 n = LargeRead(rc->image, rc->buf, 2048);
+	 if(n != 2048) /* && (s != rc->sectors - 1 || n != ii->inLast)) */
+	   Stop(_("premature end in image (only %d bytes): %s\n"),n,strerror(errno));
 
-      if(rc->crcBuf)
-	   crc_result = CheckAgainstCrcBuffer(rc->crcBuf, s, rc->buf);
-      else crc_result = CRC_UNKNOWN;
+	 /* Look for the dead sector marker */
+
+	 current_missing = CheckForMissingSector(rc->buf, s, NULL, 0);
+
+	 if(current_missing)
+	 {  mark_sector(rc, s, Closure->redSector);
+	    ExplainMissingSector(rc->buf, s, current_missing, TRUE);
+	 }
+	 else if(rc->sectorMap)
+	    SectorMapSet(rc->sectorMap, s, rc->buf);
+
+	 /* Compare checksums if available */
+
+	 if(rc->crcBuf)
+	      crc_result = CheckAgainstCrcBuffer(rc->crcBuf, s, rc->buf);
+	 else crc_result = CRC_UNKNOWN;
+      }
 
       switch(crc_result)
       {  case CRC_GOOD:
@@ -827,71 +1045,15 @@ static void build_interval_from_image(read_closure *rc)
    /* RS01 type error correction. */
 
    if(rc->readMode == ECC_IN_FILE)
-   {  for(s=0; s<rc->rs01LayerSectors; s++)
-      {  gint64 layer_idx;
-	 int j,present=0;
-
-	 /* Count available sectors in each layer */
-	 
-	 layer_idx = s;
-	 for(j=0; j<rc->eh->dataBytes; j++)
-	 {  if(   layer_idx >= rc->ei->sectors  /* padding sector */
-	       || GetBit(rc->map, layer_idx))
-	       present++;
-
-	    layer_idx += rc->rs01LayerSectors;
-	 }
-
-	 /* See if remaining sectors are correctable */
-
-	 if(rc->eh->dataBytes-present <= rc->eh->eccBytes)
-	 {  layer_idx = s;
-	    for(j=0; j<rc->eh->dataBytes; j++)   /* mark them as visited */
-	    {  if(   layer_idx < rc->ei->sectors  /* skip padding sectors */
-	          && !GetBit(rc->map, layer_idx))
-	       {  SetBit(rc->map, layer_idx);
-		  rc->correctable++;
-#ifdef CHECK_VISITED
-		  rc->count[layer_idx]++;
-#endif
-		  mark_sector(rc, layer_idx, Closure->greenSector);
-	       }
-
-	       layer_idx += rc->rs01LayerSectors;
-	    }
-	 }
-      }
+   {  for(s=0; s<rc->rs01LayerSectors; s+=64)
+	 mark_correctable(rc, s, MIN(64, rc->rs01LayerSectors-s), FALSE);
    }
 
    /* RS02 type error correction. */
 
    if(rc->readMode == ECC_IN_IMAGE)
-   {  for(s=0; s<rc->lay->sectorsPerLayer; s++)
-      {  int j,sector,present=0;
-
-	 /* Count available sectors in each slice */
-	 
-	 for(j=0; j<255; j++)
-	 {  sector = RS02SectorIndex(rc->lay, j, s);
-	    if(   sector < 0  /* padding sector */ 
-	       || GetBit(rc->map, sector))
-	      present++;
-	 }
-
-	 /* See if remaining sectors are correctable */
-
-	 if(255-present <= rc->eh->eccBytes)
-	 {  for(j=0; j<255; j++)   /* mark them as visited */
-	    {  sector = RS02SectorIndex(rc->lay, j, s);
-	        if(   sector >= 0 /* don't mark the padding sector */
-		   && !GetBit(rc->map, sector))
-	       {  SetBit(rc->map, sector);
-		  rc->correctable++;
-		  mark_sector(rc, sector, Closure->greenSector);
-	       }
-	    }
-	 }
-      }
+   {  for(s=0; s<rc->lay->sectorsPerLayer; s+=64)
+	 mark_correctable(rc, s, MIN(64, rc->lay->sectorsPerLayer-s), FALSE);
    }
 
    /*** Tell user results of image file analysis */
@@ -1015,6 +1177,8 @@ void fill_gap(read_closure *rc)
      if(n != 2048)
        Stop(_("Failed writing to sector %lld in image [%s]: %s"),
 	    i, "fill", strerror(errno));
+     if(rc->sectorMap)
+       SectorMapClear(rc->sectorMap, i);
 
      /* Check whether user hit the Stop button */
 	     
@@ -1057,32 +1221,6 @@ void fill_gap(read_closure *rc)
 }
 
 
-/*
- * If a correctable sector <correctable> lies beyond rc->highestWrittenSector,
- * fill the gap with dead sector markers.
- * So when reading resumes there will be no holes in the image.
- */
-
-void fill_correctable_gap(read_closure *rc, gint64 correctable)
-{  
-   if(correctable > rc->highestWrittenSector)
-   {  gint64 ds = rc->highestWrittenSector+1;
-      unsigned char buf[2048];
-
-      if(!LargeSeek(rc->image, (gint64)(2048*ds)))
-	Stop(_("Failed seeking to sector %lld in image [%s]: %s"),
-	     ds, "skip-corr", strerror(errno));
-
-      for(ds=rc->highestWrittenSector+1; ds<=correctable; ds++)
-      {  CreateMissingSector(buf, ds, rc->fingerprint, FINGERPRINT_SECTOR, rc->volumeLabel);
-	 if(LargeWrite(rc->image, buf, 2048) != 2048)
-	  Stop(_("Failed writing to sector %lld in image [%s]: %s"),
-	       ds, "skip-corr", strerror(errno));
-      }
-      rc->highestWrittenSector = correctable;
-   }
-}
-
 /*
  * The adaptive read strategy 
  */
@@ -1091,6 +1229,7 @@ void ReadMediumAdaptive(gpointer data)
 {  read_closure *rc;
    guint64 s;
    guint64 image_file_size;
+   gint64 stats_start;
    int status,i,n;
 
    /*** Initialize the read closure. */
@@ -1182,6 +1321,10 @@ reopen_image:
       /* Preload the CRC buffer */
 
       load_crc_buf(rc);
+
+      /* Start a new sector map */
+
+      rc->sectorMap = OpenSectorMap(Closure->imageName, rc->sectors, SECTOR_MAP_UPDATE);
    }
 
    /*** else examine the existing image file ***/
@@ -1214,6 +1357,10 @@ reopen_image:
 
       load_crc_buf(rc);
 
+      /* Pick up the sector map from a previous session */
+
+      rc->sectorMap = OpenSectorMap(Closure->imageName, rc->sectors, SECTOR_MAP_UPDATE);
+
       /* Build the interval list */
 
       build_interval_from_image(rc);
@@ -1262,7 +1409,7 @@ reopen_image:
       print_progress(rc, TRUE);
 
       for(s=rc->intervalStart; s<=rc->intervalEnd; ) /* s is incremented elsewhere */
-      {  int nsectors,cnt;
+      {  int nsectors;
  
 	 if(Closure->stopActions)          /* somebody hit the Stop button */
 	 {  if(Closure->guiMode)
@@ -1289,29 +1436,29 @@ reopen_image:
 	    ecc information. */
 
 	 if(rc->map)
-	 {  for(i=cnt=0; i<nsectors; i++)  /* sectors already present? */
-	    {  int idx = s+i;
+	 {  /* Shift the outer loop down to 1 sector per read
+	       if some of the sectors are already present. */
 
-	       if(GetBit(rc->map, idx))
-		 cnt++;
-	    }
-
-	    /* Shift the outer loop down to 1 sector per read.
-	       Short circuit the outer loop if the sector is already present. */
+	    if(FindSetBitInRange(rc->map, s, s+nsectors-1) >= 0)
+	       nsectors = 1;
 
-	    if(cnt) 
-	    {  nsectors = 1;
+	    /* Short circuit the outer loop over the run of present sectors. */
 
-	       if(GetBit(rc->map, s))
-	       {  s++;
-		  continue;  /* restart reading loop with next sector */
-	       }
+	    if(GetBit(rc->map, s))
+	    {  s = FindNextClearBit(rc->map, s);
+	       if(s > rc->intervalEnd) 
+		  s = rc->intervalEnd+1;
+	       continue;  /* restart reading loop with next missing sector */
 	    }
 	 }
 
 	 /* Try to actually read the next sector(s) */
 reread:
+	 stats_start = StatsTimestamp();
 	 status = ReadSectors(rc->dh, rc->buf, s, nsectors);
+	 StatsTime(STAT_IO_WAIT, stats_start);
+	 if(status) StatsCount(STAT_READ_ERRORS, 1);
+	 else       StatsCount(STAT_BYTES_READ, 2048*nsectors);
 
 	 /* Medium Error (3) and Illegal Request (5) may result from 
 	    a medium read problem, but other errors are regarded as fatal. */
@@ -1368,13 +1515,20 @@ reread:
 	    for(i=0, b=s; i<nsectors; i++,b++)
 	    {  int result;
 	       int err;
+	       guint32 crc = 0;
 
 	       /* Calculate and compare CRC sums.
 		  Sectors with bad CRC sums are marked unvisited,
 		  but do not terminate the current interval. */
 
+	       if(rc->crcBuf || rc->sectorMap)
+	       {  stats_start = StatsTimestamp();
+		  crc = Crc32(rc->buf+i*2048, 2048);
+		  StatsTime(STAT_CRC, stats_start);
+	       }
+
 	       if(rc->crcBuf) /* we have crc information */
-		    result = CheckAgainstCrcBuffer(rc->crcBuf, b, rc->buf+i*2048);
+		    result = CheckCrcAgainstCrcBuffer(rc->crcBuf, b, crc);
 	       else result = CRC_UNKNOWN;
 
 	       switch(result)
@@ -1393,6 +1547,8 @@ reread:
 		     if(n != 2048)
 			Stop(_("Failed writing to sector %lld in image [%s]: %s"),
 			     b, "unv", strerror(errno));
+		     if(rc->sectorMap)
+			SectorMapSetCrc(rc->sectorMap, b, crc);
 
 		     mark_sector(rc, b, Closure->yellowSector);
 		     
@@ -1406,6 +1562,8 @@ reread:
 		     if(n != 2048)
 			Stop(_("Failed writing to sector %lld in image [%s]: %s"),
 			     b, "store", strerror(errno));
+		     if(rc->sectorMap)
+			SectorMapSetCrc(rc->sectorMap, b, crc);
 
 		     if(rc->map)
 			SetBit(rc->map, b);
@@ -1428,6 +1586,8 @@ reread:
 
 		  if(rc->map)  /* Avoids confusion in the ecc stage */
 		     ClearBit(rc->map, b);
+		  if(rc->sectorMap)
+		     SectorMapClear(rc->sectorMap, b);
 		  rc->readable--;
 	       }
 	    }
@@ -1435,82 +1595,35 @@ reread:
 	    /* See if additional sectors become correctable. */
 	    
 	    if(rc->readMode == ECC_IN_FILE)  /* RS01 type ecc data */
-	    {  for(i=0, b=s; i<nsectors; i++,b++) 
-	       {  int j,present=0;
-		  gint64 layer_idx;
-
-#ifdef CHECK_VISITED
-		  rc->count[b]++;
-#endif
-		  /* Count available sectors. */
-
-		  layer_idx = b % rc->rs01LayerSectors;
-		  for(j=0; j<rc->eh->dataBytes; j++) 
-		  {  if(   layer_idx >= rc->ei->sectors /* padding sector */
-			|| GetBit(rc->map, layer_idx))
-			present++;
-		     layer_idx += rc->rs01LayerSectors;
-		  }
-
-		  /* If the remaining sectors are correctable,
-		     mark them as visited. */
-
-		  if(rc->eh->dataBytes-present <= rc->eh->eccBytes)
-		  {  layer_idx = b % rc->rs01LayerSectors;
+	    {  int run;
 
-		     for(j=0; j<rc->eh->dataBytes; j++)
-		     {  if(   layer_idx < rc->ei->sectors /* skip padding sector */
-			   && !GetBit(rc->map, layer_idx))
-			{  SetBit(rc->map, layer_idx);
-			   rc->correctable++;
-			   mark_sector(rc, layer_idx, Closure->greenSector);
+	       for(i=0; i<nsectors; i+=run) 
+	       {  gint64 pos = (s+i) % rc->rs01LayerSectors;
 
+		  run = MIN(nsectors-i, MIN(64, rc->rs01LayerSectors-pos));
 #ifdef CHECK_VISITED
-			   rc->count[layer_idx]++;
+		  for(b=s+i; b<s+i+run; b++)
+		     rc->count[b]++;
 #endif
-
-			   /* If the correctable sector lies beyond the highest written sector,
-			      fill the gap with dead sector markers */
-
-			   fill_correctable_gap(rc, layer_idx);
-
-			}
-		        layer_idx += rc->rs01LayerSectors;
-		     }
-		  }
+		  mark_correctable(rc, pos, run, TRUE);
 	       }
 	    }
 
 	    if(rc->readMode == ECC_IN_IMAGE)  /* RS02 type ecc data */
-	    {  for(i=0, b=s; i<nsectors; i++,b++) 
-	       {  int j,present=0;
-		  gint64 slice_idx, ignore, sector;
-
-		  /* Count available sectors. */
-
-		  RS02SliceIndex(rc->lay, b, &ignore, &slice_idx);
-		  for(j=0; j<255; j++) 
-		  {  sector = RS02SectorIndex(rc->lay, j, slice_idx);
-		     if(   sector < 0  /* padding sector */ 
-			|| GetBit(rc->map, sector))
-			present++;
-		  }
+	    {  int run;
+
+	       /* Group sectors belonging to adjacent ecc blocks */
 
-		  /* If the remaining sectors are correctable,
-		     mark them as visited. */
-
-		  if(255-present <= rc->eh->eccBytes)
-		  {  for(j=0; j<255; j++)
-		     {  sector = RS02SectorIndex(rc->lay, j, slice_idx);
-		        if(   sector >= 0 /* don't mark the padding sector */
-			   && !GetBit(rc->map, sector))
-			{  SetBit(rc->map, sector);
-			   rc->correctable++;
-			   mark_sector(rc, sector, Closure->greenSector);
-			   fill_correctable_gap(rc, sector);
-			}
-		     }
+	       for(i=0; i<nsectors; i+=run) 
+	       {  gint64 pos, next, ignore;
+
+		  RS02SliceIndex(rc->lay, s+i, &ignore, &pos);
+		  for(run=1; run<64 && i+run<nsectors; run++)
+		  {  RS02SliceIndex(rc->lay, s+i+run, &ignore, &next);
+		     if(next != pos+run) break;
 		  }
+
+		  mark_correctable(rc, pos, run, TRUE);
 	       }
 	    }
 
@@ -1564,6 +1677,8 @@ reread:
 	       if(n != 2048)
 		 Stop(_("Failed writing to sector %lld in image [%s]: %s"),
 		      s, "nds", strerror(errno));
+	       if(rc->sectorMap)
+		 SectorMapClear(rc->sectorMap, s+i);
 
 	       mark_sector(rc, s+i, Closure->redSector);
 	    }
@@ -113,6 +113,13 @@ static void cleanup(gpointer data)
    if(rc->writerImage)   
      if(!LargeClose(rc->writerImage))
        Stop(_("Error closing image file:\n%s"), strerror(errno));
+   if(rc->sectorMap) CloseSectorMap(rc->sectorMap);
+
+   if(rc->dh && rc->dh->readProfile)
+   {  ExportReadProfile(rc->dh->readProfile, rc->dh, Closure->readProfile);
+      FreeReadProfile(rc->dh->readProfile);
+      rc->dh->readProfile = NULL;
+   }
 
    if(rc->image)   CloseImage(rc->image);
    if(rc->ei)      FreeEccInfo(rc->ei);
@@ -326,6 +333,7 @@ reopen_image:
       }
       rc->rereading  = FALSE;
       rc->readMarker = 0;
+      rc->sectorMap  = OpenSectorMap(Closure->imageName, rc->sectors, SECTOR_MAP_UPDATE);
 
       if(Closure->guiMode)
 	 InitializeCurve(rc, rc->dh->maxRate, rc->dh->canC2Scan);
@@ -394,6 +402,10 @@ reopen_image:
       }
    }
 
+   /*** Pick up the sector map from a previous session */
+
+   rc->sectorMap = OpenSectorMap(Closure->imageName, rc->sectors, SECTOR_MAP_UPDATE);
+
    /*** If the image is not complete yet, first aim to read the
 	unvisited sectors before trying to re-read the missing ones.
         Exception: We must start from the beginning if multiple reading passes are requested. */
@@ -443,6 +455,8 @@ static void fill_gap(read_closure *rc)
 	 if(n != 2048)
 	   Stop(_("Failed writing to sector %lld in image [%s]: %s"),
 		s, "fill", strerror(errno));
+	 if(rc->sectorMap)
+	   SectorMapClear(rc->sectorMap, s);
 	 s++;
       }
    }
@@ -573,6 +587,8 @@ static void show_progress(read_closure *rc)
 	 double elapsed = g_timer_elapsed(rc->speedTimer, &ignore);
 	 double kb_sec  = kb_read / elapsed;
 	 
+	 StatsGauge(STAT_READ_SPEED, (gint64)kb_sec);
+
 	 if(Closure->readErrors - rc->previousReadErrors > 0)
 	    color = 2;
 	 else if(Closure->crcErrors - rc->previousCRCErrors > 0)
@@ -651,6 +667,7 @@ static void show_progress(read_closure *rc)
 
 static gpointer worker_thread(read_closure *rc)
 {  gint64 s;
+   gint64 stats_start;
    int nsectors;
    int i;
 
@@ -678,6 +695,7 @@ static gpointer worker_thread(read_closure *rc)
       if(!rc->scanMode)
       {  int n;
 
+	 stats_start = StatsTimestamp();
 	 if(!LargeSeek(rc->writerImage, (gint64)(2048*s)))
 	 {  rc->workerError = g_strdup_printf(_("Failed seeking to sector %lld in image [%s]: %s"),
 					      s, "store", strerror(errno));
@@ -690,12 +708,32 @@ static gpointer worker_thread(read_closure *rc)
 	                                      s, "store", strerror(errno));
 	    goto update_mutex;
 	 }
+	 StatsTime(STAT_FLUSH, stats_start);
+	 StatsCount(STAT_BYTES_WRITTEN, n);
 
 	 /* On-the-fly CRC calculation */
 
 	 if(Closure->crcCache)
-	 {  for(i=0; i<nsectors; i++)
+	 {  stats_start = StatsTimestamp();
+	    for(i=0; i<nsectors; i++)
 	       Closure->crcCache[s+i] = Crc32(rc->alignedBuf[rc->writePtr]->buf+2048*i, 2048);
+	    StatsTime(STAT_CRC, stats_start);
+	 }
+
+	 /* Keep the sector map up to date. 
+	    The reader thread populates it, too, so we need the mutex. */
+
+	 if(rc->sectorMap)
+	 {  g_mutex_lock(rc->mutex);
+	    for(i=0; i<nsectors; i++)
+	    {  if(rc->bufState[rc->writePtr] == BUF_DEAD)
+		  SectorMapClear(rc->sectorMap, s+i);
+	       else if(Closure->crcCache)
+		  SectorMapSetCrc(rc->sectorMap, s+i, Closure->crcCache[s+i]);
+	       else 
+		  SectorMapSet(rc->sectorMap, s+i, rc->alignedBuf[rc->writePtr]->buf+2048*i);
+	    }
+	    g_mutex_unlock(rc->mutex);
 	 }
       }
 
@@ -782,6 +820,7 @@ void ReadMediumLinear(gpointer data)
    char *t = NULL;
    int status,n;
    int tao_tail;
+   gint64 stats_start;
    int i;
 
    /*** This value might be temporarily changed later. */
@@ -812,6 +851,8 @@ void ReadMediumLinear(gpointer data)
 
    rc->image = OpenImageFromDevice(Closure->device);
    rc->dh = rc->image->dh;
+   if(Closure->readProfile)
+     rc->dh->readProfile = CreateReadProfile(rc->dh->sectors);
    rc->sectors = rc->dh->sectors;
    Closure->readErrors = Closure->crcErrors = rc->readOK = 0;
 
@@ -898,6 +939,12 @@ next_reading_pass:
       rc->lastCopied = 0;  /* Start rendering the spiral from the beginning */
    }
 
+   /*** Keep read commands queued in the drive while reading sequentially.
+	Raw reading does its own error analysis per command. */
+
+   if(!Closure->readRaw)
+     EnableReadAhead(rc->dh, TRUE, rc->lastSector);
+
    /*** Read the medium image. */
 
    rc->readPos = rc->firstSector;
@@ -954,6 +1001,29 @@ reread:
 		  ok++;
 	 }
 	 
+	 /* or from the sector map of a previous session */
+
+	 else if(rc->sectorMap && rc->sectorMap->resumed)
+	 {  if(rc->readPos+nsectors > rc->readMarker)
+	       num_compare = rc->readMarker-rc->readPos;
+
+	    g_mutex_lock(rc->mutex);
+	    for(i=0; i<num_compare; i++)
+	    {  gint64 sector = rc->readPos+i;
+
+	       if(!SectorMapPresent(rc->sectorMap, sector))
+		  continue;
+
+	       if(!rc->crcBuf
+		  || CheckCrcAgainstCrcBuffer(rc->crcBuf, sector, rc->sectorMap->crc[sector]) != CRC_BAD)
+	       {  ok++;  /* CRC unavailable or good */
+		  if(rc->readMap)
+		    SetBit(rc->readMap, sector);
+	       }
+	    }
+	    g_mutex_unlock(rc->mutex);
+	 }
+
 	 /* else query dead sectors from image */
 	 
 	 else
@@ -975,7 +1045,13 @@ reread:
 	       if(err != SECTOR_PRESENT)
 		  ExplainMissingSector(sector_buf, rc->readPos+i, err, TRUE);
 	       else
-	       {  if(!rc->crcBuf
+	       {  if(rc->sectorMap)
+		  {  g_mutex_lock(rc->mutex);
+		     SectorMapSet(rc->sectorMap, rc->readPos+i, sector_buf);
+		     g_mutex_unlock(rc->mutex);
+		  }
+
+		  if(!rc->crcBuf
 		     || CheckAgainstCrcBuffer(rc->crcBuf, rc->readPos+i, sector_buf) != CRC_BAD)
 		  {  ok++;  /* CRC unavailable or good */
 		     if(rc->readMap)
@@ -1010,7 +1086,11 @@ reread:
       }
       g_mutex_unlock(rc->mutex);
 
+      stats_start = StatsTimestamp();
       status = ReadSectors(rc->dh, rc->alignedBuf[rc->readPtr]->buf, rc->readPos, nsectors);
+      StatsTime(STAT_IO_WAIT, stats_start);
+      if(status) StatsCount(STAT_READ_ERRORS, 1);
+      else       StatsCount(STAT_BYTES_READ, 2048*nsectors);
 
       /*** Medium Error (3) and Illegal Request (5) may result from 
 	   a medium read problem, but other errors are regarded as fatal. */
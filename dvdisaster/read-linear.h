@@ -49,6 +49,7 @@ typedef struct
    int doMD5sums;               /* whether we should calculate the above */
    int savedSectorSkip;
    CrcBuf *crcBuf;              /* CRC sums retrieved from above */
+   SectorMap *sectorMap;        /* persistent map of sectors present in image */
    RS02Layout *lay;             /* needed for processing RS02 images */
    unsigned char *fingerprint;  /* needed for missing sector generation */
    char *volumeLabel;
@@ -0,0 +1,347 @@
+/*  dvdisaster: Additional error correction for optical media.
+ *  Copyright (C) 2004-2012 Carsten Gnoerlich.
+ *
+ *  Email: carsten@dvdisaster.org  -or-  cgnoerlich@fsfe.org
+ *  Project homepage: http://www.dvdisaster.org
+ *
+ *  This file is part of dvdisaster.
+ *
+ *  dvdisaster is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dvdisaster is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dvdisaster. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "dvdisaster.h"
+
+#include "scsi-layer.h"
+
+/***
+ *** Per request read statistics.
+ ***
+ * Records the latency of each ReadSectors() request in a 
+ * log-linear (HDR style) histogram, counts the sense codes
+ * of failed requests and accumulates the throughput per zone
+ * of the medium. The result can be exported as JSON or CSV
+ * at the end of a read or scan.
+ *
+ * Histogram layout: latencies below PROFILE_SUB_BUCKETS microseconds get
+ * their own bucket; above that each power of two is split into
+ * PROFILE_SUB_BUCKETS linear sub buckets (about 6% resolution).
+ *
+ * The latency covers the whole ReadSectors() call including retries.
+ * With read ahead, a request served from the queue has been issued to
+ * the drive earlier and possibly waited there behind other commands;
+ * its latency is the time the reader still had to wait for the data,
+ * not the drive's service time for that command.
+ */
+
+static int bucket_index(gint64 usecs)
+{  int exponent = 0;
+
+   if(usecs < 0) usecs = 0;
+   if(usecs < PROFILE_SUB_BUCKETS)
+     return usecs;
+
+   while((usecs >> exponent) >= 2*PROFILE_SUB_BUCKETS)
+     exponent++;
+
+   if(exponent >= PROFILE_EXPONENTS)
+     return PROFILE_BUCKETS-1;
+
+   return PROFILE_SUB_BUCKETS 
+          + exponent*PROFILE_SUB_BUCKETS 
+          + ((usecs >> exponent) - PROFILE_SUB_BUCKETS);
+}
+
+static gint64 bucket_upper_bound(int idx)
+{  int exponent,sub;
+
+   if(idx < PROFILE_SUB_BUCKETS)
+     return idx;
+
+   exponent = (idx - PROFILE_SUB_BUCKETS) / PROFILE_SUB_BUCKETS;
+   sub      = (idx - PROFILE_SUB_BUCKETS) % PROFILE_SUB_BUCKETS;
+
+   return ((gint64)(PROFILE_SUB_BUCKETS+sub+1) << exponent) - 1;
+}
+
+/***
+ *** Allocation
+ ***/
+
+ReadProfile* CreateReadProfile(gint64 sectors)
+{  ReadProfile *rp = g_malloc0(sizeof(ReadProfile));
+
+   rp->sectors  = sectors > 0 ? sectors : 1;
+   rp->zoneSize = (rp->sectors + PROFILE_ZONES - 1) / PROFILE_ZONES;
+   rp->minLatency = G_MAXINT64;
+   rp->timer = g_timer_new();
+
+   return rp;
+}
+
+void FreeReadProfile(ReadProfile *rp)
+{
+   g_timer_destroy(rp->timer);
+   g_free(rp);
+}
+
+/***
+ *** Recording
+ ***/
+
+/*
+ * Returns a time stamp in microseconds for measuring a request
+ */
+
+gint64 ReadProfileTimestamp(ReadProfile *rp)
+{  return (gint64)(1000000.0*g_timer_elapsed(rp->timer, NULL));
+}
+
+static void count_sense(ReadProfile *rp, int key, int asc, int ascq)
+{  int i;
+
+   for(i=0; i<rp->nSense; i++)
+   {  ProfileSense *ps = &rp->sense[i];
+
+      if(ps->key == key && ps->asc == asc && ps->ascq == ascq)
+      {  ps->count++;
+	 return;
+      }
+   }
+
+   if(rp->nSense < PROFILE_SENSE_CODES)
+   {  ProfileSense *ps = &rp->sense[rp->nSense++];
+
+      ps->key   = key;
+      ps->asc   = asc;
+      ps->ascq  = ascq;
+      ps->count = 1;
+   }
+   else rp->otherSense++;
+}
+
+void ReadProfileAdd(ReadProfile *rp, gint64 lba, int nsectors, gint64 usecs, int attempts, int status)
+{  gint64 zone;
+   ProfileZone *pz;
+
+   rp->requests++;
+   rp->attempts += attempts;
+   rp->totalLatency += usecs;
+   rp->histogram[bucket_index(usecs)]++;
+
+   if(usecs < rp->minLatency) rp->minLatency = usecs;
+   if(usecs > rp->maxLatency) rp->maxLatency = usecs;
+
+   /* Requests are attributed to the zone of their first sector */
+
+   zone = lba / rp->zoneSize;
+   if(zone < 0) zone = 0;
+   if(zone >= PROFILE_ZONES) zone = PROFILE_ZONES-1;
+   pz = &rp->zones[zone];
+
+   pz->requests++;
+   pz->usecs += usecs;
+
+   if(status)
+   {  int key,asc,ascq;
+
+      GetLastSense(&key, &asc, &ascq);
+      count_sense(rp, key, asc, ascq);
+      rp->failedRequests++;
+      pz->failedSectors += nsectors;
+   }
+   else
+   {  rp->sectorsRead += nsectors;
+      pz->sectorsRead  += nsectors;
+   }
+}
+
+/***
+ *** Evaluation
+ ***/
+
+static gint64 percentile(ReadProfile *rp, double fraction)
+{  gint64 wanted = (gint64)ceil(fraction*rp->requests);
+   gint64 sum = 0;
+   int i;
+
+   if(wanted < 1) wanted = 1;
+
+   for(i=0; i<PROFILE_BUCKETS; i++)
+   {  sum += rp->histogram[i];
+      if(sum >= wanted)
+      {  gint64 upper = bucket_upper_bound(i);
+
+	 return upper < rp->maxLatency ? upper : rp->maxLatency;
+      }
+   }
+
+   return rp->maxLatency;
+}
+
+static double zone_rate(ProfileZone *pz)  /* in KiB/s */
+{
+   if(!pz->usecs) return 0.0;
+
+   return (2.0*pz->sectorsRead) / ((double)pz->usecs / 1000000.0);
+}
+
+/***
+ *** Export
+ ***/
+
+static void json_string(FILE *file, char *string)
+{  
+   fputc('"', file);
+   for(; string && *string; string++)
+   {  unsigned char c = *string;
+
+      if(c == '"' || c == '\\')   fprintf(file, "\\%c", c);
+      else if(c < 0x20)           fprintf(file, "\\u%04x", c);
+      else                        fputc(c, file);
+   }
+   fputc('"', file);
+}
+
+static void export_json(ReadProfile *rp, DeviceHandle *dh, FILE *file)
+{  gint64 i;
+   int first;
+
+   g_fprintf(file, "{\n  \"device\": ");
+   json_string(file, dh->devinfo);
+   g_fprintf(file, ",\n  \"medium\": ");
+   json_string(file, dh->typeDescr);
+   g_fprintf(file, ",\n  \"sectors\": %lld,\n", (long long)rp->sectors);
+
+   g_fprintf(file, "  \"requests\": %lld,\n", (long long)rp->requests);
+   g_fprintf(file, "  \"failedRequests\": %lld,\n", (long long)rp->failedRequests);
+   g_fprintf(file, "  \"attempts\": %lld,\n", (long long)rp->attempts);
+   g_fprintf(file, "  \"sectorsRead\": %lld,\n", (long long)rp->sectorsRead);
+
+   /* Latency summary and histogram */
+
+   g_fprintf(file, "  \"latencyUsecs\": {\n");
+   if(rp->requests)
+   {  g_fprintf(file, "    \"min\": %lld, \"max\": %lld, \"mean\": %.1f,\n",
+		(long long)rp->minLatency, (long long)rp->maxLatency,
+		(double)rp->totalLatency / (double)rp->requests);
+      g_fprintf(file, "    \"p50\": %lld, \"p90\": %lld, \"p99\": %lld, \"p999\": %lld,\n",
+		(long long)percentile(rp, 0.5), (long long)percentile(rp, 0.9),
+		(long long)percentile(rp, 0.99), (long long)percentile(rp, 0.999));
+   }
+   g_fprintf(file, "    \"buckets\": [");
+   for(i=0, first=TRUE; i<PROFILE_BUCKETS; i++)
+     if(rp->histogram[i])
+     {  g_fprintf(file, "%s\n      {\"upTo\": %lld, \"count\": %lld}", 
+		  first ? "" : ",",
+		  (long long)bucket_upper_bound(i), (long long)rp->histogram[i]);
+        first = FALSE;
+     }
+   g_fprintf(file, "\n    ]\n  },\n");
+
+   /* Sense codes of failed requests */
+
+   g_fprintf(file, "  \"senseCodes\": [");
+   for(i=0; i<rp->nSense; i++)
+   {  ProfileSense *ps = &rp->sense[i];
+
+      g_fprintf(file, "%s\n    {\"key\": %d, \"asc\": %d, \"ascq\": %d, \"count\": %lld, \"text\": ",
+		i ? "," : "", ps->key, ps->asc, ps->ascq, (long long)ps->count);
+      json_string(file, GetSenseString(ps->key, ps->asc, ps->ascq, FALSE));
+      g_fprintf(file, "}");
+   }
+   g_fprintf(file, "\n  ],\n");
+   g_fprintf(file, "  \"otherSenseCodes\": %lld,\n", (long long)rp->otherSense);
+
+   /* Zone throughput */
+
+   g_fprintf(file, "  \"zoneSize\": %lld,\n", (long long)rp->zoneSize);
+   g_fprintf(file, "  \"zones\": [");
+   for(i=0, first=TRUE; i<PROFILE_ZONES; i++)
+   {  ProfileZone *pz = &rp->zones[i];
+
+      if(!pz->requests) continue;
+
+      g_fprintf(file, "%s\n    {\"first\": %lld, \"requests\": %lld, \"sectorsRead\": %lld, "
+		"\"failedSectors\": %lld, \"usecs\": %lld, \"kbPerSec\": %.1f}",
+		first ? "" : ",", (long long)(i*rp->zoneSize),
+		(long long)pz->requests, (long long)pz->sectorsRead,
+		(long long)pz->failedSectors, (long long)pz->usecs, zone_rate(pz));
+      first = FALSE;
+   }
+   g_fprintf(file, "\n  ]\n}\n");
+}
+
+/*
+ * The CSV export produces two tables: the zone profile in the given file
+ * and the latency histogram in a second file with "-latency" added to its name.
+ */
+
+static void export_csv(ReadProfile *rp, FILE *file, char *path)
+{  char *latency_path, *dot;
+   FILE *latency_file;
+   int i;
+
+   g_fprintf(file, "first_sector,requests,sectors_read,failed_sectors,usecs,kb_per_sec\n");
+   for(i=0; i<PROFILE_ZONES; i++)
+   {  ProfileZone *pz = &rp->zones[i];
+
+      if(!pz->requests) continue;
+
+      g_fprintf(file, "%lld,%lld,%lld,%lld,%lld,%.1f\n",
+		(long long)(i*rp->zoneSize), (long long)pz->requests,
+		(long long)pz->sectorsRead, (long long)pz->failedSectors,
+		(long long)pz->usecs, zone_rate(pz));
+   }
+
+   dot = strrchr(path, '.');
+   if(dot)
+        latency_path = g_strdup_printf("%.*s-latency%s", (int)(dot-path), path, dot);
+   else latency_path = g_strdup_printf("%s-latency", path);
+
+   latency_file = fopen(latency_path, "w");
+   if(!latency_file)
+   {  PrintLog(_("Could not write read profile %s: %s\n"), latency_path, strerror(errno));
+      g_free(latency_path);
+      return;
+   }
+
+   g_fprintf(latency_file, "up_to_usecs,count\n");
+   for(i=0; i<PROFILE_BUCKETS; i++)
+     if(rp->histogram[i])
+       g_fprintf(latency_file, "%lld,%lld\n", 
+		 (long long)bucket_upper_bound(i), (long long)rp->histogram[i]);
+
+   fclose(latency_file);
+   g_free(latency_path);
+}
+
+void ExportReadProfile(ReadProfile *rp, DeviceHandle *dh, char *path)
+{  FILE *file;
+   int len = strlen(path);
+
+   file = fopen(path, "w");
+   if(!file)
+   {  PrintLog(_("Could not write read profile %s: %s\n"), path, strerror(errno));
+      return;
+   }
+
+   if(len > 4 && !strcasecmp(path+len-4, ".csv"))
+        export_csv(rp, file, path);
+   else export_json(rp, dh, file);
+
+   if(fclose(file))
+     PrintLog(_("Could not write read profile %s: %s\n"), path, strerror(errno));
+   else PrintLog(_("Read profile written to %s.\n"), path);
+}
@@ -68,15 +68,59 @@ void DumpSector(RawBuffer *rb, char *path)
 
 /***
  *** Create our local working context
- ***/
+ ***
+ * The samples and the per vector lists are kept in two slabs
+ * owned by the RawBuffer instead of many small allocations.
+ * Between sectors they are only reset, not freed; they grow on demand
+ * up to the limit given by Closure->rawSampleMB. Once that limit is
+ * reached, a new sample replaces the least useful one.
+ */
+
+static void reset_frame_stats(RawBuffer*);
+
+/* Memory needed per sample: the sample itself, one entry in each 
+   P/Q vector list, the P/Q load and the pointers. */
+
+#define LIST_BYTES_PER_SAMPLE (N_P_VECTORS*P_VECTOR_SIZE + N_Q_VECTORS*Q_VECTOR_SIZE)
+
+static int samples_limit(RawBuffer *rb)
+{  gint64 per_sample = rb->sampleAlloc + LIST_BYTES_PER_SAMPLE 
+                      + (1+N_P_VECTORS+N_Q_VECTORS)*sizeof(unsigned char*) + 2*sizeof(int);
+   gint64 limit = ((gint64)Closure->rawSampleMB<<20) / per_sample;
+
+   return (int)MAX(2, MIN(limit, G_MAXINT/LIST_BYTES_PER_SAMPLE));
+}
+
+/*
+ * Distribute the list slab for n samples among the P/Q vectors.
+ * Lists of vector v start at v*n.
+ */
+
+static void map_list_slab(RawBuffer *rb, unsigned char *slab, unsigned char **ptr, int n)
+{  int i,j;
+
+   for(i=0; i<N_P_VECTORS; i++)
+   {  rb->pList[i] = ptr; ptr += n;
+      for(j=0; j<n; j++)
+	rb->pList[i][j] = slab + (i*n + j)*P_VECTOR_SIZE;
+   }
+   slab += N_P_VECTORS*n*P_VECTOR_SIZE;
+
+   for(i=0; i<N_Q_VECTORS; i++)
+   {  rb->qList[i] = ptr; ptr += n;
+      for(j=0; j<n; j++)
+	rb->qList[i][j] = slab + (i*n + j)*Q_VECTOR_SIZE;
+   }
+}
 
 RawBuffer *CreateRawBuffer(int sample_length)
 {  RawBuffer *rb;
-   int i,j;
+   int i;
 
    rb = g_malloc0(sizeof(RawBuffer));
-   rb->samplesMax = MAX(1, Closure->maxReadAttempts);
-   rb->sampleSize = sample_length;
+   rb->sampleSize  = sample_length;
+   rb->sampleAlloc = sample_length;
+   rb->samplesMax  = MIN(MAX(2, Closure->maxReadAttempts), samples_limit(rb));
 
    rb->gt = CreateGaloisTables(0x11d);
    rb->rt = CreateReedSolomonTables(rb->gt, 0, 1, 10);
@@ -85,145 +129,172 @@ RawBuffer *CreateRawBuffer(int sample_length)
 
    rb->workBuf   = CreateAlignedBuffer(sample_length*MAX_CLUSTER_SECTORS);
    rb->zeroSector= g_malloc0(sample_length);
-   rb->rawBuf    = g_malloc(Closure->maxReadAttempts * sizeof(unsigned char*));
    rb->recovered = g_malloc(sample_length);
    rb->byteState = g_malloc(sample_length);
-   rb->byteCount = g_malloc(sample_length);
+   rb->byteCount = g_malloc0(sample_length);
+   rb->byteSeen  = g_malloc0(sample_length * 8 * sizeof(guint32));
    rb->reference = g_malloc(sample_length);
 
-   for(i=0; i<Closure->maxReadAttempts; i++)
-   {  rb->rawBuf[i] = g_malloc(sample_length);
-   }
+   rb->sampleSlab = g_malloc(rb->samplesMax * sample_length);
+   rb->rawBuf     = g_malloc(rb->samplesMax * sizeof(unsigned char*));
+   for(i=0; i<rb->samplesMax; i++)
+      rb->rawBuf[i] = rb->sampleSlab + i*sample_length;
 
-   for(i=0; i<N_P_VECTORS; i++)
-   {  rb->pParity1[i] = g_malloc(Closure->maxReadAttempts);
-      rb->pParity2[i] = g_malloc(Closure->maxReadAttempts);
-   }
+   rb->listSlab = g_malloc(rb->samplesMax * LIST_BYTES_PER_SAMPLE);
+   rb->listPtrs = g_malloc(rb->samplesMax * (N_P_VECTORS+N_Q_VECTORS) * sizeof(unsigned char*));
+   map_list_slab(rb, rb->listSlab, rb->listPtrs, rb->samplesMax);
 
-   for(i=0; i<N_Q_VECTORS; i++)
-   {  rb->qParity1[i] = g_malloc(Closure->maxReadAttempts);
-      rb->qParity2[i] = g_malloc(Closure->maxReadAttempts);
-   }
+   rb->pLoad = g_malloc0(rb->samplesMax * sizeof(int));
+   rb->qLoad = g_malloc0(rb->samplesMax * sizeof(int));
 
-   rb->pLoad = g_malloc0(Closure->maxReadAttempts * sizeof(int));
-   rb->qLoad = g_malloc0(Closure->maxReadAttempts * sizeof(int));
+   ResetRawBuffer(rb);
 
-   for(i=0; i<N_P_VECTORS; i++)
-      rb->pList[i]  = g_malloc(Closure->maxReadAttempts * sizeof(char*));
+   return rb;
+}
 
-   for(i=0; i<N_P_VECTORS; i++)
-     for(j=0; j<Closure->maxReadAttempts; j++)
-       rb->pList[i][j] = g_malloc(P_VECTOR_SIZE);
+/*
+ * Make room for at least new_samples_max samples (within the memory limit).
+ * Existing samples and list entries are preserved.
+ */
 
-   for(i=0; i<N_Q_VECTORS; i++)
-      rb->qList[i]  = g_malloc(Closure->maxReadAttempts * sizeof(char*));
+void ReallocRawBuffer(RawBuffer *rb, int new_samples_max)
+{  gsize *offset;
+   unsigned char **old_p[N_P_VECTORS], **old_q[N_Q_VECTORS];
+   unsigned char *old_list_slab = rb->listSlab;
+   unsigned char **old_list_ptrs = rb->listPtrs;
+   int limit = samples_limit(rb);
+   int old_max = rb->samplesMax;
+   int i,j;
 
-   for(i=0; i<N_Q_VECTORS; i++)
-     for(j=0; j<Closure->maxReadAttempts; j++)
-       rb->qList[i][j] = g_malloc(Q_VECTOR_SIZE);
+   if(new_samples_max <= old_max || old_max >= limit)
+      return;
 
-   memset(rb->pn, 0, sizeof(rb->pn));
-   memset(rb->qn, 0, sizeof(rb->qn));
+   /* Grow geometrically so that sample-by-sample requests stay cheap */
 
-   return rb;
-}
+   new_samples_max = MIN(MAX(new_samples_max, 2*old_max), limit);
 
-void ReallocRawBuffer(RawBuffer *rb, int new_samples_max)
-{  int i,j;
+   /* Samples are only ever swapped among each other,
+      so they keep their offsets within the slab.
+      Take these before g_realloc() invalidates the old slab. */
 
-   if(new_samples_max <= rb->samplesMax)
-      return;
+   offset = g_malloc(old_max * sizeof(gsize));
+   for(i=0; i<old_max; i++)
+      offset[i] = rb->rawBuf[i] - rb->sampleSlab;
 
-   rb->rawBuf = g_realloc(rb->rawBuf, new_samples_max * sizeof(unsigned char*));
+   rb->sampleSlab = g_realloc(rb->sampleSlab, new_samples_max * rb->sampleAlloc);
+   rb->rawBuf     = g_realloc(rb->rawBuf, new_samples_max * sizeof(unsigned char*));
 
-   for(i=rb->samplesMax; i<new_samples_max; i++)
-   {  rb->rawBuf[i] = g_malloc(rb->sampleSize);
-   }
+   for(i=0; i<old_max; i++)
+      rb->rawBuf[i] = rb->sampleSlab + offset[i];
+   g_free(offset);
+
+   for(i=old_max; i<new_samples_max; i++)
+      rb->rawBuf[i] = rb->sampleSlab + i*rb->sampleAlloc;
+
+   /* The lists have a stride of samplesMax, so they are moved one by one */
+
+   memcpy(old_p, rb->pList, sizeof(old_p));
+   memcpy(old_q, rb->qList, sizeof(old_q));
+
+   rb->listSlab = g_malloc(new_samples_max * LIST_BYTES_PER_SAMPLE);
+   rb->listPtrs = g_malloc(new_samples_max * (N_P_VECTORS+N_Q_VECTORS) * sizeof(unsigned char*));
+   map_list_slab(rb, rb->listSlab, rb->listPtrs, new_samples_max);
 
    for(i=0; i<N_P_VECTORS; i++)
-   {  rb->pParity1[i] = g_realloc(rb->pParity1[i], new_samples_max);
-      rb->pParity2[i] = g_realloc(rb->pParity2[i], new_samples_max);
-   }
+      for(j=0; j<rb->pn[i]; j++)
+	 memcpy(rb->pList[i][j], old_p[i][j], P_VECTOR_SIZE);
 
    for(i=0; i<N_Q_VECTORS; i++)
-   {  rb->qParity1[i] = g_realloc(rb->qParity1[i], new_samples_max);
-      rb->qParity2[i] = g_realloc(rb->qParity2[i], new_samples_max);
-   }
+      for(j=0; j<rb->qn[i]; j++)
+	 memcpy(rb->qList[i][j], old_q[i][j], Q_VECTOR_SIZE);
+
+   g_free(old_list_slab);
+   g_free(old_list_ptrs);
 
    rb->pLoad = g_realloc(rb->pLoad, new_samples_max * sizeof(int));
    rb->qLoad = g_realloc(rb->qLoad, new_samples_max * sizeof(int));
 
-   for(i=0; i<N_P_VECTORS; i++)
-      rb->pList[i]  = g_realloc(rb->pList[i],  new_samples_max * sizeof(char*));
+   rb->samplesMax = new_samples_max;
+}
 
-   for(i=0; i<N_P_VECTORS; i++)
-     for(j=rb->samplesMax; j<new_samples_max; j++)
-       rb->pList[i][j] = g_malloc(P_VECTOR_SIZE);
+/*
+ * Drop the least useful sample, e.g. the one with the highest
+ * P/Q load. The best frame is always kept. Byte values seen in the
+ * dropped sample remain known to the heuristics via byteSeen,
+ * byteCount and the parity lists (which hold each value only once
+ * and are therefore bounded by 256 entries).
+ */
 
-   for(i=0; i<N_Q_VECTORS; i++)
-      rb->qList[i]  = g_realloc(rb->qList[i],  new_samples_max * sizeof(char*));
+static void evict_sample(RawBuffer *rb)
+{  unsigned char *buf;
+   int worst = -1, worst_load = -1;
+   int last,s;
 
-   for(i=0; i<N_Q_VECTORS; i++)
-     for(j=rb->samplesMax; j<new_samples_max; j++)
-       rb->qList[i][j] = g_malloc(Q_VECTOR_SIZE);
+   UpdateFrameStats(rb);
 
-   rb->samplesMax = new_samples_max;
+   for(s=0; s<rb->samplesRead; s++)
+   {  int load = rb->pLoad[s] + rb->qLoad[s];
 
-   rb->bestP1 = rb->bestP2 = N_P_VECTORS;
-   rb->bestQ1 = rb->bestQ2 = N_Q_VECTORS;
+      if(s != rb->bestFrame && load > worst_load)
+      {  worst = s;
+	 worst_load = load;
+      }
+   }
+
+   last = rb->samplesRead-1;
+   buf  = rb->rawBuf[worst];
+   rb->rawBuf[worst] = rb->rawBuf[last];
+   rb->rawBuf[last]  = buf;
+   rb->pLoad[worst]  = rb->pLoad[last];
+   rb->qLoad[worst]  = rb->qLoad[last];
+
+   if(rb->bestFrame == last)
+      rb->bestFrame = worst;
+
+   rb->samplesRead--;
+   rb->statsSamples--;
 }
 
-void ResetRawBuffer(RawBuffer *rb)
-{  int i;
+/*
+ * Make sure that rb->rawBuf[rb->samplesRead] can take a new sample.
+ */
 
-   rb->samplesRead = 0;
+void ReserveRawSample(RawBuffer *rb)
+{
+   if(rb->samplesRead < rb->samplesMax)
+      return;
 
-   for(i=0; i<N_P_VECTORS; i++)
-     rb->pParityN[i][0] = rb->pParityN[i][1] = 0;
+   ReallocRawBuffer(rb, rb->samplesRead+1);
 
-   for(i=0; i<N_Q_VECTORS; i++)
-     rb->qParityN[i][0] = rb->qParityN[i][1] = 0;
+   if(rb->samplesRead < rb->samplesMax)
+      return;
 
-   rb->bestFrame = rb->bestFrame = 0;
-   rb->bestP1 = rb->bestP2 = N_P_VECTORS;
-   rb->bestQ1 = rb->bestQ2 = N_Q_VECTORS;
+   evict_sample(rb);
 }
 
-void FreeRawBuffer(RawBuffer *rb)
-{  int i,j;
+void ResetRawBuffer(RawBuffer *rb)
+{
+   rb->samplesRead = 0;
+   reset_frame_stats(rb);
 
+   memset(rb->pn, 0, sizeof(rb->pn));
+   memset(rb->qn, 0, sizeof(rb->qn));
+}
+
+void FreeRawBuffer(RawBuffer *rb)
+{
    FreeGaloisTables(rb->gt);
    FreeReedSolomonTables(rb->rt);
 
-   for(i=0; i<rb->samplesMax; i++)
-     g_free(rb->rawBuf[i]);
-
-   for(i=0; i<N_P_VECTORS; i++)
-   {  g_free(rb->pParity1[i]);
-      g_free(rb->pParity2[i]);
-   }
-
-   for(i=0; i<N_Q_VECTORS; i++)
-   {  g_free(rb->qParity1[i]);
-      g_free(rb->qParity2[i]);
-   }
+   g_free(rb->sampleSlab);
+   g_free(rb->listSlab);
+   g_free(rb->listPtrs);
 
    g_free(rb->pLoad);
    g_free(rb->qLoad);
 
-   for(i=0; i<N_P_VECTORS; i++)
-   {  for(j=0; j<rb->samplesMax; j++)
-	 g_free(rb->pList[i][j]);
-
-      g_free(rb->pList[i]);
-   }
-
-   for(i=0; i<N_Q_VECTORS; i++)
-   {  for(j=0; j<rb->samplesMax; j++)
-	 g_free(rb->qList[i][j]);
-
-      g_free(rb->qList[i]);
-   }
+   if(rb->cache)
+      CloseRawSectorCache(rb->cache);
 
    FreeAlignedBuffer(rb->workBuf);
    g_free(rb->zeroSector);
@@ -231,6 +302,7 @@ void FreeRawBuffer(RawBuffer *rb)
    g_free(rb->recovered);
    g_free(rb->byteState);
    g_free(rb->byteCount);
+   g_free(rb->byteSeen);
    g_free(rb->reference);
    g_free(rb);
 }
@@ -653,6 +725,7 @@ static int q_decode(RawBuffer *rb, unsigned char *vector, unsigned char *state)
 int IterativeLEC(RawBuffer *rb)
 {  unsigned char p_vector[P_VECTOR_SIZE];
    unsigned char q_vector[Q_VECTOR_SIZE];
+   PQState pq;
    int p_failures, q_failures;
    int p_corrected, q_corrected;
    int p,q;
@@ -660,6 +733,8 @@ int IterativeLEC(RawBuffer *rb)
    int last_q_failures = N_Q_VECTORS;
    int iteration=1;
 
+   InitPQState(&pq, rb->gt, rb->recovered);
+
    for(; ;) /* iterate over P- and Q-Parity until failures converge */
    {	
       p_failures = q_failures = 0;
@@ -670,6 +745,11 @@ int IterativeLEC(RawBuffer *rb)
       for(q=0; q<N_Q_VECTORS; q++)
       {  int err;
 
+	 if(QVectorOK(&pq, q))
+	 {  OrQVector(rb->byteState, 1, q);
+	    continue;
+	 }
+
 	 /* Try error correction */
 
 	 GetQVector(rb->recovered, q_vector, q);
@@ -683,7 +763,7 @@ int IterativeLEC(RawBuffer *rb)
 	 }
 	 else  /* Correctable. Mark bytes as good; store back results. */ 
 	 {  if(err == 1 || err == 2) /* Store back corrected vector */ 
-	    {  SetQVector(rb->recovered, q_vector, q);
+	    {  PQStateSetQVector(&pq, q_vector, q);
 	       q_corrected++;
 	    }
 	    OrQVector(rb->byteState, 1, q);
@@ -695,6 +775,11 @@ int IterativeLEC(RawBuffer *rb)
       for(p=0; p<N_P_VECTORS; p++)
       {  int err;
 
+	 if(PVectorOK(&pq, p))
+	 {  OrPVector(rb->byteState, 2, p);
+	    continue;
+	 }
+
 	 /* Try error correction */
 
 	 GetPVector(rb->recovered, p_vector, p);
@@ -708,7 +793,7 @@ int IterativeLEC(RawBuffer *rb)
 	 }
 	 else  /* Correctable. Mark bytes as good; store back results. */ 
 	 {  if(err == 1 || err == 2) /* Store back corrected vector */ 
-	    {  SetPVector(rb->recovered, p_vector, p);
+	    {  PQStateSetPVector(&pq, p_vector, p);
 	       p_corrected++;
 	    }
 	    OrPVector(rb->byteState, 2, p);
@@ -741,57 +826,117 @@ int IterativeLEC(RawBuffer *rb)
 /***
  *** Some frame statistics are updated iteratively,
  *** e.g. whenever a new frame is accumulated.
+ ***
+ * Each sample is looked at exactly once when it is added:
+ * - byteSeen keeps a 256 bit set of the values read at each position,
+ *   so byteCount and the P/Q parity lists are updated without 
+ *   comparing against the previous samples;
+ * - the P/Q vectors of the new sample are decoded once and the
+ *   result is used for both its P/Q load and the best frame selection.
  */
 
-void UpdateFrameStats(RawBuffer *rb)
-{  unsigned char *new_sample = rb->rawBuf[rb->samplesRead-1];
-   unsigned char vector[Q_VECTOR_SIZE];
+#define BYTE_SEEN(rb, i, v) ((rb)->byteSeen[((i)<<3) + ((v)>>5)] & (1U << ((v) & 31)))
+
+static void reset_frame_stats(RawBuffer *rb)
+{  int i;
+
+   memset(rb->byteSeen, 0, rb->sampleSize * 8 * sizeof(guint32));
+   memset(rb->byteCount, 0, rb->sampleSize);
+
+   for(i=0; i<N_P_VECTORS; i++)
+     rb->pParityN[i][0] = rb->pParityN[i][1] = 0;
+
+   for(i=0; i<N_Q_VECTORS; i++)
+     rb->qParityN[i][0] = rb->qParityN[i][1] = 0;
+
+   rb->bestFrame = 0;
+   rb->bestP1 = rb->bestP2 = N_P_VECTORS;
+   rb->bestQ1 = rb->bestQ2 = N_Q_VECTORS;
+
+   rb->statsSamples = 0;
+}
+
+static void add_parity_byte(RawBuffer *rb, unsigned char *sample, int idx,
+			    unsigned char *list, int *n)
+{
+   if(!BYTE_SEEN(rb, idx, sample[idx]))
+      list[(*n)++] = sample[idx];
+}
+
+static void add_sample_stats(RawBuffer *rb, int s)
+{  unsigned char *new_sample = rb->rawBuf[s];
+   int err[N_P_VECTORS], pos[N_P_VECTORS];
+   unsigned char value[N_P_VECTORS];
    int p_corr = 0;
    int p_err  = 0;
    int q_corr = 0;
    int q_err  = 0;
-   int err,eras[2];
-   int p,q;
+   int i,p,q;
+
+   /* New P/Q parity values; must be looked at before byteSeen is updated */
+
+   for(q=0; q<N_Q_VECTORS; q++)
+   {  add_parity_byte(rb, new_sample, QToByteIndex(q, 43), rb->qParity1[q], &rb->qParityN[q][0]);
+      add_parity_byte(rb, new_sample, QToByteIndex(q, 44), rb->qParity2[q], &rb->qParityN[q][1]);
+   }
+
+   for(p=0; p<N_P_VECTORS; p++)
+   {  add_parity_byte(rb, new_sample, PToByteIndex(p, 24), rb->pParity1[p], &rb->pParityN[p][0]);
+      add_parity_byte(rb, new_sample, PToByteIndex(p, 25), rb->pParity2[p], &rb->pParityN[p][1]);
+   }
+
+   /* Count of different bytes read for each position */
+
+   for(i=0; i<rb->sampleSize; i++)
+   {  int v = new_sample[i];
+
+      if(!BYTE_SEEN(rb, i, v))
+      {  rb->byteSeen[(i<<3) + (v>>5)] |= 1U << (v & 31);
+	 rb->byteCount[i]++;
+      }
+   }
+
+   /* Work load of the P/Q vectors.
+      Without erasures DecodePQ() corrects at most one error,
+      so err is 0, 1 or negative for uncorrectable vectors. */
 
    /* MAYBE TODO: Try trivial corrections first, e.g.
       correct P/Q with single failure until they damage
       some other vector */
 
-   /* MAYBE TODO: add single byte failures are to the double
-      failure count since we want to pick the vector
-      with the least number of defective vectors. */
-
+   DecodePVectors(rb->rt, new_sample, err, pos, value);
    for(p=0; p<N_P_VECTORS; p++)
-   {  GetPVector(new_sample, vector, p);
-      err = DecodePQ(rb->rt, vector, P_PADDING, eras, 0);
-      switch(err)
+      switch(err[p])
       {  case 0: 
 	    break;
 	 case 1:
 	    p_corr++;
-	    //	    p_err++;
 	    break;
 	 default:
 	    p_err++;
 	    break;
       }
-   }
 
+   DecodeQVectors(rb->rt, new_sample, err, pos, value);
    for(q=0; q<N_Q_VECTORS; q++)
-   {  GetQVector(new_sample, vector, q);
-      err = DecodePQ(rb->rt, vector, Q_PADDING, eras, 0);
-      switch(err)
+      switch(err[q])
       {  case 0: 
 	    break;
 	 case 1:
 	    q_corr++;
-	    //	    q_err++;
 	    break;
 	 default:
 	    q_err++;
 	    break;
       }
-   }
+
+   rb->pLoad[s] = p_corr + 2*p_err;
+   rb->qLoad[s] = q_corr + 2*q_err;
+
+   /* See if this is the best frame so far.
+      MAYBE TODO: add single byte failures are to the double
+      failure count since we want to pick the vector
+      with the least number of defective vectors. */
 
    if(p_err > rb->bestP2)
       return;
@@ -809,20 +954,217 @@ void UpdateFrameStats(RawBuffer *rb)
       }
    }
 
-   rb->bestFrame = rb->samplesRead - 1;
+   rb->bestFrame = s;
    rb->bestP1 = p_corr;
    rb->bestP2 = p_err;
    rb->bestQ1 = q_corr;
    rb->bestQ2 = q_err;
 }
 
+/*
+ * Bring the statistics up to date with all samples read so far.
+ */
+
+void UpdateFrameStats(RawBuffer *rb)
+{
+   /* Samples have been discarded without resetting the buffer */
+
+   if(rb->statsSamples > rb->samplesRead)
+      reset_frame_stats(rb);
+
+   while(rb->statsSamples < rb->samplesRead)
+      add_sample_stats(rb, rb->statsSamples++);
+}
+
+/***
+ *** Fast path using the C2 error pointers.
+ ***
+ * Bytes flagged by C2 are taken as erasures right away, which lets
+ * each P/Q vector correct two of them instead of a single unknown error.
+ * With several samples, a frame is voted byte by byte from the samples
+ * which are C2-clean at that position; positions without a clear
+ * majority become the erasures for the subsequent correction.
+ */
+
+#define C2_BIT(c2, i) ((c2)[(i)>>3] & (0x80 >> ((i)&7)))
+#define ERASURE_LEC_ROUNDS 8
+
+/*
+ * Samples from the cache have a flag in the last byte 
+ * telling whether C2 information was recorded.
+ */
+
+static int has_c2_info(RawBuffer *rb, unsigned char *sample)
+{
+   if(rb->sampleSize < CD_RAW_C2_SECTOR_SIZE)
+      return FALSE;
+
+   if(rb->sampleSize >= CD_RAW_DUMP_SIZE)
+      return sample[CD_RAW_DUMP_SIZE-1] == 1;
+
+   return TRUE;
+}
+
+/*
+ * Correct rb->recovered, treating bytes with erased[i] set as erasures.
+ * Vectors with up to two erasures are corrected; their bytes are no
+ * longer considered as erased afterwards.
+ */
+
+static int erasure_lec(RawBuffer *rb, unsigned char *erased)
+{  unsigned char vector[Q_VECTOR_SIZE];
+   PQState pq;
+   int round,progress;
+   int p,q,i;
+
+   InitPQState(&pq, rb->gt, rb->recovered);
+
+   for(round=0; round<ERASURE_LEC_ROUNDS; round++)
+   {  progress = FALSE;
+
+      for(q=0; q<N_Q_VECTORS; q++)
+      {  int eras[3],n=0;
+
+	 if(QVectorOK(&pq, q))
+	    continue;
+
+	 for(i=0; i<Q_VECTOR_SIZE && n<=2; i++)
+	    if(erased[QToByteIndex(q,i)])
+	       eras[n++] = i;
+
+	 if(n > 2)
+	    continue;
+
+	 GetQVector(rb->recovered, vector, q);
+	 if(DecodePQ(rb->rt, vector, Q_PADDING, eras, n) > 0)
+	 {  PQStateSetQVector(&pq, vector, q);
+	    for(i=0; i<Q_VECTOR_SIZE; i++)
+	       erased[QToByteIndex(q,i)] = 0;
+	    progress = TRUE;
+	 }
+      }
+
+      for(p=0; p<N_P_VECTORS; p++)
+      {  int eras[3],n=0;
+
+	 if(PVectorOK(&pq, p))
+	    continue;
+
+	 for(i=0; i<P_VECTOR_SIZE && n<=2; i++)
+	    if(erased[PToByteIndex(p,i)])
+	       eras[n++] = i;
+
+	 if(n > 2)
+	    continue;
+
+	 GetPVector(rb->recovered, vector, p);
+	 if(DecodePQ(rb->rt, vector, P_PADDING, eras, n) > 0)
+	 {  PQStateSetPVector(&pq, vector, p);
+	    for(i=0; i<P_VECTOR_SIZE; i++)
+	       erased[PToByteIndex(p,i)] = 0;
+	    progress = TRUE;
+	 }
+      }
+
+      if(!progress || CheckEDC(rb->recovered, rb->xaMode))
+	 break;
+   }
+
+   return CheckEDC(rb->recovered, rb->xaMode);
+}
+
+/*
+ * Use the C2 pointers of the newest sample as erasures.
+ */
+
+static int c2_erasure_lec(RawBuffer *rb)
+{  unsigned char *sample = rb->rawBuf[rb->samplesRead-1];
+   unsigned char erased[CD_RAW_SECTOR_SIZE];
+   int i;
+
+   if(!has_c2_info(rb, sample) || !CountC2Errors(sample))
+      return FALSE;
+
+   for(i=0; i<CD_RAW_SECTOR_SIZE; i++)
+      erased[i] = C2_BIT(sample+CD_RAW_SECTOR_SIZE, i) != 0;
+
+   return erasure_lec(rb, erased);
+}
+
+/*
+ * Vote a frame from all samples and correct it.
+ */
+
+static int c2_majority_vote(RawBuffer *rb)
+{  unsigned char erased[CD_RAW_SECTOR_SIZE];
+   int c2[rb->samplesRead];
+   int count[256];
+   int s,i;
+
+   if(rb->samplesRead < 2)
+      return FALSE;
+
+   for(s=0; s<rb->samplesRead; s++)
+      c2[s] = has_c2_info(rb, rb->rawBuf[s]);
+
+   memset(count, 0, sizeof(count));
+
+   for(i=0; i<CD_RAW_SECTOR_SIZE; i++)
+   {  int clean = 0, best = -1;
+
+      /* Votes from samples without a C2 flag at this position */
+
+      for(s=0; s<rb->samplesRead; s++)
+      {  unsigned char *sample = rb->rawBuf[s];
+
+	 if(c2[s] && C2_BIT(sample+CD_RAW_SECTOR_SIZE, i))
+	    continue;
+
+	 count[sample[i]]++;
+	 clean++;
+	 if(best < 0 || count[sample[i]] > count[best])
+	    best = sample[i];
+      }
+
+      /* Nothing clean; fall back to all samples */
+
+      if(!clean)
+	 for(s=0; s<rb->samplesRead; s++)
+	 {  int v = rb->rawBuf[s][i];
+
+	    count[v]++;
+	    if(best < 0 || count[v] > count[best])
+	       best = v;
+	 }
+
+      rb->recovered[i] = best;
+      erased[i] = !clean || 2*count[best] <= clean;
+
+      for(s=0; s<rb->samplesRead; s++)
+	 count[rb->rawBuf[s][i]] = 0;
+   }
+
+   memcpy(rb->recovered, sync_pattern, 12);
+
+   if(CheckEDC(rb->recovered, rb->xaMode))
+      return TRUE;
+
+   return erasure_lec(rb, erased);
+}
+
 /*** 
  *** The grand wrapper:
  ***
  * Try several strategies to analyse and recover
  * a collection of RAW frame samples.
+ * If the caller has set a deadline, the remaining heuristics
+ * are skipped once it has passed.
  */
 
+static int out_of_time(RawBuffer *rb)
+{  return rb->deadlineTimer && g_timer_elapsed(rb->deadlineTimer, NULL) > rb->deadline;
+}
+
 int TryCDFrameRecovery(RawBuffer *rb, unsigned char *outbuf)
 {  unsigned char *new_frame = rb->workBuf->buf;
 
@@ -867,6 +1209,7 @@ int TryCDFrameRecovery(RawBuffer *rb, unsigned char *outbuf)
    if(rb->xaMode)
      memset(new_frame+12, 0, 4); 
 
+   ReserveRawSample(rb);
    memcpy(rb->rawBuf[rb->samplesRead], new_frame, rb->sampleSize);
    rb->samplesRead++;
 
@@ -913,6 +1256,30 @@ int TryCDFrameRecovery(RawBuffer *rb, unsigned char *outbuf)
       }
    }
 
+   /* Use the C2 error pointers as erasures */
+
+   if(c2_erasure_lec(rb)
+      && CheckMSF(rb->recovered, rb->lba, STRICT_MSF_CHECK))
+   {  PrintCLIorLabel(Closure->status, 
+		      "Sector %lld: Recovered in raw reader using C2 erasures.\n",
+		      rb->lba);
+      memcpy(outbuf, rb->recovered+rb->dataOffset, 2048);
+      return 0;
+   }
+
+   if(c2_majority_vote(rb)
+      && CheckMSF(rb->recovered, rb->lba, STRICT_MSF_CHECK))
+   {  PrintCLIorLabel(Closure->status, 
+		      "Sector %lld: Recovered in raw reader by majority vote over %d samples.\n",
+		      rb->lba, rb->samplesRead);
+      memcpy(outbuf, rb->recovered+rb->dataOffset, 2048);
+      return 0;
+   }
+
+   /* Neither worked; start over from the new sample */
+
+   memcpy(rb->recovered, new_frame, rb->sampleSize);
+   memcpy(rb->recovered, sync_pattern, 12);
 
    /* Try the simple iterative L-EC */
 
@@ -931,14 +1298,6 @@ int TryCDFrameRecovery(RawBuffer *rb, unsigned char *outbuf)
 
    /*** More sophisticated heuristics */
 
-   /* Incremental update of our data */
-
-   UpdateByteCounts(rb);
-   CalculatePQLoad(rb);
-   UpdatePQParityList(rb, new_frame);
-
-   /* The actual heuristics */
-
 #if 0
    SmartLEC(rb);
 
@@ -952,6 +1311,9 @@ int TryCDFrameRecovery(RawBuffer *rb, unsigned char *outbuf)
    }
 #endif
 
+   if(out_of_time(rb))
+      goto failed;
+
    SearchPlausibleSector(rb, 0);
 
    if(CheckEDC(rb->recovered, rb->xaMode)
@@ -963,6 +1325,9 @@ int TryCDFrameRecovery(RawBuffer *rb, unsigned char *outbuf)
       return 0; 
    }
 
+   if(out_of_time(rb))
+      goto failed;
+
    BruteForceSearchPlausibleSector(rb);
 
    if(CheckEDC(rb->recovered, rb->xaMode)
@@ -974,6 +1339,9 @@ int TryCDFrameRecovery(RawBuffer *rb, unsigned char *outbuf)
       return 0; 
    }
 
+   if(out_of_time(rb))
+      goto failed;
+
    AckHeuristic(rb);
 
    if(CheckEDC(rb->recovered, rb->xaMode)
@@ -985,6 +1353,9 @@ int TryCDFrameRecovery(RawBuffer *rb, unsigned char *outbuf)
       return 0; 
    }
 
+   if(out_of_time(rb))
+      goto failed;
+
    HeuristicLEC(rb->recovered, rb, outbuf);
 
    if(CheckEDC(rb->recovered, rb->xaMode)
@@ -996,6 +1367,9 @@ int TryCDFrameRecovery(RawBuffer *rb, unsigned char *outbuf)
       return 0; 
    }
 
+   if(out_of_time(rb))
+      goto failed;
+
    SearchPlausibleSector(rb, 1);
 
    if(CheckEDC(rb->recovered, rb->xaMode)
@@ -1007,6 +1381,9 @@ int TryCDFrameRecovery(RawBuffer *rb, unsigned char *outbuf)
       return 0; 
    }
 
+   if(out_of_time(rb))
+      goto failed;
+
    BruteForceSearchPlausibleSector(rb);
 
    if(CheckEDC(rb->recovered, rb->xaMode)
@@ -1018,6 +1395,9 @@ int TryCDFrameRecovery(RawBuffer *rb, unsigned char *outbuf)
       return 0; 
    }
 
+   if(out_of_time(rb))
+      goto failed;
+
    AckHeuristic(rb);
 
    if(CheckEDC(rb->recovered, rb->xaMode)
@@ -1029,6 +1409,9 @@ int TryCDFrameRecovery(RawBuffer *rb, unsigned char *outbuf)
       return 0; 
    }
 
+   if(out_of_time(rb))
+      goto failed;
+
    HeuristicLEC(rb->recovered, rb, outbuf);
 
    if(CheckEDC(rb->recovered, rb->xaMode)
@@ -1042,6 +1425,7 @@ int TryCDFrameRecovery(RawBuffer *rb, unsigned char *outbuf)
 
    /*** Recovery failed */
 
+failed:
    RememberSense(3, 255, 6);  /* Sector accumulated for analysis */
    rb->recommendedAttempts = Closure->maxReadAttempts;
    return -1;
@@ -67,8 +67,8 @@ int ProbeAltiVec(void)
 }
 
 void encode_next_layer_altivec(ReedSolomonTables *rt, unsigned char *data, unsigned char *parity, guint64 layer_size, int shift)
-{  gint32 *gf_index_of  = rt->gfTables->indexOf;
-   gint32 *enc_alpha_to = rt->gfTables->encAlphaTo;
+{  guint8 *gf_index_of  = rt->gfTables->indexOf;
+   guint8 *enc_alpha_to = rt->gfTables->encAlphaTo;
    gint32 *rs_gpoly     = rt->gpoly;
    int nroots           = rt->nroots;
    int nroots_aligned   = (nroots+15)&~15;
@@ -57,9 +57,72 @@ int ProbeSSE2(void)
    }
 }
 
-void encode_next_layer_sse2(ReedSolomonTables *rt, unsigned char *data, unsigned char *parity, guint64 layer_size, int shift)
-{  gint32 *gf_index_of  = rt->gfTables->indexOf;
-   gint32 *enc_alpha_to = rt->gfTables->encAlphaTo;
+/*
+ * Specialized encoders for the common numbers of roots.
+ * With nroots being a compile time constant the 128 bit steps
+ * over the lookup table are fully unrolled and the parity pointer
+ * advances by a constant; everything else is as in the generic
+ * version below.
+ */
+
+#define SSE2_XOR_STEP(k) \
+   {  __m128i par = _mm_load_si128((__m128i*)par_idx + (k)); \
+      __m128i lut = _mm_loadu_si128((__m128i*)(e_lut + 16*(k))); \
+      _mm_store_si128((__m128i*)par_idx + (k), _mm_xor_si128(par, lut)); \
+   }
+
+#define SSE2_XOR_1 SSE2_XOR_STEP(0)
+#define SSE2_XOR_2 SSE2_XOR_1 SSE2_XOR_STEP(1)
+#define SSE2_XOR_3 SSE2_XOR_2 SSE2_XOR_STEP(2)
+#define SSE2_XOR_4 SSE2_XOR_3 SSE2_XOR_STEP(3)
+
+#define DEFINE_SSE2_ENCODER(NROOTS, XOR_STEPS) \
+static void encode_sse2_##NROOTS(ReedSolomonTables *rt, unsigned char *data, unsigned char *parity, guint64 layer_size, int shift) \
+{  guint8 *gf_index_of  = rt->gfTables->indexOf; \
+   guint8 *enc_alpha_to = rt->gfTables->encAlphaTo; \
+   int gpoly0           = rt->gpoly[0]; \
+   int offset           = NROOTS-shift-1; \
+   int i; \
+\
+   for(i=0; i<layer_size; i++) \
+   {  int feedback = gf_index_of[data[i] ^ parity[shift]]; \
+\
+      if(feedback != GF_ALPHA0) \
+      {  guint8 *par_idx = (guint8*)parity; \
+	 guint8 *e_lut   = rt->bLut[feedback]+offset; \
+\
+	 XOR_STEPS \
+	 parity[shift] = enc_alpha_to[feedback + gpoly0]; \
+      } \
+      else parity[shift] = 0; \
+\
+      parity += (NROOTS+15)&~15; \
+   } \
+}
+
+DEFINE_SSE2_ENCODER(16, SSE2_XOR_1)
+DEFINE_SSE2_ENCODER(20, SSE2_XOR_2)
+DEFINE_SSE2_ENCODER(32, SSE2_XOR_2)
+DEFINE_SSE2_ENCODER(64, SSE2_XOR_4)
+
+static struct
+{  int nroots;
+   void (*encode)(ReedSolomonTables*, unsigned char*, unsigned char*, guint64, int);
+} sse2_encoders[] =
+{  { 16, encode_sse2_16 },
+   { 20, encode_sse2_20 },
+   { 32, encode_sse2_32 },
+   { 64, encode_sse2_64 },
+   {  0, NULL }
+};
+
+/*
+ * Generic version for any number of roots
+ */
+
+static void encode_generic_sse2(ReedSolomonTables *rt, unsigned char *data, unsigned char *parity, guint64 layer_size, int shift)
+{  guint8 *gf_index_of  = rt->gfTables->indexOf;
+   guint8 *enc_alpha_to = rt->gfTables->encAlphaTo;
    gint32 *rs_gpoly     = rt->gpoly;
    int nroots           = rt->nroots;
    int nroots_aligned   = (nroots+15)&~15;
@@ -95,6 +158,18 @@ void encode_next_layer_sse2(ReedSolomonTables *rt, unsigned char *data, unsigned
       parity += nroots_aligned;
    }
 }
+
+void encode_next_layer_sse2(ReedSolomonTables *rt, unsigned char *data, unsigned char *parity, guint64 layer_size, int shift)
+{  int i;
+
+   for(i=0; sse2_encoders[i].nroots; i++)
+     if(sse2_encoders[i].nroots == rt->nroots)
+     {  sse2_encoders[i].encode(rt, data, parity, layer_size, shift);
+        return;
+     }
+
+   encode_generic_sse2(rt, data, parity, layer_size, shift);
+}
 #else /* don't have SSE2 */
 /* Stub functions to keep the linker happy.
  * Should never be executed.
@@ -39,9 +39,9 @@
   #define SHIFT_RIGHT <<
 #endif /* HAVE_BIG_ENDIAN */
 
-static void encode_next_layer_portable(ReedSolomonTables *rt, unsigned char *data, unsigned char *parity, guint64 layer_size, int shift)
-{  gint32 *gf_index_of  = rt->gfTables->indexOf;
-   gint32 *enc_alpha_to = rt->gfTables->encAlphaTo;
+static void encode_generic_portable(ReedSolomonTables *rt, unsigned char *data, unsigned char *parity, guint64 layer_size, int shift)
+{  guint8 *gf_index_of  = rt->gfTables->indexOf;
+   guint8 *enc_alpha_to = rt->gfTables->encAlphaTo;
    gint32 *rs_gpoly     = rt->gpoly;
    int nroots           = rt->nroots;
    int nroots_aligned   = (nroots+15)&~15;
@@ -106,6 +106,94 @@ static void encode_next_layer_portable(ReedSolomonTables *rt, unsigned char *dat
    }
 }
 
+/*
+ * Specialized versions of the above for the common numbers of roots.
+ * The byte offset into the lookup table depends only on the shift
+ * value, so it is dispatched once per layer instead of once per byte.
+ * Together with nroots being a compile time constant this leaves
+ * fully unrolled 32 bit steps in the inner loop.
+ */
+
+#define SPAN_0(k) (e_lut[k])
+#define SPAN_1(k) ((e_lut[k] SHIFT_LEFT  8) | (e_lut[(k)+1] SHIFT_RIGHT 24))
+#define SPAN_2(k) ((e_lut[k] SHIFT_LEFT 16) | (e_lut[(k)+1] SHIFT_RIGHT 16))
+#define SPAN_3(k) ((e_lut[k] SHIFT_LEFT 24) | (e_lut[(k)+1] SHIFT_RIGHT  8))
+
+#define XOR_STEP(k, BO) par_idx[k] ^= SPAN_##BO(k);
+
+#define XOR_4(BO)  XOR_STEP(0,BO) XOR_STEP(1,BO) XOR_STEP(2,BO) XOR_STEP(3,BO)
+#define XOR_5(BO)  XOR_4(BO) XOR_STEP(4,BO)
+#define XOR_8(BO)  XOR_4(BO) XOR_STEP(4,BO) XOR_STEP(5,BO) XOR_STEP(6,BO) XOR_STEP(7,BO)
+#define XOR_16(BO) XOR_8(BO) XOR_STEP(8,BO) XOR_STEP(9,BO) XOR_STEP(10,BO) XOR_STEP(11,BO) \
+                   XOR_STEP(12,BO) XOR_STEP(13,BO) XOR_STEP(14,BO) XOR_STEP(15,BO)
+
+#define DEFINE_PORTABLE_LOOP(NROOTS, BO, XOR_STEPS) \
+static void encode_portable_##NROOTS##_##BO(ReedSolomonTables *rt, unsigned char *data, unsigned char *parity, guint64 layer_size, int shift) \
+{  guint8 *gf_index_of  = rt->gfTables->indexOf; \
+   guint8 *enc_alpha_to = rt->gfTables->encAlphaTo; \
+   int gpoly0           = rt->gpoly[0]; \
+   int word_offset      = (NROOTS-shift-1)&~3; \
+   int i; \
+\
+   for(i=0; i<layer_size; i++) \
+   {  int feedback = gf_index_of[data[i] ^ parity[shift]]; \
+\
+      if(feedback != GF_ALPHA0) \
+      {	 guint32 *par_idx = (guint32*)parity; \
+	 guint32 *e_lut   = (guint32*)(rt->bLut[feedback]+word_offset); \
+\
+	 XOR_STEPS(BO) \
+	 parity[shift] = enc_alpha_to[feedback + gpoly0]; \
+      } \
+      else parity[shift] = 0; \
+\
+      parity += (NROOTS+15)&~15; \
+   } \
+}
+
+#define DEFINE_PORTABLE_ENCODER(NROOTS, XOR_STEPS) \
+DEFINE_PORTABLE_LOOP(NROOTS, 0, XOR_STEPS) \
+DEFINE_PORTABLE_LOOP(NROOTS, 1, XOR_STEPS) \
+DEFINE_PORTABLE_LOOP(NROOTS, 2, XOR_STEPS) \
+DEFINE_PORTABLE_LOOP(NROOTS, 3, XOR_STEPS) \
+\
+static void encode_portable_##NROOTS(ReedSolomonTables *rt, unsigned char *data, unsigned char *parity, guint64 layer_size, int shift) \
+{  switch((NROOTS-shift-1)&3) \
+   {  case 0: encode_portable_##NROOTS##_0(rt, data, parity, layer_size, shift); break; \
+      case 1: encode_portable_##NROOTS##_1(rt, data, parity, layer_size, shift); break; \
+      case 2: encode_portable_##NROOTS##_2(rt, data, parity, layer_size, shift); break; \
+      case 3: encode_portable_##NROOTS##_3(rt, data, parity, layer_size, shift); break; \
+   } \
+}
+
+DEFINE_PORTABLE_ENCODER(16, XOR_4)
+DEFINE_PORTABLE_ENCODER(20, XOR_5)
+DEFINE_PORTABLE_ENCODER(32, XOR_8)
+DEFINE_PORTABLE_ENCODER(64, XOR_16)
+
+static struct
+{  int nroots;
+   void (*encode)(ReedSolomonTables*, unsigned char*, unsigned char*, guint64, int);
+} portable_encoders[] =
+{  { 16, encode_portable_16 },
+   { 20, encode_portable_20 },
+   { 32, encode_portable_32 },
+   { 64, encode_portable_64 },
+   {  0, NULL }
+};
+
+static void encode_next_layer_portable(ReedSolomonTables *rt, unsigned char *data, unsigned char *parity, guint64 layer_size, int shift)
+{  int i;
+
+   for(i=0; portable_encoders[i].nroots; i++)
+     if(portable_encoders[i].nroots == rt->nroots)
+     {  portable_encoders[i].encode(rt, data, parity, layer_size, shift);
+        return;
+     }
+
+   encode_generic_portable(rt, data, parity, layer_size, shift);
+}
+
 /*
  * Dispatch upon availability of SSE2 intrinsics
  */
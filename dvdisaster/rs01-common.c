@@ -109,12 +109,20 @@ CrcBuf *RS01GetCrcBuf(Image *image)
  *** Internal checksum handling.
  ***
  * Not overly complicated as we just have a global md5sum.
+ * It is calculated by a hashing thread so that the reader
+ * does not have to wait for it.
  */
 
 void RS01ResetCksums(Image *image)
 {  RS01CksumClosure *csc = (RS01CksumClosure*)image->eccFileMethod->ckSumClosure;
 
+   if(csc->md5Stream)   /* left over from an aborted read */
+      CloseHashStream(csc->md5Stream);
+   if(!csc->hashQueue)
+      csc->hashQueue = CreateHashQueue(1);
+
    MD5Init(&csc->md5ctxt);
+   csc->md5Stream = OpenHashStream(csc->hashQueue, &csc->md5ctxt);
 }
 
 void RS01UpdateCksums(Image *image, gint64 sector, unsigned char *buf)
@@ -123,7 +131,7 @@ void RS01UpdateCksums(Image *image, gint64 sector, unsigned char *buf)
    //#define BORK 34999
    //if(sector == BORK) buf[42]++; //FIXME
 
-   MD5Update(&csc->md5ctxt, buf, 2048);
+   HashStreamWrite(csc->md5Stream, buf, 2048);
 
    //if(sector == BORK) buf[42]--; //FIXME
 }
@@ -134,6 +142,8 @@ char* RS01FinalizeCksums(Image *image)
    guint8 image_fp[16];
    int good_fp;
 
+   CloseHashStream(csc->md5Stream);
+   csc->md5Stream = NULL;
    MD5Final(image_fp, &csc->md5ctxt);
 
    good_fp = !(memcmp(image_fp, image->eccFileHeader->mediumSum ,16));
@@ -207,11 +217,16 @@ void RS01ScanImage(Method *method, Image* image, struct MD5Context *ecc_ctxt, in
    guint32 *crcbuf = NULL;
    int crcidx = 0;
    struct MD5Context image_md5;
+   HashQueue *hash_queue;
+   HashStream *image_stream;
    gint64 s, first_missing, last_missing;
    gint64 prev_missing = 0;
    gint64 prev_crc_errors = 0;
    int last_percent,current_missing;
+   SectorMap *map;
    char *msg;
+   gint64 io_usecs = 0, crc_usecs = 0;
+   gint64 stats_start;
 
    /* Extract widget list from method */
 
@@ -235,6 +250,25 @@ void RS01ScanImage(Method *method, Image* image, struct MD5Context *ecc_ctxt, in
 
    MD5Init(&image_md5);              /* md5sum of image file itself */
    LargeSeek(image->file, 0);        /* rewind image file */   
+
+   /* The image md5sum is calculated by a separate thread
+      so that it overlaps with reading and CRC processing. */
+
+   hash_queue   = CreateHashQueue(1);
+   image_stream = OpenHashStream(hash_queue, &image_md5);
+
+   /* A sector map left behind by the reader tells us which sectors are
+      present and what their CRC32 sums are, so we can skip the
+      dead sector marker checks and the CRC calculation for them.
+      The md5sum over the image must still be calculated.
+      The map is only trusted if the image has not been touched since
+      the map was closed (see sector-map.c). For verifying it is not
+      used at all: there the CRCs are always calculated from the
+      sector contents. */
+
+   if(mode & CREATE_CRC)
+        map = OpenSectorMap(image->file->path, image->sectorSize, SECTOR_MAP_READONLY);
+   else map = NULL;
       
    if(mode & PRINT_MODE)
         msg = _("- testing sectors  : %3d%%");
@@ -247,22 +281,30 @@ void RS01ScanImage(Method *method, Image* image, struct MD5Context *ecc_ctxt, in
    /* Go through all sectors and look for the "dead sector marker" */
    
    for(s=0; s<image->sectorSize; s++)
-   {  int n,percent,err;
+   {  int n,percent,err,mapped;
 
       /* Check for user interruption */
 
       if(Closure->stopActions)   
       {  image->sectorsMissing += image->sectorSize - s;
 	 if(crcbuf) g_free(crcbuf);
+	 if(map) CloseSectorMap(map);
+	 CloseHashStream(image_stream);
+	 FreeHashQueue(hash_queue);
          return;
       }
 
       /* Read the next sector */
 
+      stats_start = StatsTimestamp();
       n = LargeRead(image->file, buf, 2048);
+      io_usecs += StatsTimestamp() - stats_start;
       if(n != 2048)
       {  if(s != image->sectorSize - 1 || n != image->inLast)
          {  if(crcbuf) g_free(crcbuf);
+	    if(map) CloseSectorMap(map);
+	    CloseHashStream(image_stream);
+	    FreeHashQueue(hash_queue);
 	    Stop(_("premature end in image (only %d bytes): %s\n"),n,strerror(errno));
          }
 	 else /* Zero unused sectors for CRC generation */
@@ -271,8 +313,12 @@ void RS01ScanImage(Method *method, Image* image, struct MD5Context *ecc_ctxt, in
 
       /* Look for the dead sector marker */
 
-      err = CheckForMissingSector(buf, s, image->fpState == 2 ? image->imageFP : NULL, 
-				  FINGERPRINT_SECTOR);
+      mapped = map && n == 2048 && SectorMapPresent(map, s);
+
+      if(mapped)
+	   err = SECTOR_PRESENT;
+      else err = CheckForMissingSector(buf, s, image->fpState == 2 ? image->imageFP : NULL, 
+				       FINGERPRINT_SECTOR);
       if(err != SECTOR_PRESENT)
       {    current_missing = TRUE;
 	   ExplainMissingSector(buf, s, err, TRUE);
@@ -302,7 +348,9 @@ void RS01ScanImage(Method *method, Image* image, struct MD5Context *ecc_ctxt, in
 	 /* If creation of the CRC32 is requested, do that. */
 
 	 if(mode & CREATE_CRC)
-	 {  crcbuf[crcidx++] = Crc32(buf, 2048);
+	 {  stats_start = StatsTimestamp();
+	    crcbuf[crcidx++] = mapped ? map->crc[s] : Crc32(buf, 2048);
+	    crc_usecs += StatsTimestamp() - stats_start;
 
 	    if(crcidx >= CRCBUFSIZE)  /* write out CRC buffer contents */
 	    {  size_t size = CRCBUFSIZE*sizeof(guint32);
@@ -319,7 +367,11 @@ void RS01ScanImage(Method *method, Image* image, struct MD5Context *ecc_ctxt, in
 	 /* else do the CRC32 check. Missing sectors are skipped in the CRC report. */
 	 
 	 else if(s < image->expectedSectors)
-	 {  guint32 crc = Crc32(buf, 2048); 
+	 {  guint32 crc;
+
+	    stats_start = StatsTimestamp();
+	    crc = Crc32(buf, 2048); 
+	    crc_usecs += StatsTimestamp() - stats_start;
 
             /* If the CRC buf is exhausted, refill. */
 
@@ -345,7 +397,7 @@ void RS01ScanImage(Method *method, Image* image, struct MD5Context *ecc_ctxt, in
 	 }
       }
 
-      MD5Update(&image_md5, buf, n);  /* update image md5sum */
+      HashStreamWrite(image_stream, buf, n);  /* update image md5sum */
 
       if(Closure->guiMode && mode & PRINT_MODE) 
 	   percent = (VERIFY_IMAGE_SEGMENTS*(s+1))/image->sectorSize;
@@ -383,10 +435,17 @@ void RS01ScanImage(Method *method, Image* image, struct MD5Context *ecc_ctxt, in
 
    /*** The image md5sum can only be calculated if all blocks have been successfully read. */
 
+   CloseHashStream(image_stream);
+   FreeHashQueue(hash_queue);
    MD5Final(image->mediumSum, &image_md5);
 
+   StatsCount(STAT_IO_WAIT, io_usecs);
+   StatsCount(STAT_CRC, crc_usecs);
+   StatsCount(STAT_BYTES_READ, 2048*image->sectorSize);
+
    LargeSeek(image->file, 0);
    if(crcbuf) g_free(crcbuf);
+   if(map) CloseSectorMap(map);
 }
 
 /***
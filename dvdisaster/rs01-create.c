@@ -64,7 +64,9 @@ static int calculate_redundancy(char *image_name)
 		 nr = (int)round((GF_FIELDMAX*p) / (100.0+p));
 	         break;
 
-      case 'm' : if(!LargeStat(image_name, &filesize))
+      case 'm' : if(!strcmp(image_name, "-"))   /* image from stdin */
+	           filesize = Closure->streamSize;
+	         else if(!LargeStat(image_name, &filesize))
   	         {  nr = 32;   /* If the image file is not present, simply return 32. */
 		    break;     /* Later stages will fail anyways, but can report the error */
 	         }             /* in a more meaningful context. */
@@ -108,6 +110,9 @@ typedef struct
    ReedSolomonTables *rt;
    Image *image;
    int earlyTermination;
+   int removeEcc;             /* ecc file is incomplete; remove it in ecc_cleanup() */
+   HashQueue *hashQueue;      /* image md5sum while encoding a stream */
+   HashStream *imageStream;
    unsigned char *data;
    unsigned char *parity;
    char *msg;
@@ -131,10 +136,13 @@ static void ecc_cleanup(gpointer data)
 
    if(ec->gt) FreeGaloisTables(ec->gt);
    if(ec->rt) FreeReedSolomonTables(ec->rt);
+   if(ec->imageStream) CloseHashStream(ec->imageStream);
+   if(ec->hashQueue) FreeHashQueue(ec->hashQueue);
    if(ec->data) g_free(ec->data);
    if(ec->parity) g_free(ec->parity);
 
    if(ec->image) CloseImage(ec->image);
+   if(ec->removeEcc) LargeUnlink(Closure->eccName);
    if(ec->msg)   g_free(ec->msg);
    if(ec->timer) g_timer_destroy(ec->timer);
 
@@ -149,6 +157,300 @@ static void ecc_cleanup(gpointer data)
       g_thread_exit(0);
 }
 
+/***
+ *** Create the ecc file for an image arriving through a pipe.
+ ***
+ * RS01 puts sector i of each of the ndata image sections into the same 
+ * ecc block, so reading the image front to back feeds all ecc blocks
+ * layer by layer. A single pass over the stream is therefore sufficient
+ * if the parity of all ecc blocks is kept in memory during the pass
+ * (about the size of the ecc file). We refuse to start if it is larger
+ * than STREAM_PARITY_LIMIT or --cache-size, whichever is more:
+ * Whether the allocation succeeds is no good measure on its own since
+ * with memory overcommitment it may succeed for more than can be backed,
+ * and updating the parity in the ecc file instead would take one pass
+ * over all parity per image section. Writing the image into a file and
+ * encoding it the usual way is much faster then.
+ * The image size must be known in advance (--stream-size) since it
+ * determines the section size.
+ */
+
+#define STREAM_BUFFER_SECTORS 1024   /* read buffer (2MB) */
+#define STREAM_PARITY_LIMIT   1024   /* MB of parity which may be kept in memory */
+
+typedef struct
+{  ecc_closure *ec;
+   Image *image;
+   ReedSolomonTables *rt;
+   int nroots, nrootsAligned;
+   guint64 layerSectors;             /* sectors per image section (= layer) */
+   guint64 totalSectors;             /* image plus zero padding to full layers */
+   gint64 parityStart;               /* file offset of the parity in the ecc file */
+   unsigned char *parity;            /* 16 byte aligned in ec->parity */
+} stream_closure;
+
+/*
+ * Read exactly count bytes from stdin unless the stream ends.
+ */
+
+static size_t read_stream(unsigned char *buf, size_t count)
+{  size_t total = 0;
+
+   while(total < count)
+   {  ssize_t n = read(fileno(stdin), buf+total, count-total);
+
+      if(n < 0)
+      {  if(errno == EINTR) continue;
+	 Stop(_("Failed reading image from standard input: %s"), strerror(errno));
+      }
+      if(!n) break;
+      total += n;
+   }
+
+   return total;
+}
+
+/*
+ * The ecc file holds nroots bytes per ecc block while the encoder works on
+ * nrootsAligned bytes per block.
+ */
+
+static void compact_parity(stream_closure *sc, guint64 blocks)
+{  guint64 i;
+
+   if(sc->nroots != sc->nrootsAligned)
+     for(i=1; i<blocks; i++)
+        memmove(sc->parity + i*sc->nroots, sc->parity + i*sc->nrootsAligned, sc->nroots);
+}
+
+/*
+ * Work the stream sectors [p0,p0+n) into the parity.
+ */
+
+static void encode_batch(stream_closure *sc, unsigned char *data, guint64 p0, guint64 n)
+{  guint64 p = p0;
+   gint64 stats_start = StatsTimestamp();
+
+   while(p < p0+n)
+   {  guint64 layer = p / sc->layerSectors;
+      guint64 q     = p % sc->layerSectors;
+      guint64 len   = MIN(p0+n-p, sc->layerSectors-q);
+
+      EncodeNextLayer(sc->rt, data + 2048*(p-p0),
+		      sc->parity + 2048*q*sc->nrootsAligned, 2048*len,
+		      (sc->rt->shiftInit + layer) % sc->nroots);
+      p += len;
+   }
+
+   StatsTime(STAT_ENCODE, stats_start);
+}
+
+/*
+ * Write out the parity and add it to the ecc file md5sum.
+ */
+
+static void finish_stream_parity(stream_closure *sc, struct MD5Context *md5Ctxt)
+{  guint64 total = 2048*sc->layerSectors*sc->nroots;
+   guint64 slice = 2048*STREAM_BUFFER_SECTORS;
+   guint64 offset;
+
+   if(!LargeSeek(sc->image->eccFile, sc->parityStart))
+      Stop(_("Failed seeking in ecc file: %s"), strerror(errno));
+
+   compact_parity(sc, 2048*sc->layerSectors);
+
+   for(offset=0; offset<total; offset+=slice)
+   {  guint64 size = MIN(slice, total-offset);
+      gint64 stats_start = StatsTimestamp();
+
+      if(LargeWrite(sc->image->eccFile, sc->parity+offset, size) != size)
+	 Stop(_("could not write to ecc file \"%s\":\n%s"),Closure->eccName,strerror(errno));
+      StatsTime(STAT_FLUSH, stats_start);
+      StatsCount(STAT_BYTES_WRITTEN, size);
+
+      MD5Update(md5Ctxt, sc->parity+offset, size);
+   }
+}
+
+/*
+ * Read the image from stdin, write the CRC portion of the ecc file
+ * and create the parity. Returns FALSE if aborted by the user.
+ */
+
+static int encode_stream(ecc_closure *ec, struct MD5Context *md5Ctxt)
+{  stream_closure sc;
+   Image *image = ec->image;
+   int ndata = ec->rt->ndata;
+   guint64 n_parity_bytes, parity_limit, p;
+   guint32 *crcbuf;
+   struct MD5Context image_md5;
+   int percent, last_percent = -1;
+   gint64 stats_start;
+   char *msg = _("Reading and encoding image: %3d%%");
+
+   memset(&sc, 0, sizeof(sc));
+   sc.ec            = ec;
+   sc.image         = image;
+   sc.rt            = ec->rt;
+   sc.nroots        = ec->rt->nroots;
+   sc.nrootsAligned = (sc.nroots+15)&~15;
+   sc.layerSectors  = (image->sectorSize+ndata-1)/ndata;
+   sc.totalSectors  = sc.layerSectors*ndata;
+   sc.parityStart   = sizeof(EccHeader) + image->sectorSize*sizeof(guint32);
+
+#ifdef SYS_MINGW
+   setmode(fileno(stdin), O_BINARY);
+#endif
+
+   /* All parity must fit into memory; check before reading anything */
+
+   n_parity_bytes = 2048*sc.layerSectors*sc.nrootsAligned;
+   parity_limit   = (guint64)MAX(Closure->cacheMB, STREAM_PARITY_LIMIT)<<20;
+
+   if(n_parity_bytes > parity_limit)
+   {  gint64 needed = (n_parity_bytes+(1<<20)-1)>>20;
+
+      if(needed <= MAX_OLD_CACHE_SIZE)
+	 Stop(_("Encoding this image stream needs %lldMB of memory for the parity.\n"
+		"Use --cache-size %lld or write the image into a file first.\n"),
+	      needed, needed);
+      else
+	 Stop(_("Encoding this image stream needs %lldMB of memory for the parity,\n"
+		"which is more than the --cache-size maximum of %dMB.\n"
+		"Write the image into a file first.\n"),
+	      needed, MAX_OLD_CACHE_SIZE);
+   }
+
+   if((gsize)(n_parity_bytes+16) == n_parity_bytes+16)
+      ec->parity = g_try_malloc(n_parity_bytes+16);
+   ec->data = g_try_malloc(2048*STREAM_BUFFER_SECTORS);
+   crcbuf   = g_try_malloc(sizeof(guint32)*STREAM_BUFFER_SECTORS);
+
+   if(!ec->parity || !ec->data || !crcbuf)
+      Stop(_("Failed allocating %lldMB of memory for the parity.\n"
+	     "Write the image into a file first.\n"),
+	   n_parity_bytes>>20);
+
+   memset(ec->parity, 0, n_parity_bytes+16);
+
+   sc.parity = ec->parity + (16 - ((unsigned long)ec->parity & 15));
+
+   /* The image md5sum is calculated by a separate thread */
+
+   MD5Init(md5Ctxt);       /* md5sum of the CRC portion of the ecc file */
+   MD5Init(&image_md5);
+   ec->hashQueue   = CreateHashQueue(1);
+   ec->imageStream = OpenHashStream(ec->hashQueue, &image_md5);
+
+   /*** Process the stream in batches */
+
+   for(p=0; p<sc.totalSectors; )
+   {  guint64 n = MIN(STREAM_BUFFER_SECTORS, sc.totalSectors-p);
+      guint64 n_image = p < image->sectorSize ? MIN(n, image->sectorSize-p) : 0;
+      guint64 i;
+
+      if(Closure->stopActions)   /* User hit the Stop button */
+      {  g_free(crcbuf);
+	 return FALSE;
+      }
+
+      /* Read the image sectors; the last one may be incomplete.
+	 Beyond the image everything is zero padding. */
+
+      if(n_image)
+      {  size_t expected = 2048*n_image;
+	 size_t got;
+
+	 if(p+n_image == image->sectorSize)
+	    expected -= 2048-image->inLast;
+
+	 stats_start = StatsTimestamp();
+	 got = read_stream(ec->data, expected);
+	 StatsTime(STAT_IO_WAIT, stats_start);
+	 StatsCount(STAT_BYTES_READ, got);
+
+	 if(got != expected)
+	    Stop(_("Premature end of image stream after %lld bytes (expected %lld)."),
+		 2048*p+got, 2048*(image->sectorSize-1)+image->inLast);
+
+	 HashStreamWrite(ec->imageStream, ec->data, expected);
+	 memset(ec->data+expected, 0, 2048*n-expected);
+      }
+      else memset(ec->data, 0, 2048*n);
+
+      /* Look for dead sector markers, create the CRC sums and the fingerprint */
+
+      stats_start = StatsTimestamp();
+
+      for(i=0; i<n_image; i++)
+      {  unsigned char *buf = ec->data + 2048*i;
+	 int err;
+
+	 if(p+i == FINGERPRINT_SECTOR)
+	 {  struct MD5Context fp_ctxt;
+
+	    MD5Init(&fp_ctxt);
+	    MD5Update(&fp_ctxt, buf, 2048);
+	    MD5Final(image->imageFP, &fp_ctxt);
+	    image->fpState = 2;
+	 }
+
+	 err = CheckForMissingSector(buf, p+i, image->fpState == 2 ? image->imageFP : NULL, 
+				     FINGERPRINT_SECTOR);
+	 if(err != SECTOR_PRESENT)
+	 {  ExplainMissingSector(buf, p+i, err, TRUE);
+	    image->sectorsMissing++;
+	 }
+
+	 crcbuf[i] = Crc32(buf, 2048);
+      }
+
+      StatsTime(STAT_CRC, stats_start);
+
+      if(n_image)
+      {  size_t size = n_image*sizeof(guint32);
+
+	 MD5Update(md5Ctxt, (unsigned char*)crcbuf, size);
+	 if(   !LargeSeek(image->eccFile, (gint64)sizeof(EccHeader) + p*sizeof(guint32))
+	    || LargeWrite(image->eccFile, crcbuf, size) != size)
+	    Stop(_("Error writing CRC information: %s"), strerror(errno));
+      }
+
+      /* Work the batch into the parity */
+
+      encode_batch(&sc, ec->data, p, n);
+
+      p += n;
+
+      percent = (100*p)/sc.totalSectors;
+      if(last_percent != percent) 
+      {  PrintProgress(msg, percent);
+	 last_percent = percent;
+      }
+   }
+
+   g_free(crcbuf);
+   CloseHashStream(ec->imageStream);
+   FreeHashQueue(ec->hashQueue);
+   ec->imageStream = NULL;
+   ec->hashQueue   = NULL;
+   MD5Final(image->mediumSum, &image_md5);
+
+   /* Make sure that the stream had the announced size */
+
+   if(read_stream(ec->data, 1))
+      Stop(_("Image stream is larger than the --stream-size of %lld bytes."),
+	   2048*(image->sectorSize-1)+image->inLast);
+
+   if(image->sectorsMissing)
+      Stop(_("%lld sectors unread or missing due to errors.\n"), image->sectorsMissing);
+
+   finish_stream_parity(&sc, md5Ctxt);
+   PrintProgress(msg, 100);
+
+   return TRUE;
+}
+
 /*
  * Create the parity file.
  */
@@ -171,12 +473,14 @@ void RS01Create(void)
    guint64 n_parity_blocks,n_layer_sectors;
    guint64 n_parity_bytes,n_layer_bytes;
    guint64 chunk;
+   gint64 stats_start;
    int layer;
    int loop_type = GENERIC;
+   int stream = !strcmp(Closure->imageName, "-");
    gint32 nroots;         /* These are copied to increase performance. */
    gint32 ndata;
-   gint32 *gf_index_of;
-   gint32 *enc_alpha_to;
+   guint8 *gf_index_of;
+   guint8 *enc_alpha_to;
    gint32 *rs_gpoly;
 
    /*** Register the cleanup procedure for GUI mode */
@@ -234,13 +538,24 @@ void RS01Create(void)
 
    /* Open image and ecc files */
 
-   PrintLog(_("\nOpening %s"), Closure->imageName);
+   if(stream)
+   {  if(!Closure->streamSize)
+	 Stop(_("Reading the image from standard input requires --stream-size."));
 
-   image = OpenImageFromFile(Closure->imageName, O_RDONLY, IMG_PERMS);
-   ec->image = image;
-   if(!image)
-   {  PrintLog(": %s.\n", strerror(errno));
-      Stop(_("Image file %s: %s."),Closure->imageName, strerror(errno));
+      PrintLog(_("\nReading image from standard input"));
+      image = ec->image = g_malloc0(sizeof(Image));
+      image->type = IMAGE_NONE;
+      CalcSectors(Closure->streamSize, &image->sectorSize, &image->inLast);
+   }
+   else
+   {  PrintLog(_("\nOpening %s"), Closure->imageName);
+
+      image = OpenImageFromFile(Closure->imageName, O_RDONLY, IMG_PERMS);
+      ec->image = image;
+      if(!image)
+      {  PrintLog(": %s.\n", strerror(errno));
+	 Stop(_("Image file %s: %s."),Closure->imageName, strerror(errno));
+      }
    }
    if(image->inLast == 2048)
         PrintLog(_(": %lld medium sectors.\n"), image->sectorSize);
@@ -253,7 +568,22 @@ void RS01Create(void)
 
    ec->timer   = g_timer_new();
 
-   if(Closure->crcCache)   /* use CRC values created during last read */
+   if(stream)   /* CRC sums and parity in a single pass */
+   {  ec->removeEcc = TRUE;  /* until the header has been written */
+
+      if(Closure->guiMode)
+	SetLabelText(GTK_LABEL(wl->encLabel1),
+		     _("<b>1. Reading and encoding the image:</b>"));
+
+      if(!encode_stream(ec, &md5Ctxt))
+      {  SetLabelText(GTK_LABEL(wl->encFootline), 
+		      _("<span %s>Aborted by user request!</span> (partial error correction file removed)"),
+		      Closure->redMarkup); 
+	 ec->earlyTermination = FALSE;  /* suppress respective error message */
+	 goto terminate;
+      }
+   }
+   else if(Closure->crcCache)   /* use CRC values created during last read */
    {  guint32 crc_idx;
       int percent, last_percent = 0;
       char *msg = _("Writing sector checksums: %3d%%");
@@ -330,7 +660,8 @@ void RS01Create(void)
       }
    }
 
-   PrintTimeToLog(ec->timer, "for CRC writing/generation.\n");
+   if(!stream)
+     PrintTimeToLog(ec->timer, "for CRC writing/generation.\n");
 
    if(Closure->guiMode)
    {  SetProgress(wl->encPBar1, 100, 100);
@@ -378,6 +709,9 @@ void RS01Create(void)
    memcpy(eh->mediumFP, image->imageFP, 16);
    memcpy(eh->mediumSum, image->mediumSum, 16);
 
+   if(stream)   /* parity has already been written */
+      goto write_header;
+
    if(!LargeSeek(image->eccFile, (gint64)sizeof(EccHeader) + image->sectorSize*sizeof(guint32)))
 	Stop(_("Failed skipping ecc+crc header: %s"),strerror(errno));
 
@@ -468,14 +802,20 @@ void RS01Create(void)
 
 	    /* Read the next data sectors of this layer. */
 
+	    stats_start = StatsTimestamp();
+
 	    for(si=0; si<actual_layer_sectors; si++)
 	    {  RS01ReadSector(image, ec->data+offset, block_idx[layer]);
 	       block_idx[layer]++;
 	       offset += 2048;
 	    }
 
+	    StatsTime(STAT_IO_WAIT, stats_start);
+
 	    /* Now process the data bytes of the current layer. */
 
+	    stats_start = StatsTimestamp();
+
 	    for(si=0; si<actual_layer_bytes; si++)
 	    {  register int feedback;
 
@@ -526,6 +866,8 @@ void RS01Create(void)
 
 	    sp = (sp+1) & 31;         /* shift */
 
+	    StatsTime(STAT_ENCODE, stats_start);
+
 	    /* Report progress */
 
 	    progress++;
@@ -560,14 +902,20 @@ void RS01Create(void)
 
 	    /* Read the next data sectors of this layer. */
 
+	    stats_start = StatsTimestamp();
+
 	    for(si=0; si<actual_layer_sectors; si++)
 	    {  RS01ReadSector(image, ec->data+offset, block_idx[layer]);
 	       block_idx[layer]++;
 	       offset += 2048;
 	    }
 
+	    StatsTime(STAT_IO_WAIT, stats_start);
+
 	    /* Now process the data bytes of the current layer. */
 
+	    stats_start = StatsTimestamp();
+
 	    for(si=0; si<actual_layer_bytes; si++)
 	    {  register int feedback;
 
@@ -650,6 +998,8 @@ void RS01Create(void)
 
 	    sp = (sp+1) & 63;         /* shift */
 
+	    StatsTime(STAT_ENCODE, stats_start);
+
 	    /* Report progress */
 
 	    progress++;
@@ -687,14 +1037,20 @@ void RS01Create(void)
 
             /* Read the next data sectors of this layer. */
 
+	    stats_start = StatsTimestamp();
+
    	    for(si=0; si<actual_layer_sectors; si++)
 	    {  RS01ReadSector(image, ec->data+offset, block_idx[layer]);
 	       block_idx[layer]++;
 	       offset += 2048;
 	    }
 
+	    StatsTime(STAT_IO_WAIT, stats_start);
+
 	    /* Now process the data bytes of the current layer. */
 
+	    stats_start = StatsTimestamp();
+
 	    for(si=0; si<actual_layer_bytes; si++)
 	    {  register int feedback;
 
@@ -944,6 +1300,8 @@ void RS01Create(void)
 
 	    if(++sp>=nroots) sp=0;   /* shift */
 
+	    StatsTime(STAT_ENCODE, stats_start);
+
 	    /* Report progress */
 
 	    progress++;
@@ -960,18 +1318,28 @@ void RS01Create(void)
 	break;
       }
 
+      StatsCount(STAT_BYTES_READ, ndata*actual_layer_bytes);
+      StatsCount(STAT_ECC_BLOCKS, actual_layer_bytes);
+
       /* Write the nroots bytes of parity information */
 
+      stats_start = StatsTimestamp();
       n = LargeWrite(image->eccFile, ec->parity, nroots*actual_layer_bytes);
 
       if(n != nroots*actual_layer_bytes)
         Stop(_("could not write to ecc file \"%s\":\n%s"),Closure->eccName,strerror(errno));
 
+      StatsTime(STAT_FLUSH, stats_start);
+      StatsCount(STAT_BYTES_WRITTEN, nroots*actual_layer_bytes);
+
+      stats_start = StatsTimestamp();
       MD5Update(&md5Ctxt, ec->parity, nroots*actual_layer_bytes);
+      StatsTime(STAT_MD5, stats_start);
    }
 
    /*** Complete the ecc header and write it out */
 
+write_header:
    MD5Final(eh->eccSum, &md5Ctxt);
 
    LargeSeek(image->eccFile, 0);
@@ -985,6 +1353,7 @@ void RS01Create(void)
    if(!LargeClose(image->eccFile))
      Stop(_("Error closing error correction file:\n%s"), strerror(errno));
    image->eccFile = NULL;
+   ec->removeEcc = FALSE;
 
    PrintTimeToLog(ec->timer, "for ECC generation.\n");
 
@@ -1005,7 +1374,7 @@ void RS01Create(void)
 	unlink the image.
 	Windows can not unlink until all file handles are closed. Duh. */
 
-   if(Closure->unlinkImage)
+   if(Closure->unlinkImage && !stream)
    {  if(ec->image) CloseImage(ec->image);
       ec->image = NULL;
       UnlinkImage(Closure->guiMode ? wl->encFootline2 : NULL);
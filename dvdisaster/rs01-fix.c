@@ -125,10 +125,11 @@ void RS01Fix(Image *image)
    int cache_size,cache_sector,cache_offset = 0;
    int local_plot_max;
    char *t = NULL;
+   gint64 stats_start;
    gint32 nroots;         /* These are copied to increase performance. */
    gint32 ndata;
-   gint32 *gf_index_of;
-   gint32 *gf_alpha_to;
+   guint8 *gf_index_of;
+   guint8 *gf_alpha_to;
 
    /*** Register the cleanup procedure for GUI mode */
 
@@ -378,6 +379,7 @@ void RS01Fix(Image *image)
 
      if(cache_sector >= cache_size)
      {  
+        stats_start = StatsTimestamp();
         if(s-si < cache_size)
            cache_size = s-si;
         for(i=0; i<ndata; i++)
@@ -389,12 +391,15 @@ void RS01Fix(Image *image)
 	   read_crc(image->eccFile, fc->crcBuf[i], block_idx[i], cache_size);
 	}
         cache_sector = cache_offset = 0;
+        StatsTime(STAT_IO_WAIT, stats_start);
+        StatsCount(STAT_BYTES_READ, 2048*(gint64)ndata*cache_size);
      }
 
      /* Determine erasures based on the "dead sector" marker */
 
      erasure_count = 0;
      unexpected_failure = 0;
+     stats_start = StatsTimestamp();
 
      for(i=0; i<ndata; i++)
      {  guint32 crc = Crc32(fc->imgBlock[i]+cache_offset, 2048);
@@ -416,6 +421,9 @@ void RS01Fix(Image *image)
 	}
      }
 
+     StatsTime(STAT_CRC, stats_start);
+     StatsCount(STAT_ECC_BLOCKS, 2048);
+
      if(!erasure_count)  /* Skip completely read blocks */
      {  parity_block+=2048;
         goto skip;
@@ -446,6 +454,7 @@ void RS01Fix(Image *image)
 
 	uncorrected += erasure_count;
 	parity_block+=2048;
+	StatsCount(STAT_UNCORRECTABLE, erasure_count);
 
 	/* For truncated images, make sure we leave no "zero holes" in the image
 	   by writing the sector(s) with our "dead sector" markers. */
@@ -470,7 +479,14 @@ void RS01Fix(Image *image)
 	}
      }
      else  /* try to correct them */
-     {  int bi;
+     {  gint64 io_usecs = 0, syn_usecs = 0;
+        int bi;
+
+        /* Everything except reading the parity and
+	   forming the syndromes is accounted as decoding */
+
+        stats_start = StatsTimestamp();
+        StatsCount(STAT_ERASURES, erasure_count);
 
         for(bi=0; bi<2048; bi++)
         {  int offset = cache_offset+bi;
@@ -480,9 +496,11 @@ void RS01Fix(Image *image)
 	   int b[nroots+1], t[nroots+1], omega[nroots+1];
 	   int root[nroots], reg[nroots+1], loc[nroots];
 	   int syn_error, count;
+	   gint64 t0,t1;
 
 	   /* Read the parity bytes */
 
+	   t0 = StatsTimestamp();
 	   if(!LargeSeek(image->eccFile, (gint64)(sizeof(EccHeader) + image->expectedSectors*sizeof(guint32) + nroots*parity_block)))
 	     Stop(_("Failed seeking in ecc area: %s"), strerror(errno));
 
@@ -490,6 +508,8 @@ void RS01Fix(Image *image)
 	   if(n != nroots)
 	     Stop(_("Can't read ecc file:\n%s"),strerror(errno));
 	   parity_block++;
+	   t1 = StatsTimestamp();
+	   io_usecs += t1-t0;
 
 	   /* Form the syndromes; i.e., evaluate data(x) at roots of g(x) */
 
@@ -512,6 +532,7 @@ void RS01Fix(Image *image)
            {  syn_error |= s[i];
 	      s[i] = gf_index_of[s[i]];
 	   }
+	   syn_usecs += StatsTimestamp()-t1;
 
 	   /* If it is already correct by coincidence,
 	      we have nothing to do any further */
@@ -701,6 +722,10 @@ void RS01Fix(Image *image)
 	      }
 	   }
 	}
+
+	StatsCount(STAT_IO_WAIT, io_usecs);
+	StatsCount(STAT_SYNDROME, syn_usecs);
+	StatsCount(STAT_DECODE, StatsTimestamp()-stats_start-io_usecs-syn_usecs);
      }
 
      /*** Report if any sectors could be recovered.
@@ -708,6 +733,7 @@ void RS01Fix(Image *image)
 
      if(erasure_count && erasure_count<=nroots)
      {  PrintCLI(_("  %3d repaired sectors: "), erasure_count);
+        stats_start = StatsTimestamp();
 
         for(i=0; i<erasure_count; i++)
 	{  gint64 idx = block_idx[erasure_list[i]];
@@ -731,6 +757,9 @@ void RS01Fix(Image *image)
 
 	PrintCLI("\n");
 	corrected += erasure_count;
+	StatsTime(STAT_FLUSH, stats_start);
+	StatsCount(STAT_CORRECTED, erasure_count);
+	StatsCount(STAT_BYTES_WRITTEN, 2048*erasure_count);
      }
 
 skip:
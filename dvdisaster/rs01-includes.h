@@ -103,6 +103,8 @@ typedef struct
 
 typedef struct
 {  struct MD5Context md5ctxt;   /* Complete image checksum */
+   HashQueue *hashQueue;        /* offloads the md5sum from the reader */
+   HashStream *md5Stream;
 } RS01CksumClosure;
 
 /* 
@@ -111,11 +111,24 @@ CrcBuf *RS02GetCrcBuf(Image *image)
 void RS02ResetCksums(Image *image)
 {  RS02CksumClosure *csc = (RS02CksumClosure*)image->eccMethod->ckSumClosure;
 
+   /* The md5sums over the full image and the data portion are
+      calculated by hashing threads; the remaining ones are small. */
+
+   if(csc->md5Stream)   /* left over from an aborted read */
+   {  CloseHashStream(csc->md5Stream);
+      CloseHashStream(csc->dataStream);
+   }
+   if(!csc->hashQueue)
+      csc->hashQueue = CreateHashQueue(2);
+
    MD5Init(&csc->md5ctxt);
    MD5Init(&csc->dataCtxt);
    MD5Init(&csc->crcCtxt);
    MD5Init(&csc->eccCtxt);
    MD5Init(&csc->metaCtxt);
+
+   csc->md5Stream  = OpenHashStream(csc->hashQueue, &csc->md5ctxt);
+   csc->dataStream = OpenHashStream(csc->hashQueue, &csc->dataCtxt);
 }
 
 //#define BORK 35071  //FIXME
@@ -125,14 +138,14 @@ void RS02UpdateCksums(Image *image, gint64 sector, unsigned char *buf)
    /* md5sum over full image */
    //if(sector == BORK) buf[42]++; //FIXME
 
-   MD5Update(&csc->md5ctxt, buf, 2048);
+   HashStreamWrite(csc->md5Stream, buf, 2048);
 
    /* md5sum the data portion */
 
    if(sector < csc->lay->dataSectors)
    {  if(sector < csc->lay->dataSectors - 1)
-	   MD5Update(&csc->dataCtxt, buf, 2048);
-      else MD5Update(&csc->dataCtxt, buf, image->eccHeader->inLast);
+	   HashStreamWrite(csc->dataStream, buf, 2048);
+      else HashStreamWrite(csc->dataStream, buf, image->eccHeader->inLast);
    }
 
    /* md5sum the crc portion */
@@ -165,6 +178,10 @@ char* RS02FinalizeCksums(Image *image)
    guint8 image_fp[16];
    guint8 data_md5[16],crc_md5[16],meta_md5[16];
 
+   CloseHashStream(csc->md5Stream);
+   CloseHashStream(csc->dataStream);
+   csc->md5Stream = csc->dataStream = NULL;
+
    MD5Final(image_fp, &csc->md5ctxt);
    MD5Final(data_md5, &csc->dataCtxt);
    MD5Final(crc_md5,  &csc->crcCtxt);
@@ -150,11 +150,15 @@ static void remove_old_ecc(ecc_closure *ec)
 
 static void check_image(ecc_closure *ec)
 {  struct MD5Context image_md5;
+   HashQueue *hash_queue;
+   HashStream *image_stream;
    RS02Layout *lay = ec->lay;
    Image *image = ec->image;
    gint64 sectors;
    guint32 *crcptr;
    int last_percent, percent;
+   gint64 io_usecs = 0, crc_usecs = 0;
+   gint64 stats_start;
 
    /* Discard old CRC cache no matter what it contains.
     * We will create a new one a few lines below.
@@ -168,6 +172,8 @@ static void check_image(ecc_closure *ec)
 
    last_percent = 0;
    MD5Init(&image_md5);
+   hash_queue   = CreateHashQueue(1);
+   image_stream = OpenHashStream(hash_queue, &image_md5);
    
    Closure->crcCache = crcptr = g_malloc(sizeof(guint32) * lay->dataSectors);
 
@@ -179,7 +185,10 @@ static void check_image(ecc_closure *ec)
       int expected,n,err;
 
       if(Closure->stopActions) /* User hit the Stop button */
-	abort_encoding(ec, FALSE);
+      {  CloseHashStream(image_stream);
+	 FreeHashQueue(hash_queue);
+	 abort_encoding(ec, FALSE);
+      }
 
       if(sectors < image->sectorSize-1) expected = 2048;
       else  
@@ -187,9 +196,11 @@ static void check_image(ecc_closure *ec)
 	 expected = image->inLast;
       }
 
+      stats_start = StatsTimestamp();
       n = LargeRead(image->file, buf, expected);
       if(n != expected)
 	Stop(_("Failed reading sector %lld in image: %s"),sectors,strerror(errno));
+      io_usecs += StatsTimestamp() - stats_start;
 
       /* Look for the dead sector marker */
 
@@ -212,8 +223,10 @@ static void check_image(ecc_closure *ec)
       
       /* Update and cache the CRC sums */
 
+      stats_start = StatsTimestamp();
       *crcptr++ = Crc32(buf, 2048);
-      MD5Update(&image_md5, buf, n);
+      crc_usecs += StatsTimestamp() - stats_start;
+      HashStreamWrite(image_stream, buf, n);
 
       percent = (100*sectors)/(lay->eccSectors + lay->dataSectors);
 
@@ -227,7 +240,13 @@ static void check_image(ecc_closure *ec)
       }
    }
 
+   CloseHashStream(image_stream);
+   FreeHashQueue(hash_queue);
    MD5Final(image->mediumSum, &image_md5);
+
+   StatsCount(STAT_IO_WAIT, io_usecs);
+   StatsCount(STAT_CRC, crc_usecs);
+   StatsCount(STAT_BYTES_READ, 2048*lay->dataSectors);
 }
 
 
@@ -432,16 +451,18 @@ static void create_reed_solomon(ecc_closure *ec)
    int nroots = lay->nroots;
    int ndata  = lay->ndata;
    gint64 b_idx, block_idx[256]; 
+   struct MD5Context *md5_ctxt[256];
    guint64 n_parity_blocks,n_layer_sectors;
    guint64 n_parity_bytes,n_layer_bytes;
    guint64 si,chunk;
+   gint64 stats_start;
    int last_percent, percent, max_percent, progress;
    int layer,i,j,k;
    unsigned char *par_ptr;
    int out_of_memory = 0;
-static gint32 *gf_index_of;    /* These need to be static globals */
+static guint8 *gf_index_of;    /* These need to be static globals */
 static gint32 *rs_gpoly;       /* for optimization reasons. */
-static gint32 *enc_alpha_to;
+static guint8 *enc_alpha_to;
 
    /*** Show the second progress bar */
 
@@ -514,7 +535,9 @@ static gint32 *enc_alpha_to;
    /*** Initialize md5 contexts for checksumming the nroots slices */
 
    for(i=0; i<nroots; i++)
-      MD5Init(&ec->md5Ctxt[i]);
+   {  MD5Init(&ec->md5Ctxt[i]);
+      md5_ctxt[i] = &ec->md5Ctxt[i];
+   }
 
    /*** Create ecc information for the protected sectors portion of the image. */ 
 
@@ -560,14 +583,20 @@ static gint32 *enc_alpha_to;
 
          /* Read the next data sectors of this layer. */
 
+	 stats_start = StatsTimestamp();
+
    	 for(si=0; si<actual_layer_sectors; si++)
 	 {  RS02ReadSector(image, lay, ec->data+offset, block_idx[layer]);
 	    block_idx[layer]++;
 	    offset += 2048;
 	 }
 
+	 StatsTime(STAT_IO_WAIT, stats_start);
+
 	 /* Now process the data bytes of the current layer. */
 
+	 stats_start = StatsTimestamp();
+
 	 for(si=0; si<actual_layer_bytes; si++)
 	 {  register int feedback;
 
@@ -937,6 +966,8 @@ static gint32 *enc_alpha_to;
 
 	 if(++sp>=nroots) sp=0;   /* shift */
 
+	 StatsTime(STAT_ENCODE, stats_start);
+
 	 /* Report progress */
 
 	 progress++;
@@ -954,6 +985,10 @@ static gint32 *enc_alpha_to;
       /* The parity bytes have been prepared as sequences of nroots bytes for each 
 	 ecc block. Now we split them up into nroots slices and write them out. */
 
+      StatsCount(STAT_BYTES_READ, ndata*actual_layer_bytes);
+      StatsCount(STAT_ECC_BLOCKS, actual_layer_bytes);
+
+      stats_start = StatsTimestamp();
       par_ptr = ec->parity;
 
       for(si=0; si<actual_layer_sectors; si++)
@@ -976,10 +1011,18 @@ static gint32 *enc_alpha_to;
 
 	    if(LargeWrite(image->file, ec->slice[k]+idx, 2048) != 2048)
 	      Stop(_("Failed writing to sector %lld in image: %s"), s, strerror(errno));
-
-	    MD5Update(&ec->md5Ctxt[k], ec->slice[k]+idx, 2048);
 	}
       }
+
+      StatsTime(STAT_FLUSH, stats_start);
+      StatsCount(STAT_BYTES_WRITTEN, nroots*actual_layer_bytes);
+
+      /* Update the md5sums of all slices in lockstep; 
+         MD5UpdateMulti() takes the individual slice pointers */
+
+      stats_start = StatsTimestamp();
+      MD5UpdateMulti(md5_ctxt, ec->slice, nroots, 2048*actual_layer_sectors);
+      StatsTime(STAT_MD5, stats_start);
    }
 
    /*** We can store only one md5sum in the header,
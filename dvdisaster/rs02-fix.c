@@ -139,8 +139,8 @@ void RS02Fix(Image *image)
 #ifdef HAVE_BIG_ENDIAN
    EccHeader *eh_swapped;
 #endif
-   gint32 *gf_index_of;
-   gint32 *gf_alpha_to;
+   guint8 *gf_index_of;
+   guint8 *gf_alpha_to;
    gint64 block_idx[255];
    gint64 s;
    guint32 crc_buf[512];
@@ -158,6 +158,8 @@ void RS02Fix(Image *image)
    gint64 data_count=0;
    gint64 ecc_count=0;
    gint64 crc_count=0;
+   gint64 stats_start, dec_start = 0;
+   gint64 syn_usecs = 0, write_usecs = 0;
    gint64 data_corr=0;
    gint64 ecc_corr=0;
    gint64 corrected=0;
@@ -365,6 +367,7 @@ void RS02Fix(Image *image)
 
      if(cache_sector >= cache_size)
      {  
+        stats_start = StatsTimestamp();
         if(lay->sectorsPerLayer-si < cache_size)
            cache_size = lay->sectorsPerLayer-si;
 
@@ -394,11 +397,14 @@ void RS02Fix(Image *image)
 	}
 
         cache_sector = cache_offset = 0;
+        StatsTime(STAT_IO_WAIT, stats_start);
+        StatsCount(STAT_BYTES_READ, 2048*(gint64)GF_FIELDMAX*cache_size);
      }
 
      /* Look for erasures based on the "dead sector" marker and CRC sums */
 
      erasure_count = error_count = 0;
+     stats_start = StatsTimestamp();
 
      for(i=0; i<lay->ndata; i++)  /* Check the data sectors */
      {  
@@ -461,6 +467,10 @@ void RS02Fix(Image *image)
 	ecc_count++;
      }
 
+     StatsTime(STAT_CRC, stats_start);
+     StatsCount(STAT_ECC_BLOCKS, 2048);
+     StatsCount(STAT_ERASURES, erasure_count);
+
      /* Trivially reject uncorrectable ecc block */
 
      if(erasure_count>lay->nroots)   /* uncorrectable */
@@ -476,10 +486,15 @@ void RS02Fix(Image *image)
 	}
 
 	uncorrected += erasure_count;
+	StatsCount(STAT_UNCORRECTABLE, erasure_count);
 	goto skip;
      }
 
-     /* Build ecc block and attempt to correct it */
+     /* Build ecc block and attempt to correct it.
+        Everything but forming the syndromes is accounted as decoding. */
+
+     syn_usecs = write_usecs = 0;
+     dec_start = StatsTimestamp();
 
      for(bi=0; bi<2048; bi++)  /* Run through each ecc block byte */
      {  int offset = cache_offset+bi;
@@ -493,6 +508,8 @@ void RS02Fix(Image *image)
 
 	/* Form the syndromes; i.e., evaluate data(x) at roots of g(x) */
 
+	stats_start = StatsTimestamp();
+
 	for(i=0; i<nroots; i++)
 	  syn[i] = fc->imgBlock[0][offset];
 
@@ -512,6 +529,7 @@ void RS02Fix(Image *image)
 	{  syn_error |= syn[i];
 	   syn[i] = gf_index_of[syn[i]];
 	}
+	syn_usecs += StatsTimestamp() - stats_start;
 
 	/* If it is already correct by coincidence, we have nothing to do any further */
 
@@ -631,6 +649,7 @@ void RS02Fix(Image *image)
 	   }
 	   PrintLog("\n");
 	   uncorrected += erasure_count;
+	   StatsCount(STAT_UNCORRECTABLE, erasure_count);
 	   goto skip;
 	}
 
@@ -716,6 +735,7 @@ void RS02Fix(Image *image)
 
      if(erasure_count)
      {  PrintCLI(_("  %3d repaired sectors: "), erasure_count);
+        stats_start = StatsTimestamp();
 
         for(i=0; i<255; i++)
         {  gint64 sec;
@@ -761,9 +781,19 @@ void RS02Fix(Image *image)
 	}
 
 	PrintCLI("\n");
+	write_usecs = StatsTimestamp() - stats_start;
+	StatsCount(STAT_FLUSH, write_usecs);
+	StatsCount(STAT_CORRECTED, erasure_count);
+	StatsCount(STAT_BYTES_WRITTEN, 2048*erasure_count);
      }
 
 skip:
+     if(dec_start)
+     {  StatsCount(STAT_SYNDROME, syn_usecs);
+        StatsCount(STAT_DECODE, StatsTimestamp() - dec_start - syn_usecs - write_usecs);
+	dec_start = 0;
+     }
+
      /* Collect some damage statistics */
      
      if(erasure_count)
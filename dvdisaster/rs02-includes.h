@@ -114,6 +114,9 @@ typedef struct
    struct MD5Context crcCtxt;
    struct MD5Context eccCtxt;
    struct MD5Context metaCtxt;
+   HashQueue *hashQueue;        /* offloads the two full length md5sums */
+   HashStream *md5Stream;       /* feeds md5ctxt */
+   HashStream *dataStream;      /* feeds dataCtxt */
 } RS02CksumClosure;
 
 /* 
@@ -337,6 +337,16 @@ void CreateRS02VerifyWindow(Method *self, GtkWidget *parent)
  * housekeeping
  */
 
+#define VERIFY_BUFFERS 4             /* image buffers shared with the reader */
+#define VERIFY_CHUNK_SECTORS 1024    /* 2MB per buffer */
+
+enum { BUF_EMPTY, BUF_FULL, BUF_EOF };
+
+/* Threads working on a filled buffer */
+
+#define SCANNER 1
+#define HASHER  2
+
 typedef struct
 {  Image *image;
    EccHeader *eh;
@@ -346,21 +356,47 @@ typedef struct
    guint32 *crcBuf;
    gint8   *crcValid;
    unsigned char crcSum[16];
+
+   /* Image scan; see reader_thread() below */
+
+   gint64 expectedSectors;
+   GThread *reader;         /* fills the image buffers */
+   GThread *hasher;         /* md5sum of the data portion */
+   GMutex *ioLock;
+   GCond *ioCond;
+   unsigned char *ioBuf[VERIFY_BUFFERS];
+   gint64 ioSector[VERIFY_BUFFERS];    /* first sector in buffer */
+   int ioSectors[VERIFY_BUFFERS];      /* number of sectors in buffer */
+   int ioState[VERIFY_BUFFERS];
+   int ioPending[VERIFY_BUFFERS];      /* SCANNER/HASHER not yet done with it */
+   int stopIO;
+   char *ioError;
+   struct MD5Context dataMD5;
 } verify_closure;
 
+static void join_io(verify_closure*, int);
+
 static void cleanup(gpointer data)
 {  verify_closure *cc = (verify_closure*)data;
+   int i;
 
    Closure->cleanupProc = NULL;
 
    if(Closure->guiMode)
       AllowActions(TRUE);
 
+   join_io(cc, TRUE);
+
    if(cc->image) CloseImage(cc->image);
    if(cc->lay) g_free(cc->lay);
    if(cc->map) FreeBitmap(cc->map);
    if(cc->crcBuf) g_free(cc->crcBuf);
    if(cc->crcValid) g_free(cc->crcValid);
+   if(cc->ioLock) g_mutex_free(cc->ioLock);
+   if(cc->ioCond) g_cond_free(cc->ioCond);
+   if(cc->ioError) g_free(cc->ioError);
+   for(i=0; i<VERIFY_BUFFERS; i++)
+      if(cc->ioBuf[i]) g_free(cc->ioBuf[i]);
    
    g_free(cc);
 
@@ -368,6 +404,175 @@ static void cleanup(gpointer data)
      g_thread_exit(0);
 }
 
+/***
+ *** Read the image in large chunks.
+ ***
+ * The reader thread fills the image buffers in sequence.
+ * Each filled buffer is processed by the main thread (dead sector
+ * markers, CRC and ecc checksums) and in parallel by the hasher thread
+ * which computes the md5sum of the data portion.
+ * A buffer becomes available for reading again after both released it.
+ * The final buffer is marked BUF_EOF and carries no sectors.
+ */
+
+static gpointer reader_thread(gpointer data)
+{  verify_closure *cc = (verify_closure*)data;
+   EccHeader *eh = cc->eh;
+   gint64 s = 0;
+   int idx = 0;
+
+   for(;;)
+   {  unsigned char *buf = cc->ioBuf[idx];
+      int n = MIN(VERIFY_CHUNK_SECTORS, cc->expectedSectors - s);
+      int state = n > 0 ? BUF_FULL : BUF_EOF;
+      int i,stop;
+
+      g_mutex_lock(cc->ioLock);
+      while(cc->ioState[idx] != BUF_EMPTY && !cc->stopIO)
+	 g_cond_wait(cc->ioCond, cc->ioLock);
+      stop = cc->stopIO;
+      g_mutex_unlock(cc->ioLock);
+
+      if(stop)
+	 return NULL;
+
+      /* Image may be truncated */
+
+      i = 0;
+      if(state == BUF_FULL && s < cc->image->sectorSize)
+      {  int present = MIN(n, cc->image->sectorSize - s);
+	 int expected = 2048*present;
+	 gint64 stats_start = StatsTimestamp();
+	 int got = LargeRead(cc->image->file, buf, expected);
+
+	 StatsTime(STAT_IO_WAIT, stats_start);
+	 StatsCount(STAT_BYTES_READ, got > 0 ? got : 0);
+
+	 if(got != expected)
+	 {  cc->ioError = g_strdup_printf(_("premature end in image (only %d of %d bytes): %s\n"),
+					  got < 0 ? 0 : got, expected, strerror(errno));
+	    state = BUF_EOF;
+	    n = 0;
+	 }
+	 else i = present;
+      }
+
+      if(state == BUF_FULL)
+	 for(; i<n; i++)
+	    CreateMissingSector(buf+2048*i, s+i, eh->mediumFP, eh->fpSector, "padding beyond the image");
+
+      g_mutex_lock(cc->ioLock);
+      cc->ioSector[idx]  = s;
+      cc->ioSectors[idx] = n;
+      cc->ioState[idx]   = state;
+      cc->ioPending[idx] = SCANNER | HASHER;
+      g_cond_broadcast(cc->ioCond);
+      g_mutex_unlock(cc->ioLock);
+
+      if(state == BUF_EOF)
+	 return NULL;
+
+      s += n;
+      idx = (idx+1) % VERIFY_BUFFERS;
+   }
+}
+
+/*
+ * Wait until the buffer has been filled for the given thread. 
+ * Returns its state.
+ */
+
+static int wait_for_buffer(verify_closure *cc, int idx, int who)
+{  int state;
+
+   g_mutex_lock(cc->ioLock);
+   while(!(cc->ioPending[idx] & who) && !cc->stopIO)
+      g_cond_wait(cc->ioCond, cc->ioLock);
+   state = cc->stopIO ? BUF_EOF : cc->ioState[idx];
+   g_mutex_unlock(cc->ioLock);
+
+   return state;
+}
+
+static void release_buffer(verify_closure *cc, int idx, int who)
+{
+   g_mutex_lock(cc->ioLock);
+   cc->ioPending[idx] &= ~who;
+   if(!cc->ioPending[idx])
+   {  cc->ioState[idx] = BUF_EMPTY;
+      g_cond_broadcast(cc->ioCond);
+   }
+   g_mutex_unlock(cc->ioLock);
+}
+
+static gpointer hasher_thread(gpointer data)
+{  verify_closure *cc = (verify_closure*)data;
+   gint64 data_sectors = cc->lay->dataSectors;
+   int idx = 0;
+
+   while(wait_for_buffer(cc, idx, HASHER) == BUF_FULL)
+   {  unsigned char *buf = cc->ioBuf[idx];
+      gint64 s = cc->ioSector[idx];
+
+      if(s < data_sectors)
+      {  int n = MIN(cc->ioSectors[idx], data_sectors - s);
+	 gint64 stats_start = StatsTimestamp();
+
+	 if(s+n < data_sectors)
+	    MD5Update(&cc->dataMD5, buf, 2048*n);
+	 else
+	 {  MD5Update(&cc->dataMD5, buf, 2048*(n-1));
+	    MD5Update(&cc->dataMD5, buf+2048*(n-1), cc->eh->inLast);
+	 }
+	 StatsTime(STAT_MD5, stats_start);
+      }
+
+      release_buffer(cc, idx, HASHER);
+      idx = (idx+1) % VERIFY_BUFFERS;
+   }
+
+   return NULL;
+}
+
+static void start_io(verify_closure *cc)
+{  GError *err = NULL;
+   int i;
+
+   cc->ioLock = g_mutex_new();
+   cc->ioCond = g_cond_new();
+   for(i=0; i<VERIFY_BUFFERS; i++)
+      cc->ioBuf[i] = g_malloc(2048*VERIFY_CHUNK_SECTORS);
+
+   MD5Init(&cc->dataMD5);
+
+   cc->reader = g_thread_create(reader_thread, (gpointer)cc, TRUE, &err);
+   if(!cc->reader)
+      Stop("Could not create image reader thread: %s", err->message);
+
+   cc->hasher = g_thread_create(hasher_thread, (gpointer)cc, TRUE, &err);
+   if(!cc->hasher)
+      Stop("Could not create md5 thread: %s", err->message);
+}
+
+/*
+ * Wait for the threads to finish. 
+ * Unless abort is set, the reader and hasher complete the image first.
+ */
+
+static void join_io(verify_closure *cc, int abort)
+{
+   if(abort && cc->ioLock)
+   {  g_mutex_lock(cc->ioLock);
+      cc->stopIO = TRUE;
+      g_cond_broadcast(cc->ioCond);
+      g_mutex_unlock(cc->ioLock);
+   }
+
+   if(cc->reader) g_thread_join(cc->reader);
+   if(cc->hasher) g_thread_join(cc->hasher);
+   cc->reader = cc->hasher = NULL;
+}
+
 /***
  *** Read the crc portion and descramble it from ecc block order
  *** into ascending sector order. 
@@ -540,7 +745,6 @@ void RS02Verify(Image *image)
    RS02Widgets *wl = self->widgetList;
    EccHeader *eh;
    RS02Layout *lay;
-   struct MD5Context image_md5;
    struct MD5Context ecc_md5;
    struct MD5Context meta_md5;
    unsigned char ecc_sum[16];
@@ -548,7 +752,7 @@ void RS02Verify(Image *image)
    char data_digest[33], hdr_digest[33], digest[33];
    gint64 s, crc_idx;
    int last_percent = 0;
-   unsigned char buf[2048];
+   int idx;
    gint64 first_missing, last_missing;
    gint64 total_missing = 0;
    gint64 data_missing = 0;
@@ -690,7 +894,6 @@ void RS02Verify(Image *image)
    if(!LargeSeek(image->file, 0))
      Stop(_("Failed seeking to start of image: %s\n"), strerror(errno));
 
-   MD5Init(&image_md5);
    MD5Init(&ecc_md5);
    MD5Init(&meta_md5);
 
@@ -700,9 +903,17 @@ void RS02Verify(Image *image)
    ecc_sector = 0;
    ecc_slice  = 0;
 
-   for(s=0; s<expected_sectors; s++)
-   {  int percent,current_missing;
-      int defective = 0;
+   /* Sectors are read by the reader thread in large chunks,
+      and the data md5sum is calculated by the hasher thread */
+
+   cc->expectedSectors = expected_sectors;
+   start_io(cc);
+
+   for(s=0, idx=0; s<expected_sectors; idx=(idx+1)%VERIFY_BUFFERS)
+   {  unsigned char *chunk;
+      guint64 first_marker;
+      gint64 crc_usecs = 0;
+      int i,n;
 
       /* Check for user interruption */
 
@@ -713,108 +924,125 @@ void RS02Verify(Image *image)
          goto terminate;
       }
 
-      /* Read the next sector */
+      /* Get the next chunk of sectors */
 
-      if(s < image->sectorSize)  /* image may be truncated */
-      {  int n = LargeRead(image->file, buf, 2048);
-         if(n != 2048)
-	    Stop(_("premature end in image (only %d bytes): %s\n"),n,strerror(errno));
-      }
-      else CreateMissingSector(buf, s, eh->mediumFP, eh->fpSector, "padding beyond the image");
+      if(wait_for_buffer(cc, idx, SCANNER) != BUF_FULL)
+	 Stop("%s", cc->ioError ? cc->ioError : "image reader terminated\n");
 
-      if(s < lay->dataSectors)
-      {  if(s < lay->dataSectors - 1)
-	      MD5Update(&image_md5, buf, 2048);
-	 else MD5Update(&image_md5, buf, eh->inLast);
-      }
+      chunk = cc->ioBuf[idx];
+      n = cc->ioSectors[idx];
 
-      /* Look for the dead sector marker */
-
-      current_missing = CheckForMissingSector(buf, s, eh->mediumFP, eh->fpSector);
-      if(current_missing != SECTOR_PRESENT)
-	 ExplainMissingSector(buf, s, current_missing, TRUE);
-
-      if(current_missing)
-      {  if(first_missing < 0) first_missing = s;
-         last_missing = s;
-	 total_missing++;
-	 new_missing++;
-	 if(s < lay->dataSectors) data_missing++;
-	 else if(s >= lay->dataSectors + 2 && s < lay->protectedSectors) crc_missing++;
-	 else ecc_missing++;
-	 defective = TRUE;
-      }
+      /* Only sectors from the first dead sector marker on
+	 need to be looked at one by one */
 
-      /* Report dead sectors. Combine subsequent missing sectors into one report. */
+      if(CheckForMissingSectors(chunk, s, eh->mediumFP, eh->fpSector, n, &first_marker) == SECTOR_PRESENT)
+	 first_marker = s+n;
 
-      if(!current_missing || s==expected_sectors-1)
-      {  if(first_missing>=0)
-	 {   if(first_missing == last_missing)
-	           PrintCLI(_("* missing sector   : %lld\n"), first_missing);
-	     else PrintCLI(_("* missing sectors  : %lld - %lld\n"), first_missing, last_missing);
-	     first_missing = -1;
-	 }
-      }
+      for(i=0; i<n; i++, s++)
+      {  unsigned char *buf = chunk + 2048*i;
+	 int percent,current_missing;
+	 int defective = 0;
 
-      /* If the image sector is from the data portion and it was readable, 
-	 test its CRC sum */
+	 /* Look for the dead sector marker */
 
-      if(s < lay->dataSectors && !current_missing)
-      {  guint32 crc = Crc32(buf, 2048);
+	 if(s < first_marker)
+	      current_missing = SECTOR_PRESENT;
+	 else current_missing = CheckForMissingSector(buf, s, eh->mediumFP, eh->fpSector);
+	 if(current_missing != SECTOR_PRESENT)
+	    ExplainMissingSector(buf, s, current_missing, TRUE);
 
-	 if(cc->crcValid[crc_idx] && crc != cc->crcBuf[crc_idx])
-	 {  PrintCLI(_("* CRC error, sector: %lld\n"), s);
-	    data_crc_errors++;
-	    new_crc_errors++;
+	 if(current_missing)
+	 {  if(first_missing < 0) first_missing = s;
+	    last_missing = s;
+	    total_missing++;
+	    new_missing++;
+	    if(s < lay->dataSectors) data_missing++;
+	    else if(s >= lay->dataSectors + 2 && s < lay->protectedSectors) crc_missing++;
+	    else ecc_missing++;
 	    defective = TRUE;
 	 }
-      }
-      crc_idx++;
 
-      if(!defective)
-	SetBit(cc->map, s);
+	 /* Report dead sectors. Combine subsequent missing sectors into one report. */
+
+	 if(!current_missing || s==expected_sectors-1)
+	 {  if(first_missing>=0)
+	    {   if(first_missing == last_missing)
+		      PrintCLI(_("* missing sector   : %lld\n"), first_missing);
+		else PrintCLI(_("* missing sectors  : %lld - %lld\n"), first_missing, last_missing);
+		first_missing = -1;
+	    }
+	 }
+
+	 /* If the image sector is from the data portion and it was readable, 
+	    test its CRC sum */
 
-      /* Calculate the ecc checksum */
+	 if(s < lay->dataSectors && !current_missing)
+	 {  gint64 stats_start = StatsTimestamp();
+	    guint32 crc = Crc32(buf, 2048);
 
-      if(s == RS02EccSectorIndex(lay, ecc_slice, ecc_sector))
-      {  MD5Update(&ecc_md5, buf, 2048);
-	 ecc_sector++;
-	 if(ecc_sector >= lay->sectorsPerLayer)
-	 {  MD5Final(ecc_sum, &ecc_md5); 
-	    MD5Init(&ecc_md5);
-	    MD5Update(&meta_md5, ecc_sum, 16);
+	    crc_usecs += StatsTimestamp() - stats_start;
 
-	    ecc_sector = 0;
-	    ecc_slice++;
+	    if(cc->crcValid[crc_idx] && crc != cc->crcBuf[crc_idx])
+	    {  PrintCLI(_("* CRC error, sector: %lld\n"), s);
+	       data_crc_errors++;
+	       new_crc_errors++;
+	       defective = TRUE;
+	    }
 	 }
-      }
+	 crc_idx++;
 
-      if(Closure->guiMode) 
-	    percent = (VERIFY_IMAGE_SEGMENTS*(s+1))/expected_sectors;
-      else  percent = (100*(s+1))/expected_sectors;
-
-      if(last_percent != percent) 
-      {  PrintProgress(_("- testing sectors  : %3d%%") ,percent);
-	 if(Closure->guiMode)
-	 {  add_verify_values(self, percent, new_missing, new_crc_errors); 
-	    if(data_missing || data_crc_errors)
-	      SetLabelText(GTK_LABEL(wl->cmpDataSection), 
-			   _("<span %s>%lld sectors missing; %lld CRC errors</span>"),
-			   Closure->redMarkup, data_missing, data_crc_errors);
-	    if(crc_missing)
-	      SetLabelText(GTK_LABEL(wl->cmpCrcSection), 
-			   _("<span %s>%lld sectors missing</span>"),
-			   Closure->redMarkup, crc_missing);
-	    if(ecc_missing)
-	      SetLabelText(GTK_LABEL(wl->cmpEccSection), 
-			   _("<span %s>%lld sectors missing</span>"),
-			   Closure->redMarkup, ecc_missing);
+	 if(!defective)
+	   SetBit(cc->map, s);
+
+	 /* Calculate the ecc checksum */
+
+	 if(s == RS02EccSectorIndex(lay, ecc_slice, ecc_sector))
+	 {  MD5Update(&ecc_md5, buf, 2048);
+	    ecc_sector++;
+	    if(ecc_sector >= lay->sectorsPerLayer)
+	    {  MD5Final(ecc_sum, &ecc_md5); 
+	       MD5Init(&ecc_md5);
+	       MD5Update(&meta_md5, ecc_sum, 16);
+
+	       ecc_sector = 0;
+	       ecc_slice++;
+	    }
+	 }
+
+	 if(Closure->guiMode) 
+	       percent = (VERIFY_IMAGE_SEGMENTS*(s+1))/expected_sectors;
+	 else  percent = (100*(s+1))/expected_sectors;
+
+	 if(last_percent != percent) 
+	 {  PrintProgress(_("- testing sectors  : %3d%%") ,percent);
+	    if(Closure->guiMode)
+	    {  add_verify_values(self, percent, new_missing, new_crc_errors); 
+	       if(data_missing || data_crc_errors)
+		 SetLabelText(GTK_LABEL(wl->cmpDataSection), 
+			      _("<span %s>%lld sectors missing; %lld CRC errors</span>"),
+			      Closure->redMarkup, data_missing, data_crc_errors);
+	       if(crc_missing)
+		 SetLabelText(GTK_LABEL(wl->cmpCrcSection), 
+			      _("<span %s>%lld sectors missing</span>"),
+			      Closure->redMarkup, crc_missing);
+	       if(ecc_missing)
+		 SetLabelText(GTK_LABEL(wl->cmpEccSection), 
+			      _("<span %s>%lld sectors missing</span>"),
+			      Closure->redMarkup, ecc_missing);
+	    }
+	    last_percent = percent;
+	    new_missing = new_crc_errors = 0;
 	 }
-	 last_percent = percent;
-	 new_missing = new_crc_errors = 0;
       }
+
+      StatsCount(STAT_CRC, crc_usecs);
+      release_buffer(cc, idx, SCANNER);
    }
 
+   /* Let the reader and hasher finish */
+
+   join_io(cc, FALSE);
+
    /* Complete damage summary */
 
    if(Closure->guiMode)
@@ -834,7 +1062,7 @@ void RS02Verify(Image *image)
 
    /* The image md5sum is only useful if all blocks have been successfully read. */
 
-   MD5Final(medium_sum, &image_md5);
+   MD5Final(medium_sum, &cc->dataMD5);
    AsciiDigest(data_digest, medium_sum);
 
    MD5Final(ecc_sum, &meta_md5); 
@@ -498,6 +498,8 @@ static void flip_buffers(ecc_closure *ec)
 
 static void read_next_chunk(ecc_closure *ec, guint64 chunk)
 {  RS03Layout *lay = ec->lay;
+   gint64 stats_start = StatsTimestamp();
+   gint64 trace_start = TraceBegin();
    int layer;
 
    /* The last chunk may contain fewer sectors. */
@@ -625,10 +627,16 @@ static void read_next_chunk(ecc_closure *ec, guint64 chunk)
       }
 #endif /* Don't HAVE_MMAP */
    } /* all layers from chunk finished */
+
+   StatsTime(STAT_IO_WAIT, stats_start);
+   StatsCount(STAT_BYTES_READ, 2048*(gint64)ec->ioLayerSectors*(lay->ndata-1));
+   TraceEnd(TRACE_READ_CHUNK, trace_start);
 }
 
 static void flush_crc(ecc_closure *ec, LargeFile *file_out)
 {  RS03Layout *lay = ec->lay;
+   gint64 stats_start = StatsTimestamp();
+   gint64 trace_start = TraceBegin();
    gint64 crc_sect;
    gint64 i;
 
@@ -646,10 +654,16 @@ static void flush_crc(ecc_closure *ec, LargeFile *file_out)
       {  ec->abortImmediately = TRUE;
 	 Stop(_("Failed writing to sector %lld in image: %s"), crc_sect, strerror(errno));
       }
+
+   StatsTime(STAT_FLUSH, stats_start);
+   StatsCount(STAT_BYTES_WRITTEN, 2048*ec->encoderLayerSectors);
+   TraceEnd(TRACE_FLUSH_CRC, trace_start);
 }
 
 static void flush_parity(ecc_closure *ec, LargeFile *file_out)
 {  RS03Layout *lay = ec->lay;
+   gint64 stats_start = StatsTimestamp();
+   gint64 trace_start = TraceBegin();
    gint64 i;
    int k;
 
@@ -673,6 +687,10 @@ static void flush_parity(ecc_closure *ec, LargeFile *file_out)
       }
    }
    verbose("IO: parity written.\n");
+
+   StatsTime(STAT_FLUSH, stats_start);
+   StatsCount(STAT_BYTES_WRITTEN, 2048*(gint64)ec->flushLayerSectors*lay->nroots);
+   TraceEnd(TRACE_FLUSH_PARITY, trace_start);
 }
 
 static gpointer io_thread(ecc_closure *ec)
@@ -688,6 +706,7 @@ static gpointer io_thread(ecc_closure *ec)
    int i;
 
    verbose("Reader thread initializing\n");
+   TraceThreadName("io");
 
    /*** Allocate local parity buffer aligned at 128bit boundary */
 
@@ -743,6 +762,7 @@ static gpointer io_thread(ecc_closure *ec)
 
    for(chunk=0; chunk<lay->sectorsPerLayer; chunk+=ec->chunkSize) 
    {  int cpu_bound = 0;
+      gint64 stats_start,trace_start;
 
       verbose("Starting IO processing for chunk %d\n", chunk);
 
@@ -796,6 +816,8 @@ static gpointer io_thread(ecc_closure *ec)
 
       /* Wait until the encoders have finished */
 
+      stats_start = StatsTimestamp();
+      trace_start = TraceBegin();
       g_mutex_lock(ec->lock);
       cpu_bound = ec->buffersToEncode;
       while(ec->buffersToEncode)
@@ -803,6 +825,9 @@ static gpointer io_thread(ecc_closure *ec)
 	 g_cond_wait(ec->ioCond, ec->lock);
       }
       g_mutex_unlock(ec->lock);
+      StatsTime(STAT_ENCODE_WAIT, stats_start);
+      StatsCount(cpu_bound ? STAT_CPU_BOUND : STAT_IO_BOUND, 1);
+      TraceEnd(TRACE_ENCODER_WAIT, trace_start);
 
       /* Report progress */
 
@@ -898,12 +923,15 @@ static gpointer encoder_thread(ecc_closure *ec)
      shift[i] = (shift[0] + i) % nroots;
 
    verbose("ENC: Encoder thread %d initialized.\n", my_number);
+   TraceThreadName("encoder %d", my_number);
 
    for(;;)
    {  int layer;
       int layer_offset;
       int layer_index;
+      gint64 stats_start,trace_start;
 
+      trace_start = TraceBegin();
       g_mutex_lock(ec->lock);
       while(   ec->sectorsToEncode 
 	    && !ec->abortImmediately
@@ -926,8 +954,13 @@ static gpointer encoder_thread(ecc_closure *ec)
       }
       ec->nextBufferIndex +=enc_size;
       g_mutex_unlock(ec->lock);
+      TraceEnd(TRACE_DATA_WAIT, trace_start);
 
-      /* Now process the data bytes of the given layer section. */
+      /* Now process the data bytes of the given layer section.
+	 The CRC sums are interleaved with encoding and timed with it. */
+
+      stats_start = StatsTimestamp();
+      trace_start = TraceBegin();
 
       for(layer=0; layer<ndata; layer++)
       {  unsigned char *data   = ec->encoderData[layer] + 2048*layer_offset;
@@ -964,16 +997,22 @@ static gpointer encoder_thread(ecc_closure *ec)
 	 EncodeNextLayer(ec->rt, data, parity, 2048*enc_size, shift[layer]);
       }
 
+      StatsTime(STAT_ENCODE, stats_start);
+      StatsCount(STAT_ECC_BLOCKS, 2048*enc_size);
+      TraceEnd(TRACE_ENCODE, trace_start);
+
       /* After processing the last data layer the parity bytes have been
 	 prepared as sequences of nroots bytes for this ecc block. 
 	 Now we split them up into nroots slices and cache them in the output
 	 buffer. */
 
+      trace_start = TraceBegin();
       g_mutex_lock(ec->lock);
       while(!ec->slicesFree && !ec->abortImmediately)
       {  g_cond_wait(ec->ioCond, ec->lock);
       }
       g_mutex_unlock(ec->lock);
+      TraceEnd(TRACE_SLICE_WAIT, trace_start);
 
       if(ec->abortImmediately)
 	 return NULL;
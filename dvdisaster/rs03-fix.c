@@ -134,8 +134,8 @@ void RS03Fix(Image *image)
 #ifdef HAVE_BIG_ENDIAN
    EccHeader *eh_swapped;
 #endif
-   gint32 *gf_index_of;
-   gint32 *gf_alpha_to;
+   guint8 *gf_index_of;
+   guint8 *gf_alpha_to;
    gint64 block_idx[255];
    gint64 s;
    guint32 *crc_buf, last_crc_sector1[512], last_crc_sector2[512];
@@ -160,6 +160,9 @@ void RS03Fix(Image *image)
    gint64 damaged_eccblocks=0;
    gint64 damaged_eccsecs=0;
    gint64 expected_sectors;
+   gint64 stats_start, dec_start = 0;
+   gint64 syn_usecs = 0, write_usecs = 0;
+   gint64 trace_start, trace_decode = 0;
    char *t=NULL,*msg;
 
    /*** Register the cleanup procedure for GUI mode */
@@ -355,6 +358,8 @@ void RS03Fix(Image *image)
 
      if(cache_sector >= cache_size)
      {  
+        stats_start = StatsTimestamp();
+        trace_start = TraceBegin();
         if(lay->sectorsPerLayer-s < cache_size)
            cache_size = lay->sectorsPerLayer-s;
 
@@ -389,6 +394,9 @@ void RS03Fix(Image *image)
 	}
 
         cache_sector = cache_offset = 0;
+        StatsTime(STAT_IO_WAIT, stats_start);
+        StatsCount(STAT_BYTES_READ, 2048*(gint64)GF_FIELDMAX*cache_size);
+        TraceEnd(TRACE_FIX_CACHE, trace_start);
      }
 
      /* Set crc ptr to beginning of CRC sector. The first ECC block has no
@@ -418,6 +426,7 @@ void RS03Fix(Image *image)
      /*** Look for erasures based on the "dead sector" marker and CRC sums */
 
      erasure_count = error_count = 0;
+     stats_start = StatsTimestamp();
 
      /* Check the data sectors */
 
@@ -470,6 +479,10 @@ void RS03Fix(Image *image)
 	ecc_count++;
      }
 
+     StatsTime(STAT_CRC, stats_start);
+     StatsCount(STAT_ECC_BLOCKS, 2048);
+     StatsCount(STAT_ERASURES, erasure_count);
+
      /* Trivially reject uncorrectable ecc block */
 
      if(erasure_count>lay->nroots)   /* uncorrectable */
@@ -485,10 +498,16 @@ void RS03Fix(Image *image)
 	}
 
 	uncorrected += erasure_count;
+	StatsCount(STAT_UNCORRECTABLE, erasure_count);
 	goto skip;
      }
 
-     /* Build ecc block and attempt to correct it */
+     /* Build ecc block and attempt to correct it.
+        Everything but forming the syndromes is accounted as decoding. */
+
+     syn_usecs = write_usecs = 0;
+     dec_start = StatsTimestamp();
+     trace_decode = TraceBegin();
 
      for(bi=0; bi<2048; bi++)  /* Run through each ecc block byte */
      {  int offset = cache_offset+bi;
@@ -502,6 +521,8 @@ void RS03Fix(Image *image)
 
 	/* Form the syndromes; i.e., evaluate data(x) at roots of g(x) */
 
+	stats_start = StatsTimestamp();
+
 	for(i=0; i<nroots; i++)
 	  syn[i] = fc->imgBlock[0][offset];
 
@@ -521,6 +542,7 @@ void RS03Fix(Image *image)
 	{  syn_error |= syn[i];
 	   syn[i] = gf_index_of[syn[i]];
 	}
+	syn_usecs += StatsTimestamp() - stats_start;
 
 	/* If it is already correct by coincidence, we have nothing to do any further */
 
@@ -640,6 +662,7 @@ void RS03Fix(Image *image)
 	   }
 	   PrintLog("\n");
 	   uncorrected += erasure_count;
+	   StatsCount(STAT_UNCORRECTABLE, erasure_count);
 	   goto skip;
 	}
 
@@ -718,6 +741,9 @@ void RS03Fix(Image *image)
 	}
      }
 
+     TraceEnd(TRACE_FIX_DECODE, trace_decode);
+     trace_decode = 0;
+
      /* Write corrected sectors back to disc
         and report them */
 
@@ -725,6 +751,7 @@ void RS03Fix(Image *image)
 
      if(erasure_count)
      {  PrintCLI(_("  %3d repaired sectors: "), erasure_count);
+        stats_start = StatsTimestamp();
 
         for(i=0; i<255; i++)
         {  gint64 sec;
@@ -796,9 +823,23 @@ void RS03Fix(Image *image)
 	   }
 	}
 	PrintCLI("\n");
+	write_usecs = StatsTimestamp() - stats_start;
+	StatsCount(STAT_FLUSH, write_usecs);
+	StatsCount(STAT_CORRECTED, erasure_count);
+	StatsCount(STAT_BYTES_WRITTEN, 2048*erasure_count);
      }
 
 skip:
+     if(dec_start)
+     {  StatsCount(STAT_SYNDROME, syn_usecs);
+        StatsCount(STAT_DECODE, StatsTimestamp() - dec_start - syn_usecs - write_usecs);
+	dec_start = 0;
+     }
+     if(trace_decode)   /* ecc block given up during decoding */
+     {  TraceEnd(TRACE_FIX_DECODE, trace_decode);
+        trace_decode = 0;
+     }
+
      /* Collect some damage statistics */
      
      if(erasure_count)
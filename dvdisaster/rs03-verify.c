@@ -484,6 +484,7 @@ static int check_syndromes(verify_closure *vc)
    int percent,last_percent = -1;
    int bad_counted;
    int layer,i,j;
+   gint64 stats_start;
 
    if(Closure->guiMode)
      SetLabelText(GTK_LABEL(vc->wl->cmpHeadline), "<big>%s</big>\n<i>%s</i>",
@@ -536,6 +537,7 @@ static int check_syndromes(verify_closure *vc)
       
       if(cache_idx == Closure->prefetchSectors)
       {  
+	 stats_start = StatsTimestamp();
 	 cache_idx = 0;
 	 num_sectors = Closure->prefetchSectors;
 	 if(ecc_block+num_sectors >= lay->sectorsPerLayer)
@@ -548,6 +550,8 @@ static int check_syndromes(verify_closure *vc)
 	   else
 	     RS03ReadSectors(image, vc->lay, vc->eccBlock[layer], 
 			    layer, ecc_block, num_sectors, RS03_READ_CRC | RS03_READ_ECC);
+	 StatsTime(STAT_IO_WAIT, stats_start);
+	 StatsCount(STAT_BYTES_READ, 2048*GF_FIELDMAX*num_sectors);
       }
 
       /* Calculate the error syndromes.
@@ -555,6 +559,7 @@ static int check_syndromes(verify_closure *vc)
 	 dead sector markers; therefore we can skip this test. */
 
       bad_counted = FALSE;
+      stats_start = StatsTimestamp();
 
       for(i=0; i<2048; i++) 
       {  int result;
@@ -573,6 +578,8 @@ static int check_syndromes(verify_closure *vc)
 	 }
       }
       cache_idx++;
+      StatsTime(STAT_SYNDROME, stats_start);
+      StatsCount(STAT_ECC_BLOCKS, 2048);
 
       if(!bad_counted) ecc_good++;
 
@@ -656,6 +663,8 @@ void RS03Verify(Image *image)
    int try_it;
    int missing_sector_explained = 0;
    int matching_byte_size = TRUE;
+   gint64 io_usecs = 0, md5_usecs = 0, crc_usecs = 0;
+   gint64 stats_start;
 
    /*** Prepare for early termination */
 
@@ -980,6 +989,7 @@ void RS03Verify(Image *image)
 
       /* Read the next sector */
 
+      stats_start = StatsTimestamp();
       if(lay->target == ECC_IMAGE || s<lay->dataSectors)
       {  /* Read from image file */
 	 if(s < image->sectorSize)  /* image may be truncated */
@@ -1052,11 +1062,14 @@ void RS03Verify(Image *image)
 	 {  CreateMissingSector(buf, s, eh->mediumFP, eh->fpSector, "padding beyond the image");
 	 }
       }
+      io_usecs += StatsTimestamp() - stats_start;
 
       if(s < lay->dataSectors)
-      {  if(s < lay->dataSectors - 1)
+      {  stats_start = StatsTimestamp();
+	 if(s < lay->dataSectors - 1)
 	      MD5Update(&image_md5, buf, 2048);
 	 else MD5Update(&image_md5, buf, eh->inLast);
+	 md5_usecs += StatsTimestamp() - stats_start;
       }
 
       /* Look for the dead sector marker */
@@ -1120,7 +1133,11 @@ void RS03Verify(Image *image)
       if(   !current_missing
 	 && (   (lay->target == ECC_IMAGE && s < lay->firstCrcPos)
 	     || (lay->target == ECC_FILE && s < lay->dataSectors)))
-      {  guint32 crc = Crc32(buf, 2048);
+      {  guint32 crc;
+
+	 stats_start = StatsTimestamp();
+	 crc = Crc32(buf, 2048);
+	 crc_usecs += StatsTimestamp() - stats_start;
 
 	 if(GetBit(vc->crcBuf->valid,crc_idx)
 	    && crc != vc->crcBuf->crcbuf[crc_idx])
@@ -1178,6 +1195,11 @@ void RS03Verify(Image *image)
 	 }
 	 last_percent = percent;
 	 new_missing = new_crc_errors = 0;
+
+	 StatsCount(STAT_IO_WAIT, io_usecs);
+	 StatsCount(STAT_MD5, md5_usecs);
+	 StatsCount(STAT_CRC, crc_usecs);
+	 io_usecs = md5_usecs = crc_usecs = 0;
       }
       
       /* If we have processed the image and are about to switch over
@@ -1199,6 +1221,11 @@ void RS03Verify(Image *image)
       }
    }
 
+   StatsCount(STAT_IO_WAIT, io_usecs);
+   StatsCount(STAT_MD5, md5_usecs);
+   StatsCount(STAT_CRC, crc_usecs);
+   StatsCount(STAT_BYTES_READ, 2048*virtual_expected);
+
    /* Complete damage summary */
 
    if(Closure->guiMode)
@@ -2215,11 +2215,8 @@ int TestUnitReady(DeviceHandle *dh)
  * Sector reading using the packet interface.
  */
 
-static int read_dvd_sector(DeviceHandle *dh, unsigned char *buf, int lba, int nsectors)
-{  Sense *sense = &dh->sense;
-   unsigned char cmd[MAX_CDB_SIZE];
-   int ret;
-
+static int build_read10_cdb(DeviceHandle *dh, unsigned char *cmd, int lba, int nsectors)
+{
    memset(cmd, 0, MAX_CDB_SIZE);
    cmd[0] = 0x28;  /* READ(10) */
    cmd[1] = 0;  /* no special flags */
@@ -2231,18 +2228,11 @@ static int read_dvd_sector(DeviceHandle *dh, unsigned char *buf, int lba, int ns
    cmd[7] = 0;         /* number of sectors */
    cmd[8] = nsectors;  /* read 1 sector */
 
-   ret = SendPacket(dh, cmd, 10, buf, 2048*nsectors, sense, DATA_READ);
-
-   if(ret<0) RememberSense(sense->sense_key, sense->asc, sense->ascq);
-
-   return ret;
+   return 10;
 }
 
-static int read_cd_sector(DeviceHandle *dh, unsigned char *buf, int lba, int nsectors)
-{  Sense *sense = &dh->sense;
-   unsigned char cmd[MAX_CDB_SIZE];
-   int ret;
-
+static int build_read_cd_cdb(DeviceHandle *dh, unsigned char *cmd, int lba, int nsectors)
+{
    memset(cmd, 0, MAX_CDB_SIZE);
    cmd[0]  = 0xbe;         /* READ CD */
    switch(dh->subType)
@@ -2261,7 +2251,29 @@ static int read_cd_sector(DeviceHandle *dh, unsigned char *buf, int lba, int nse
    cmd[10] = 0;    /* reserved stuff */
    cmd[11] = 0;    /* no special wishes for the control byte */
 
-   ret = SendPacket(dh, cmd, 12, buf, 2048*nsectors, sense, DATA_READ);
+   return 12;
+}
+
+static int read_dvd_sector(DeviceHandle *dh, unsigned char *buf, int lba, int nsectors)
+{  Sense *sense = &dh->sense;
+   unsigned char cmd[MAX_CDB_SIZE];
+   int cdb_size,ret;
+
+   cdb_size = build_read10_cdb(dh, cmd, lba, nsectors);
+   ret = SendPacket(dh, cmd, cdb_size, buf, 2048*nsectors, sense, DATA_READ);
+
+   if(ret<0) RememberSense(sense->sense_key, sense->asc, sense->ascq);
+
+   return ret;
+}
+
+static int read_cd_sector(DeviceHandle *dh, unsigned char *buf, int lba, int nsectors)
+{  Sense *sense = &dh->sense;
+   unsigned char cmd[MAX_CDB_SIZE];
+   int cdb_size,ret;
+
+   cdb_size = build_read_cd_cdb(dh, cmd, lba, nsectors);
+   ret = SendPacket(dh, cmd, cdb_size, buf, 2048*nsectors, sense, DATA_READ);
 
 #if 0
 #define BORK 34999
@@ -2408,22 +2420,216 @@ static int read_raw_cd_sector(DeviceHandle *dh, unsigned char *outbuf, int lba,
    return ret;
 }
 
+/***
+ *** Read ahead through queued commands
+ ***
+ * During sequential reading the drive idles between two commands
+ * while we process the data and build the next command.
+ * With read ahead enabled, commands for the following sectors are
+ * kept in flight so that the drive always finds one waiting.
+ * Commands are only queued up to the last sector the reader is going
+ * to request. Requests which do not continue the queued sequence
+ * and read errors flush the queue, so that no further commands are
+ * spent on a defective area the reader is about to skip; reading
+ * then falls back to the synchronous dh->read().
+ */
+
+void EnableReadAhead(DeviceHandle *dh, int enable, gint64 last_sector)
+{  int i;
+
+   if(!enable)
+   {  if(!dh->queueDepth)
+	return;
+
+#ifdef SYS_LINUX
+      ClosePacketQueue(dh);   /* discards commands still in flight */
+#endif
+
+      for(i=0; i<dh->queueDepth; i++)
+	FreeAlignedBuffer(dh->queue[i].ab);
+
+      dh->queueDepth = 0;
+      dh->queueCount = 0;
+      return;
+   }
+
+   if(last_sector >= dh->sectors)
+     last_sector = dh->sectors-1;
+   dh->queueLast = last_sector;
+
+   if(dh->queueDepth)
+     return;
+
+#ifdef SYS_LINUX
+   if(dh->read == read_dvd_sector || dh->read == read_cd_sector)
+     dh->queueDepth = OpenPacketQueue(dh);
+#endif
+
+   if(dh->queueDepth > MAX_QUEUED_READS)
+     dh->queueDepth = MAX_QUEUED_READS;
+
+   if(dh->queueDepth < 2)
+   {  dh->queueDepth = 0;
+      return;
+   }
+
+   for(i=0; i<dh->queueDepth; i++)
+     dh->queue[i].ab = CreateAlignedBuffer(MAX_CLUSTER_SIZE);
+
+   dh->queueHead  = 0;
+   dh->queueCount = 0;
+   Verbose("# Read ahead enabled with %d commands in flight\n", dh->queueDepth);
+}
+
+#ifdef SYS_LINUX
+
+/*
+ * Wait for the oldest command in the queue and remove it
+ */
+
+static int reap_head(DeviceHandle *dh)
+{  QueuedRead *qr = &dh->queue[dh->queueHead];
+   int ret;
+
+   ret = ReapPacket(dh, dh->queueHead, &qr->sense);
+
+   dh->queueHead = (dh->queueHead+1) % dh->queueDepth;
+   dh->queueCount--;
+
+   return ret;
+}
+
+/*
+ * Forget the commands in flight without waiting for them
+ */
+
+static void flush_queue(DeviceHandle *dh)
+{
+   if(!dh->queueCount)
+     return;
+
+   dh->queueHead  = 0;
+   dh->queueCount = 0;
+
+   if(!FlushPacketQueue(dh))
+     EnableReadAhead(dh, FALSE, 0);
+}
+
+/*
+ * Top up the queue with commands for the following sectors
+ */
+
+static void fill_queue(DeviceHandle *dh)
+{  
+   while(dh->queueCount < dh->queueDepth
+	 && dh->queueNext + dh->queueNSectors - 1 <= dh->queueLast)
+   {  int slot = (dh->queueHead + dh->queueCount) % dh->queueDepth;
+      QueuedRead *qr = &dh->queue[slot];
+      unsigned char cmd[MAX_CDB_SIZE];
+      int cdb_size;
+
+      if(dh->read == read_cd_sector)
+	   cdb_size = build_read_cd_cdb(dh, cmd, dh->queueNext, dh->queueNSectors);
+      else cdb_size = build_read10_cdb(dh, cmd, dh->queueNext, dh->queueNSectors);
+
+      memset(&qr->sense, 0, sizeof(Sense));
+      if(SubmitPacket(dh, cmd, cdb_size, qr->ab->buf, 2048*dh->queueNSectors, &qr->sense, slot) < 0)
+	return;  /* try again later; reading still works synchronously */
+
+      qr->lba      = dh->queueNext;
+      qr->nsectors = dh->queueNSectors;
+      dh->queueNext += dh->queueNSectors;
+      dh->queueCount++;
+   }
+}
+
+static int read_queued(DeviceHandle *dh, unsigned char *buf, gint64 s, int nsectors)
+{  QueuedRead *qr;
+   int ret;
+
+   /* Request does not continue the queued sequence? */
+
+   if(dh->queueCount)
+   {  qr = &dh->queue[dh->queueHead];
+
+      if(qr->lba != s || qr->nsectors != nsectors)
+	flush_queue(dh);
+   }
+
+   /* Start a new sequence behind the requested sectors.
+      The requested sectors are read synchronously first so that
+      the drive sees the commands in ascending order; 
+      later requests will find their commands already queued. */
+
+   if(!dh->queueCount)
+   {  ret = dh->read(dh, buf, s, nsectors);
+
+      if(!ret && dh->queueDepth)
+      {  dh->queueNext     = s+nsectors;
+	 dh->queueNSectors = nsectors;
+	 fill_queue(dh);
+      }
+
+      return ret;
+   }
+
+   /* Collect the queued command. Its slot is reused when the
+      queue is refilled, so the data must be taken out first. */
+
+   qr  = &dh->queue[dh->queueHead];
+   ret = reap_head(dh);
+
+   /* On a read error the reader will retry or skip ahead;
+      the commands behind it would most likely hit the same 
+      defective area, so they are dropped. */
+
+   if(ret < 0)
+   {  memcpy(&dh->sense, &qr->sense, sizeof(Sense));
+      RememberSense(dh->sense.sense_key, dh->sense.asc, dh->sense.ascq);
+      flush_queue(dh);
+      return ret;
+   }
+
+   memcpy(buf, qr->ab->buf, 2048*nsectors);
+   fill_queue(dh);
+
+   return ret;
+}
+#endif
+
+/*
+ * Dispatch between queued and synchronous reading.
+ */
+
+static int read_sectors(DeviceHandle *dh, unsigned char *buf, gint64 s, int nsectors)
+{
+#ifdef SYS_LINUX
+   if(dh->queueDepth && nsectors <= MAX_CLUSTER_SECTORS)
+     return read_queued(dh, buf, s, nsectors);
+#endif
+
+   return dh->read(dh, buf, s, nsectors);
+}
+
 /*
  * Sector reading through the device handle.
  * dh->read dispatches to one the routines above.
  */
 
-int ReadSectors(DeviceHandle *dh, unsigned char *buf, gint64 s, int nsectors)
+static int read_with_retries(DeviceHandle *dh, unsigned char *buf, gint64 s, int nsectors, int *attempts)
 {  int retry,status = -1;
    int recommended_attempts = Closure->minReadAttempts;
 
+   *attempts = 1;
+
    /* See if we are in a simulated defective area */ 
 
    if(dh->defects)
-   {  gint64 i,idx;
+   {  gint64 idx,last = s+nsectors-1;
 
-     for(idx=s,i=0; i<nsectors; idx++,i++)
-       if(GetBit(dh->defects, idx) && !((Random() & 15)))
+     for(idx = FindSetBitInRange(dh->defects, s, last); idx >= 0;
+	 idx = FindSetBitInRange(dh->defects, idx+1, last))
+       if(!(Random() & 15))
        {  dh->sense.sense_key = 3;
 	  dh->sense.asc       = 255;
 	  dh->sense.ascq      = 255;
@@ -2454,12 +2660,13 @@ int ReadSectors(DeviceHandle *dh, unsigned char *buf, gint64 s, int nsectors)
    /* Try normal read */
 
    for(retry=1; retry<=recommended_attempts; retry++)
-   {  
+   {  *attempts = retry;
+
       /* Dispatch between normal reader and raw reader */
 
       if(Closure->readRaw && dh->readRaw)
 	   status = dh->readRaw(dh, buf, s, nsectors);
-      else status = dh->read(dh, buf, s, nsectors);
+      else status = read_sectors(dh, buf, s, nsectors);
 
       if(Closure->readRaw && dh->rawBuffer)
 	recommended_attempts = dh->rawBuffer->recommendedAttempts;
@@ -2527,6 +2734,27 @@ int ReadSectors(DeviceHandle *dh, unsigned char *buf, gint64 s, int nsectors)
    return status;
 }
 
+int ReadSectors(DeviceHandle *dh, unsigned char *buf, gint64 s, int nsectors)
+{  gint64 start,trace_start = TraceBegin();
+   int attempts,status;
+
+   if(!dh->readProfile)
+   {  status = read_with_retries(dh, buf, s, nsectors, &attempts);
+      TraceEnd(TRACE_READ_SECTORS, trace_start);
+      return status;
+   }
+
+   /* Record latency and outcome of the request */
+
+   start  = ReadProfileTimestamp(dh->readProfile);
+   status = read_with_retries(dh, buf, s, nsectors, &attempts);
+   ReadProfileAdd(dh->readProfile, s, nsectors, 
+		  ReadProfileTimestamp(dh->readProfile) - start, attempts, status);
+   TraceEnd(TRACE_READ_SECTORS, trace_start);
+
+   return status;
+}
+
 /*
  * Sector reading through the device handle.
  * dh->read dispatches to one the routines above.
@@ -2538,22 +2766,17 @@ int ReadSectorsFast(DeviceHandle *dh, unsigned char *buf, gint64 s, int nsectors
 
    /* See if we are in a simulated defective area */ 
 
-   if(dh->defects)
-   {  gint64 i,idx;
-
-     for(idx=s,i=0; i<nsectors; idx++,i++)
-       if(GetBit(dh->defects, idx))
-       {  dh->sense.sense_key = 3;
-	  dh->sense.asc       = 255;
-	  dh->sense.ascq      = 255;
-	  RememberSense(dh->sense.sense_key, dh->sense.asc, dh->sense.ascq);
-	  return TRUE;
-       }
+   if(dh->defects && FindSetBitInRange(dh->defects, s, s+nsectors-1) >= 0)
+   {  dh->sense.sense_key = 3;
+      dh->sense.asc       = 255;
+      dh->sense.ascq      = 255;
+      RememberSense(dh->sense.sense_key, dh->sense.asc, dh->sense.ascq);
+      return TRUE;
    }
 
    /* Try normal read */
 
-   status = dh->read(dh, buf, s, nsectors);
+   status = read_sectors(dh, buf, s, nsectors);
 
    return status;
 }
@@ -94,6 +94,19 @@ typedef struct _Sense {
 	guint8 asb[46];
 } Sense;
 
+/***
+ *** Read ahead through queued commands
+ ***/
+
+#define MAX_QUEUED_READS 4    /* upper limit for read ahead commands in flight */
+
+typedef struct _QueuedRead
+{  struct _AlignedBuffer *ab; /* private buffer receiving the data */
+   gint64 lba;                /* first sector requested */
+   int nsectors;              /* number of sectors requested */
+   Sense sense;               /* sense data for this command */
+} QueuedRead;
+
 /***
  ***  The DeviceHandle is pretty much our device abstraction layer. 
  ***
@@ -107,6 +120,10 @@ typedef struct _DeviceHandle
 #if defined(SYS_LINUX) || defined(SYS_NETBSD)
    int fd;                    /* device file descriptor */
 #endif
+#ifdef SYS_LINUX
+   int queueFd;               /* sg device used for queued commands */
+   char *queuePath;           /* and its path */
+#endif
 #ifdef SYS_FREEBSD
    struct cam_device *camdev; /* camlib device handle */
    union ccb *ccb;
@@ -144,6 +161,18 @@ typedef struct _DeviceHandle
    int (*read)(struct _DeviceHandle*, unsigned char*, int, int);
    int (*readRaw)(struct _DeviceHandle*, unsigned char*, int, int);
 
+   /*
+    * Queued read ahead 
+    */
+
+   int queueDepth;            /* commands kept in flight; 0 if read ahead is off */
+   int queueHead;             /* oldest command in flight */
+   int queueCount;            /* number of commands in flight */
+   gint64 queueNext;          /* next sector to be queued */
+   gint64 queueLast;          /* do not queue beyond the reader's last sector */
+   int queueNSectors;         /* sectors per queued command */
+   QueuedRead queue[MAX_QUEUED_READS];
+
    /* 
     * Information about currently inserted medium 
     */
@@ -175,6 +204,12 @@ typedef struct _DeviceHandle
    gint64 userAreaSize;       /* size of user area according to DVD Info struct */
    gint64 blankCapacity;      /* blank capacity (maybe 0 if query failed) */
 
+   /*
+    * Read statistics (see read-profile.c)
+    */
+
+   ReadProfile *readProfile;  /* NULL unless --read-profile was given */
+
    /*
     * debugging stuff
     */
@@ -232,6 +267,14 @@ DeviceHandle* open_spti_device(char*);
 
 int SendPacket(DeviceHandle*, unsigned char*, int, unsigned char*, int, Sense*, int);
 
+#ifdef SYS_LINUX
+int OpenPacketQueue(DeviceHandle*);
+void ClosePacketQueue(DeviceHandle*);
+int FlushPacketQueue(DeviceHandle*);
+int SubmitPacket(DeviceHandle*, unsigned char*, int, unsigned char*, int, Sense*, int);
+int ReapPacket(DeviceHandle*, int, Sense*);
+#endif
+
 /*** 
  *** scsi-layer.c
  ***
@@ -256,5 +299,6 @@ int  TestUnitReady(DeviceHandle*);
 
 int ReadSectors(DeviceHandle*, unsigned char*, gint64, int);
 int ReadSectorsFast(DeviceHandle*, unsigned char*, gint64, int);
+void EnableReadAhead(DeviceHandle*, int, gint64);
 
 #endif /* SCSI_LAYER_H */
@@ -33,6 +33,8 @@
 #include <linux/param.h>
 #include <scsi/sg.h>
 
+#define SG_TIMEOUT (10*60*1000)   /* per command, in ms; shared by synchronous and queued commands */
+
 char* DefaultDevice()
 {  DeviceHandle *dh;
    GDir *dir;
@@ -117,6 +119,9 @@ void CloseDevice(DeviceHandle *dh)
   if(dh->rawBuffer)
      FreeRawBuffer(dh->rawBuffer);
 
+  if(dh->queueDepth)
+    EnableReadAhead(dh, FALSE, 0);
+
   if(dh->fd)
     close(dh->fd);
   if(dh->device)
@@ -278,7 +283,7 @@ static int send_packet_generic(DeviceHandle *dh, unsigned char *cmd, int cdb_siz
    sg_io.dxferp	      = buf;
    sg_io.cmdp	      = cmd;
    sg_io.sbp	      = (unsigned char*)sense;
-   sg_io.timeout      = 10*60*1000;
+   sg_io.timeout      = SG_TIMEOUT;
    sg_io.flags	      = SG_FLAG_LUN_INHIBIT|SG_FLAG_DIRECT_IO;
 
 
@@ -300,6 +305,197 @@ static int send_packet_generic(DeviceHandle *dh, unsigned char *cmd, int cdb_siz
    return 0;
 }
 
+/*
+ * Queued command submission through the asynchronous write()/read()
+ * interface of the sg driver. This only works on the sg device node,
+ * so for /dev/srN we look up the matching /dev/sgN in sysfs.
+ * Queueing is only worthwhile if the drive accepts more than one
+ * command at a time; otherwise 0 is returned and the caller
+ * sticks with SendPacket().
+ */
+
+static char* find_sg_node(char *device)
+{  char *real_path, *base, *sysdir, *sg_name = NULL;
+   GDir *dir;
+
+   real_path = realpath(device, NULL);
+   if(!real_path)
+     return NULL;
+
+   base = strrchr(real_path, '/');
+   base = base ? base+1 : real_path;
+
+   if(!strncmp(base, "sg", 2))
+   {  sg_name = g_strdup(base);
+      free(real_path);
+      return sg_name;
+   }
+
+   sysdir = g_strdup_printf("/sys/block/%s/device/scsi_generic", base);
+   free(real_path);
+
+   dir = g_dir_open(sysdir, 0, NULL);
+   g_free(sysdir);
+
+   if(dir)
+   {  const char *entry = g_dir_read_name(dir);
+
+      if(entry && !strncmp(entry, "sg", 2))
+	sg_name = g_strdup(entry);
+      g_dir_close(dir);
+   }
+
+   return sg_name;
+}
+
+static int query_queue_depth(char *sg_name)
+{  char *path = g_strdup_printf("/sys/class/scsi_generic/%s/device/queue_depth", sg_name);
+   FILE *file = fopen(path, "r");
+   int depth = 1;
+
+   g_free(path);
+   if(!file)
+     return 1;
+
+   if(fscanf(file, "%d", &depth) != 1)
+     depth = 1;
+
+   fclose(file);
+   return depth;
+}
+
+static int open_queue_fd(DeviceHandle *dh)
+{  int flag = 1;
+
+   dh->queueFd = open(dh->queuePath, O_RDWR);
+   if(dh->queueFd < 0)
+   {  Verbose("# OpenPacketQueue: could not open %s: %s\n", dh->queuePath, strerror(errno));
+      dh->queueFd = 0;
+      return FALSE;
+   }
+
+   /* Allow multiple commands per file descriptor and 
+      collect the responses by their pack_id. */
+
+   if(   ioctl(dh->queueFd, SG_SET_COMMAND_Q, &flag) < 0
+      || ioctl(dh->queueFd, SG_SET_FORCE_PACK_ID, &flag) < 0)
+   {  Verbose("# OpenPacketQueue: %s refuses command queueing\n", dh->queuePath);
+      close(dh->queueFd);
+      dh->queueFd = 0;
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+int OpenPacketQueue(DeviceHandle *dh)
+{  char *sg_name;
+   int depth;
+
+   if(Closure->useSCSIDriver != DRIVER_SG)
+     return 0;
+
+   sg_name = find_sg_node(dh->device);
+   if(!sg_name)
+   {  Verbose("# OpenPacketQueue: no sg device for %s\n", dh->device);
+      return 0;
+   }
+
+   depth = query_queue_depth(sg_name);
+   if(depth < 2)
+   {  Verbose("# OpenPacketQueue: %s does not support command queueing\n", sg_name);
+      g_free(sg_name);
+      return 0;
+   }
+
+   dh->queuePath = g_strdup_printf("/dev/%s", sg_name);
+   g_free(sg_name);
+
+   if(!open_queue_fd(dh))
+   {  ClosePacketQueue(dh);
+      return 0;
+   }
+
+   Verbose("# OpenPacketQueue: using %s, queue depth %d\n", dh->queuePath, depth);
+
+   return depth;
+}
+
+void ClosePacketQueue(DeviceHandle *dh)
+{  
+   if(dh->queueFd > 0)
+     close(dh->queueFd);
+   dh->queueFd = 0;
+
+   if(dh->queuePath)
+     g_free(dh->queuePath);
+   dh->queuePath = NULL;
+}
+
+/*
+ * Get rid of all commands in flight without waiting for them.
+ * sg commands can not be cancelled, but when their file descriptor
+ * is closed the driver discards their results once they complete.
+ * The queue is then reopened for the following commands.
+ */
+
+int FlushPacketQueue(DeviceHandle *dh)
+{
+   if(dh->queueFd > 0)
+     close(dh->queueFd);
+   dh->queueFd = 0;
+
+   return open_queue_fd(dh);
+}
+
+int SubmitPacket(DeviceHandle *dh, unsigned char *cmd, int cdb_size, unsigned char *buf, int size, Sense *sense, int tag)
+{  struct sg_io_hdr sg_io;
+
+#ifdef ASSERT_CDB_LENGTH
+   test_cdb(cmd, cdb_size, DATA_READ);
+#endif
+
+   memset(&sg_io, 0, sizeof(sg_io));
+   sg_io.interface_id    = 'S';
+   sg_io.dxfer_direction = SG_DXFER_FROM_DEV;
+   sg_io.cmd_len         = cdb_size;
+   sg_io.mx_sb_len       = sizeof(Sense);
+   sg_io.dxfer_len       = size;
+   sg_io.dxferp	         = buf;
+   sg_io.cmdp	         = cmd;
+   sg_io.sbp	         = (unsigned char*)sense;
+   sg_io.timeout         = SG_TIMEOUT;
+   sg_io.pack_id         = tag;
+
+   if(write(dh->queueFd, &sg_io, sizeof(sg_io)) != sizeof(sg_io))
+     return -1;
+
+   return 0;
+}
+
+int ReapPacket(DeviceHandle *dh, int tag, Sense *sense)
+{  struct sg_io_hdr sg_io;
+
+   memset(&sg_io, 0, sizeof(sg_io));
+   sg_io.interface_id = 'S';
+   sg_io.pack_id      = tag;
+
+   /* Blocks until the command with the given tag has completed.
+      Sense data goes into the buffer given at submission. */
+
+   if(read(dh->queueFd, &sg_io, sizeof(sg_io)) != sizeof(sg_io))
+   {  sense->sense_key = 3;   /* pseudo error indicating */
+      sense->asc       = 255; /* ioctl() failure */
+      sense->ascq      = 254;
+      return -1;
+   }
+
+   if(sg_io.status || sg_io.host_status || sg_io.driver_status)
+      return -1;
+
+   return 0;
+}
+
 int SendPacket(DeviceHandle *dh, unsigned char *cmd, int cdb_size, unsigned char *buf, int size, Sense *sense, int data_mode)
 {
    switch(Closure->useSCSIDriver)
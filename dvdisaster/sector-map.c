@@ -0,0 +1,326 @@
+/*  dvdisaster: Additional error correction for optical media.
+ *  Copyright (C) 2004-2012 Carsten Gnoerlich.
+ *
+ *  Email: carsten@dvdisaster.org  -or-  cgnoerlich@fsfe.org
+ *  Project homepage: http://www.dvdisaster.org
+ *
+ *  This file is part of dvdisaster.
+ *
+ *  dvdisaster is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dvdisaster is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dvdisaster. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "dvdisaster.h"
+
+#ifdef HAVE_MMAP
+  #include <sys/mman.h>
+#endif
+
+/***
+ *** Persistent map of the sectors present in an image file.
+ ***
+ * The map lives in a sidecar file next to the image ("<image>.map")
+ * and records which sectors of the image contain real data
+ * (as opposed to dead sector markers or unwritten areas),
+ * together with the CRC32 sum of each present sector.
+ * It is updated by the readers as sectors land in the image,
+ * so that a later session can resume without rescanning the
+ * whole image file. 
+ *
+ * The map is only a cache: It is discarded whenever it does
+ * not match the image file in size, identity (device and inode),
+ * modification and status change time, or when the previous session 
+ * did not close it properly. The status change time catches rewrites
+ * which keep the modification time, and the nanosecond parts
+ * catch changes within the same second where available.
+ */
+
+#define SECTOR_MAP_VERSION 3
+#define SECTOR_MAP_BYTE_ORDER 0x01020304
+
+typedef struct _SectorMapHeader
+{  gint8 cookie[12];               /* "*dvdisaster*" */
+   gint8 method[4];                /* "SMAP" */
+   gint32 version;                 /* SECTOR_MAP_VERSION */
+   guint32 byteOrder;              /* maps are not portable between architectures */
+   aligned_guint64 sectors;        /* number of sectors covered by the map */
+   aligned_guint64 imageSize;      /* image stat() data at last clean close */
+   aligned_guint64 imageDevice;
+   aligned_guint64 imageInode;
+   aligned_gint64 imageMTime;
+   aligned_gint64 imageMTimeNsec;
+   aligned_gint64 imageCTime;
+   aligned_gint64 imageCTimeNsec;
+   gint32 clean;                   /* FALSE while the map is open for updating */
+   gint8 padding[4004];            /* pad to 4096 bytes; keeps the bitmap page aligned */
+} SectorMapHeader;
+
+/*
+ * Calculate the layout of the map file
+ */
+
+static void calc_layout(SectorMap *map, guint64 sectors)
+{  map->sectors  = sectors;
+   map->present.size  = sectors;
+   map->present.words = (sectors>>6)+1;
+   map->mapSize  = sizeof(SectorMapHeader) 
+                   + map->present.words*sizeof(guint64)
+                   + sectors*sizeof(guint32);
+}
+
+static void set_pointers(SectorMap *map)
+{  map->header = (SectorMapHeader*)map->base;
+   map->present.bitmap = (guint64*)(map->base + sizeof(SectorMapHeader));
+   map->crc    = (guint32*)(map->present.bitmap + map->present.words);
+}
+
+/*
+ * See if an existing map belongs to the current image file
+ */
+
+static int map_is_consistent(SectorMap *map, char *image_name)
+{  SectorMapHeader *smh = map->header;
+   LargeFileStamp stamp;
+
+   if(strncmp((char*)smh->cookie, "*dvdisaster*", 12)
+      || strncmp((char*)smh->method, "SMAP", 4))
+      return FALSE;
+
+   if(   smh->version != SECTOR_MAP_VERSION
+      || smh->byteOrder != SECTOR_MAP_BYTE_ORDER
+      || smh->sectors != map->sectors
+      || !smh->clean)
+      return FALSE;
+
+   if(!LargeFileStampGet(image_name, &stamp))
+      return FALSE;
+
+   return    stamp.size      == smh->imageSize
+          && stamp.device    == smh->imageDevice
+          && stamp.inode     == smh->imageInode
+          && stamp.mtime     == smh->imageMTime
+          && stamp.mtimeNsec == smh->imageMTimeNsec
+          && stamp.ctime     == smh->imageCTime
+          && stamp.ctimeNsec == smh->imageCTimeNsec;
+}
+
+/*
+ * Map the file contents into memory
+ */
+
+static int map_file(SectorMap *map, int writeable)
+{
+#ifdef HAVE_MMAP
+   map->base = mmap(NULL, map->mapSize, 
+		    writeable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED,
+		    map->file->fileHandle, 0);
+   if(map->base == MAP_FAILED)
+   {  map->base = NULL;
+      return FALSE;
+   }
+#else
+   map->base = g_try_malloc(map->mapSize);
+   if(!map->base)
+      return FALSE;
+
+   if(   !LargeSeek(map->file, 0)
+      || LargeRead(map->file, map->base, map->mapSize) != map->mapSize)
+   {  g_free(map->base);
+      map->base = NULL;
+      return FALSE;
+   }
+#endif
+
+   set_pointers(map);
+   return TRUE;
+}
+
+static void unmap_file(SectorMap *map)
+{  
+   if(!map->base) return;
+
+#ifdef HAVE_MMAP
+   munmap(map->base, map->mapSize);
+#else
+   if(map->writeable)
+   {  if(   !LargeSeek(map->file, 0)
+	 || LargeWrite(map->file, map->base, map->mapSize) != map->mapSize)
+	 PrintLog(_("Could not write sector map %s: %s\n"), map->path, strerror(errno));
+   }
+   g_free(map->base);
+#endif
+
+   map->base = NULL;
+}
+
+static void free_map(SectorMap *map)
+{  unmap_file(map);
+   if(map->file) LargeClose(map->file);
+   g_free(map->path);
+   g_free(map);
+}
+
+/*
+ * Open the sector map belonging to the given image.
+ * In SECTOR_MAP_UPDATE mode the map is created if necessary;
+ * map->resumed tells whether its contents could be taken over
+ * from a previous session. In SECTOR_MAP_READONLY mode,
+ * NULL is returned unless a consistent map is available. 
+ */
+
+SectorMap* OpenSectorMap(char *image_name, guint64 sectors, int mode)
+{  SectorMap *map;
+   guint64 file_size;
+
+   if(!Closure->sectorMap || !image_name || !*image_name)
+      return NULL;
+
+   map = g_malloc0(sizeof(SectorMap));
+   map->path = g_strdup_printf("%s.map", image_name);
+   calc_layout(map, sectors);
+
+   /*** Read only access */
+
+   if(mode == SECTOR_MAP_READONLY)
+   {  if(   !LargeStat(map->path, &file_size) 
+	 || file_size != map->mapSize)
+      {  free_map(map);
+	 return NULL;
+      }
+
+      map->file = LargeOpen(map->path, O_RDONLY, IMG_PERMS);
+      if(!map->file || !map_file(map, FALSE))
+      {  free_map(map);
+	 return NULL;
+      }
+
+      if(!map_is_consistent(map, image_name))
+      {  free_map(map);
+	 return NULL;
+      }
+
+      map->resumed = TRUE;
+      return map;
+   }
+
+   /*** Open for updating. Try to take over the old contents first.
+	map->writeable is only set once the contents have been validated
+	or rebuilt, so that a rejected map is never written back. */
+
+   map->imageName = g_strdup(image_name);
+
+   if(LargeStat(map->path, &file_size) && file_size == map->mapSize)
+   {  map->file = LargeOpen(map->path, O_RDWR, IMG_PERMS);
+
+      if(map->file && map_file(map, TRUE))
+      {  if(map_is_consistent(map, image_name))
+	    map->resumed = TRUE;
+	 else unmap_file(map);
+      }
+   }
+
+   /*** Start over with an empty map */
+
+   if(!map->resumed)
+   {  if(map->file) LargeClose(map->file);
+
+      map->file = LargeOpen(map->path, O_RDWR | O_CREAT | O_TRUNC, IMG_PERMS);
+      if(   !map->file 
+	 || !LargeTruncate(map->file, map->mapSize)
+	 || !map_file(map, TRUE))
+      {  PrintLog(_("Could not create sector map %s: %s\n"), map->path, strerror(errno));
+	 g_free(map->imageName);
+	 free_map(map);
+	 return NULL;
+      }
+
+#ifndef HAVE_MMAP
+      memset(map->base, 0, map->mapSize);
+#endif
+      memcpy(map->header->cookie, "*dvdisaster*", 12);
+      memcpy(map->header->method, "SMAP", 4);
+      map->header->version   = SECTOR_MAP_VERSION;
+      map->header->byteOrder = SECTOR_MAP_BYTE_ORDER;
+      map->header->sectors   = sectors;
+   }
+
+   /* The image is going to change; the map is only valid 
+      again after it has been properly closed. */
+
+   map->writeable = TRUE;
+   map->header->clean = FALSE;
+#ifdef HAVE_MMAP
+   msync(map->base, sizeof(SectorMapHeader), MS_SYNC);
+#endif
+
+   if(map->resumed)
+        Verbose("Resuming from sector map %s\n", map->path);
+   else Verbose("Created new sector map %s\n", map->path);
+
+   return map;
+}
+
+/*
+ * Update the map
+ */
+
+void SectorMapSetCrc(SectorMap *map, guint64 sector, guint32 crc)
+{  
+   if(sector >= map->sectors) return;
+
+   map->crc[sector] = crc;
+   SetBit((&map->present), sector);
+}
+
+void SectorMapSet(SectorMap *map, guint64 sector, unsigned char *buf)
+{  
+   if(sector >= map->sectors) return;
+
+   SectorMapSetCrc(map, sector, Crc32(buf, 2048));
+}
+
+void SectorMapClear(SectorMap *map, guint64 sector)
+{  
+   if(sector >= map->sectors) return;
+
+   ClearBit((&map->present), sector);
+}
+
+/*
+ * Close the map. Maps opened for updating are stamped 
+ * with the current image size, identity and times,
+ * so the image must have been closed before calling this.
+ */
+
+void CloseSectorMap(SectorMap *map)
+{  
+   if(map->writeable && map->base)
+   {  SectorMapHeader *smh = map->header;
+      LargeFileStamp stamp;
+
+      if(LargeFileStampGet(map->imageName, &stamp))
+      {  smh->imageSize      = stamp.size;
+	 smh->imageDevice    = stamp.device;
+	 smh->imageInode     = stamp.inode;
+	 smh->imageMTime     = stamp.mtime;
+	 smh->imageMTimeNsec = stamp.mtimeNsec;
+	 smh->imageCTime     = stamp.ctime;
+	 smh->imageCTimeNsec = stamp.ctimeNsec;
+	 smh->clean          = TRUE;
+      }
+   }
+
+   if(map->imageName) g_free(map->imageName);
+   free_map(map);
+}
@@ -91,6 +91,8 @@ typedef struct _sh_context
    int *penalty;                  /* penalty for allready tried solution */
    int visitedMax;
    int visitedCnt;
+   gint32 *visitedHash;           /* open addressing index into visited[] */
+   int hashMask;
    int iteration;                 /* for iterative running within the editor */
    char msg[SMART_LEC_MESSAGE_SIZE]; /* diagnostic output */
 
@@ -112,6 +114,8 @@ typedef struct _sh_context
    int crossedPIdx[N_Q_VECTORS];  /* p vector affected by corrected byte */
    int hitByP[N_Q_VECTORS];       /* hit by how many p vectors? */
 
+   PQState pq;                    /* syndromes of rb->recovered */
+   int pqValid;
 } sh_context;
 
 static sh_context* create_sh_context(RawBuffer *rb)
@@ -122,6 +126,9 @@ static sh_context* create_sh_context(RawBuffer *rb)
    shc->penalty = g_malloc(sizeof(int)*4);
    shc->visitedMax = 4;
    shc->visitedCnt = 0;
+   shc->hashMask   = 7;
+   shc->visitedHash = g_malloc(sizeof(gint32)*8);
+   memset(shc->visitedHash, 0xff, sizeof(gint32)*8);
 
    return shc;
 }
@@ -130,6 +137,7 @@ static void free_sh_context(sh_context *shc)
 {  
    g_free(shc->visited);
    g_free(shc->penalty);
+   g_free(shc->visitedHash);
    g_free(shc);
 }
 
@@ -154,23 +162,63 @@ int found_better_solution(sh_context *shc, int bonus, int malus)
 }
 
 /*
- * Add a frame to the visited list
+ * Visited frames are kept as md5sums. The hash table indexes
+ * them by their first four bytes so that looking up a frame
+ * does not depend on the number of frames visited so far.
  */
 
-static void push_frame(sh_context *shc, unsigned char *frame)
+static guint32 md5_slot(sh_context *shc, unsigned char *md5sum)
+{  guint32 h = md5sum[0] | md5sum[1]<<8 | md5sum[2]<<16 | (guint32)md5sum[3]<<24;
+
+   return h & shc->hashMask;
+}
+
+static void hash_visited(sh_context *shc, int idx)
+{  guint32 slot = md5_slot(shc, &shc->visited[16*idx]);
+
+   while(shc->visitedHash[slot] >= 0)
+      slot = (slot+1) & shc->hashMask;
+
+   shc->visitedHash[slot] = idx;
+}
+
+static void frame_md5(sh_context *shc, unsigned char *frame, unsigned char *md5sum)
 {  MD5Context ctxt;
 
+   MD5Init(&ctxt);
+   MD5Update(&ctxt, frame, shc->rb->sampleSize);
+   MD5Final(md5sum, &ctxt);
+}
+
+/*
+ * Add a frame to the visited list
+ */
+
+static void push_frame(sh_context *shc, unsigned char *frame)
+{
    if(shc->visitedCnt >= shc->visitedMax)
    {  shc->visitedMax *= 2;
       shc->visited = g_realloc(shc->visited, 16*shc->visitedMax);
       shc->penalty = g_realloc(shc->penalty, sizeof(int)*shc->visitedMax);
    }
 
-   MD5Init(&ctxt);
-   MD5Update(&ctxt, frame, shc->rb->sampleSize);
-   MD5Final(&shc->visited[16*shc->visitedCnt], &ctxt);
+   frame_md5(shc, frame, &shc->visited[16*shc->visitedCnt]);
    shc->penalty[shc->visitedCnt] = 0;
    shc->visitedCnt++;
+
+   /* Keep the hash table at most half full */
+
+   if(2*shc->visitedCnt > shc->hashMask)
+   {  int i, size = 2*(shc->hashMask+1);
+
+      shc->hashMask = size-1;
+      shc->visitedHash = g_realloc(shc->visitedHash, sizeof(gint32)*size);
+      memset(shc->visitedHash, 0xff, sizeof(gint32)*size);
+      for(i=0; i<shc->visitedCnt; i++)
+	 hash_visited(shc, i);
+   }
+   else hash_visited(shc, shc->visitedCnt-1);
+
    printf("pushed\n");
 }
 
@@ -179,18 +227,19 @@ static void push_frame(sh_context *shc, unsigned char *frame)
  */
 
 static int frame_visited(sh_context *shc, unsigned char *frame)
-{  MD5Context ctxt;
-   unsigned char md5sum[16];
-   int i,n;
+{  unsigned char md5sum[16];
+   guint32 slot;
 
-   MD5Init(&ctxt);
-   MD5Update(&ctxt, frame, shc->rb->sampleSize);
-   MD5Final(md5sum, &ctxt);
+   frame_md5(shc, frame, md5sum);
+
+   slot = md5_slot(shc, md5sum);
+   while(shc->visitedHash[slot] >= 0)
+   {  int idx = shc->visitedHash[slot];
 
-   n = shc->visitedCnt*16;
-   for(i=0; i<n; i+=16)
-      if(!memcmp(md5sum, &shc->visited[i], 16))
-	 return i/16+1;
+      if(!memcmp(md5sum, &shc->visited[16*idx], 16))
+	 return idx+1;
+      slot = (slot+1) & shc->hashMask;
+   }
 
    return 0;
 }
@@ -290,35 +339,38 @@ static int decode_q(RawBuffer *rb, unsigned char* q_vector, int *pos)
 
 void CollectGoodVectors(RawBuffer *rb)
 {  unsigned char vector[Q_VECTOR_SIZE];
-   int eras[2];
-   int sample_idx;
-   int err;
+   unsigned char *sample;
+   int err[N_P_VECTORS], pos[N_P_VECTORS];
+   unsigned char value[N_P_VECTORS];
    int i,p,q;
 
    if(!rb->samplesRead)  /* We need at least one sample */
       return;
 
-   sample_idx = rb->samplesRead-1;
+   sample = rb->rawBuf[rb->samplesRead-1];
 
    /* Find all P vectors which are accepted by the error correction */
 
+   DecodePVectors(rb->rt, sample, err, pos, value);
+
    for(p=0; p<N_P_VECTORS; p++)
    {  int found = FALSE;
       int last_p = rb->pn[p];
 
-      GetPVector(rb->rawBuf[sample_idx], vector, p);
-      err = DecodePQ(rb->rt, vector, P_PADDING, eras, 0);
-
-      if(err != 0 && err != 1) 
+      if(err[p] != 0 && err[p] != 1) 
 	 continue;
 
+      GetPVector(sample, vector, p);
+      if(err[p] == 1)
+	 vector[pos[p]] = value[p];
+
       for(i=0; i<last_p; i++)
 	 if(!memcmp(rb->pList[p][i], vector, P_VECTOR_SIZE))
 	 {  found = TRUE;
 	    break;
 	 }
 
-      if(!found)
+      if(!found && last_p < rb->samplesMax)
       {  memcpy(rb->pList[p][last_p], vector, P_VECTOR_SIZE);
 	 rb->pn[p]++;
       }
@@ -326,23 +378,26 @@ void CollectGoodVectors(RawBuffer *rb)
 
    /* Find all Q vectors which are accepted by the error correction */
 
+   DecodeQVectors(rb->rt, sample, err, pos, value);
+
    for(q=0; q<N_Q_VECTORS; q++)
    {  int found = FALSE;
       int last_q = rb->qn[q];
 
-      GetQVector(rb->rawBuf[sample_idx], vector, q);
-      err = DecodePQ(rb->rt, vector, Q_PADDING, eras, 0);
-
-      if(err != 0 && err != 1) 
+      if(err[q] != 0 && err[q] != 1) 
 	 continue;
 
+      GetQVector(sample, vector, q);
+      if(err[q] == 1)
+	 vector[pos[q]] = value[q];
+
       for(i=0; i<last_q; i++)
 	 if(!memcmp(rb->qList[q][i], vector, Q_VECTOR_SIZE))
 	 {  found = TRUE;
 	    break;
 	 }
 
-      if(!found)
+      if(!found && last_q < rb->samplesMax)
       {  memcpy(rb->qList[q][last_q], vector, Q_VECTOR_SIZE);
 	 rb->qn[q]++;
       }
@@ -371,8 +426,9 @@ void PrintPQStats(RawBuffer *rb)
 
 static void update_pq_state(sh_context *shc)
 {  RawBuffer *rb = shc->rb;
-   unsigned char vector[Q_VECTOR_SIZE];
-   int eras[2],err,i;
+   int err[N_P_VECTORS], pos[N_P_VECTORS];
+   unsigned char value[N_P_VECTORS];
+   int i;
    int crossed,crossed_idx;
 
    memset(shc->crossedP, 0, sizeof(shc->crossedP));
@@ -382,19 +438,23 @@ static void update_pq_state(sh_context *shc)
    memset(shc->hitByP, 0, sizeof(shc->hitByP));
    memset(shc->hitByQ, 0, sizeof(shc->hitByQ));
 
-   for(i=0; i<N_P_VECTORS; i++)
-   {  GetPVector(rb->recovered, vector, i);
-      err = DecodePQ(rb->rt, vector, P_PADDING, eras, 0);
+   if(!shc->pqValid)
+   {  InitPQState(&shc->pq, rb->gt, rb->recovered);
+      shc->pqValid = TRUE;
+   }
+
+   PQStateDecodePVectors(rb->rt, &shc->pq, err, pos, value);
 
-      switch(err)
+   for(i=0; i<N_P_VECTORS; i++)
+   {  switch(err[i])
       {  case 0: 
 	    shc->pState[i] = 0; 
 	    break;
 	 case 1:
 	    shc->pState[i]    = 1;
-	    shc->pPosition[i] = eras[0];
-	    shc->pValue[i]    = vector[eras[0]];
-	    ByteIndexToQ(PToByteIndex(i, eras[0]), &crossed, &crossed_idx);
+	    shc->pPosition[i] = pos[i];
+	    shc->pValue[i]    = value[i];
+	    ByteIndexToQ(PToByteIndex(i, pos[i]), &crossed, &crossed_idx);
 	    shc->crossedQ[i]  = crossed;
 	    shc->crossedQIdx[i]  = crossed_idx;
 	    shc->hitByP[crossed]++;
@@ -405,19 +465,18 @@ static void update_pq_state(sh_context *shc)
       }
    }
 
-   for(i=0; i<N_Q_VECTORS; i++)
-   {  GetQVector(rb->recovered, vector, i);
-      err = DecodePQ(rb->rt, vector, Q_PADDING, eras, 0);
+   PQStateDecodeQVectors(rb->rt, &shc->pq, err, pos, value);
 
-      switch(err)
+   for(i=0; i<N_Q_VECTORS; i++)
+   {  switch(err[i])
       {  case 0: 
 	    shc->qState[i] = 0; 
 	    break;
 	 case 1:
 	    shc->qState[i]    = 1;
-	    shc->qPosition[i] = eras[0];
-	    shc->qValue[i]    = vector[eras[0]];
-	    ByteIndexToP(QToByteIndex(i, eras[0]), &crossed, &crossed_idx);
+	    shc->qPosition[i] = pos[i];
+	    shc->qValue[i]    = value[i];
+	    ByteIndexToP(QToByteIndex(i, pos[i]), &crossed, &crossed_idx);
 	    shc->crossedP[i]  = crossed;
 	    shc->crossedPIdx[i]  = crossed_idx;
 	    shc->hitByQ[crossed]++;
@@ -612,8 +671,7 @@ static void many_p_correct_one_q(sh_context *shc)
       
 	 /* evaluate the vector combination */
 
-	 GetQVector(rb->recovered, vector, q);
-	 q_before = decode_q(rb, vector, &pos);
+	 q_before = shc->qState[q];
 
 	 GetQVector(rb->recovered, vector, q);
 	 for(i=0; i<n_p; i++)
@@ -742,8 +800,7 @@ static void many_q_correct_one_p(sh_context *shc)
       
 	 /* evaluate the vector combination */
 
-	 GetPVector(rb->recovered, vector, p);
-	 p_before = decode_p(rb, vector, &pos);
+	 p_before = shc->pState[p];
 
 	 GetPVector(rb->recovered, vector, p);
 	 for(i=0; i<n_q; i++)
@@ -823,7 +880,7 @@ static void many_q_correct_one_p(sh_context *shc)
  *** See if replacing a vector with another accepting version improves anything
  ***/
 
-static void evaluate_new_frame(sh_context *shc, unsigned char *new,
+static void evaluate_new_frame(sh_context *shc, PQState *new,
 			       int *better, int *worse)
 {  RawBuffer *rb = shc->rb;
    unsigned char vector[Q_VECTOR_SIZE];
@@ -831,16 +888,22 @@ static void evaluate_new_frame(sh_context *shc, unsigned char *new,
    int err, pos;
 
    for(p=0; p<N_P_VECTORS; p++)
-   {  GetPVector(new, vector, p);
-      err = decode_p(rb, vector, &pos);
+   {  if(PVectorOK(new, p)) err = 0;
+      else
+      {  GetPVector(new->frame, vector, p);
+	 err = decode_p(rb, vector, &pos);
+      }
 
       if(err > shc->pState[p]) *worse  += err - shc->pState[p];
       else                     *better += shc->pState[p] - err;
    }
 
    for(q=0; q<N_Q_VECTORS; q++)
-   {  GetQVector(new, vector, q);
-      err = decode_q(rb, vector, &pos);
+   {  if(QVectorOK(new, q)) err = 0;
+      else
+      {  GetQVector(new->frame, vector, q);
+	 err = decode_q(rb, vector, &pos);
+      }
 
       if(err > shc->qState[q]) *worse  += err - shc->qState[q];
       else                     *better += shc->qState[q] - err;
@@ -850,6 +913,7 @@ static void evaluate_new_frame(sh_context *shc, unsigned char *new,
 static void try_alternative_vectors(sh_context *shc)
 {  RawBuffer *rb = shc->rb;
    unsigned char scratch[MAX_RAW_TRANSFER_SIZE];
+   PQState pq;
    int better, worse;
    int i,p,q;
 
@@ -862,11 +926,13 @@ static void try_alternative_vectors(sh_context *shc)
 	 int malus;
 
          memcpy(scratch, rb->recovered, rb->sampleSize);
-	 SetPVector(scratch, rb->pList[p][i], p);
+	 pq = shc->pq;
+	 pq.frame = scratch;
+	 PQStateSetPVector(&pq, rb->pList[p][i], p);
 	
 	 better = -shc->pState[p];  /* We replaced damaged P with an accepting P */
 	 worse  = 0;
-	 evaluate_new_frame(shc, scratch, &better, &worse);
+	 evaluate_new_frame(shc, &pq, &better, &worse);
 	 bonus =   BONUS_SWAPPED_WITH_BETTER_VECTOR*2
 	         + BONUS_SWAP_IMPROVED_CROSSING*better;
 	 malus = MALUS_SWAP_DESTROYED_CROSSING*worse;
@@ -900,11 +966,13 @@ static void try_alternative_vectors(sh_context *shc)
 	 int malus;
 
          memcpy(scratch, rb->recovered, rb->sampleSize);
-	 SetQVector(scratch, rb->qList[q][i], q);
+	 pq = shc->pq;
+	 pq.frame = scratch;
+	 PQStateSetQVector(&pq, rb->qList[q][i], q);
 	
 	 better = -shc->qState[q];  /* We replaced damaged Q with an accepting Q */
 	 worse  = 0;
-	 evaluate_new_frame(shc, scratch, &better, &worse);
+	 evaluate_new_frame(shc, &pq, &better, &worse);
 	 bonus =   BONUS_SWAPPED_WITH_BETTER_VECTOR*2
 	         + BONUS_SWAP_IMPROVED_CROSSING*better;
 	 malus = MALUS_SWAP_DESTROYED_CROSSING*worse;
@@ -1597,12 +1665,133 @@ static void pick_best_frame(sh_context *shc, char *message)
    printf("Best P: %d/%d, %d/%d\n", rb->bestP2, rb->bestP1, rb->bestQ2, rb->bestQ1);
 
    memcpy(rb->recovered, rb->rawBuf[rb->bestFrame], rb->sampleSize);
+   shc->pqValid = FALSE;
    if(message)
       snprintf(message, SMART_LEC_MESSAGE_SIZE, 
 	       "selected best sector frame %d with %d/%d, %d/%d defective P/Q vectors.",
 		  rb->bestFrame, rb->bestP2, rb->bestP1, rb->bestQ2, rb->bestQ1);
 }
 
+/*
+ * Running the strategies.
+ *
+ * Each strategy works on a private copy of the context and
+ * remembers the best solution it came across. The visited list
+ * is only read while the strategies are running; penalties for
+ * revisited frames are collected per strategy and added to the
+ * shared list afterwards. Finally the solutions are merged in the
+ * order of the strategy table.
+ * This way the outcome of an iteration depends neither on the 
+ * number of threads nor on their scheduling, and running with
+ * one thread replays a parallel run step by step.
+ */
+
+typedef void (*sh_strategy)(sh_context*);
+
+static sh_strategy strategies[] =
+{  many_p_correct_one_q,
+   many_q_correct_one_p,
+#ifndef LOCAL_ONLY
+   try_alternative_vectors,
+   try_alternative_crossing_bytes,
+#endif
+   find_p_with_two_erasures,
+   swap_p_for_new_improvement,
+   try_indirect_improvement
+};
+
+#define N_STRATEGIES ((int)(sizeof(strategies)/sizeof(sh_strategy)))
+
+typedef struct _sh_pool
+{  sh_context *worker[N_STRATEGIES];
+   GMutex *lock;
+   int next;                      /* next strategy to be run */
+} sh_pool;
+
+static gpointer strategy_thread(gpointer data)
+{  sh_pool *pool = (sh_pool*)data;
+
+   while(TRUE)
+   {  int s;
+
+      g_mutex_lock(pool->lock);
+      s = pool->next++;
+      g_mutex_unlock(pool->lock);
+
+      if(s >= N_STRATEGIES)
+	 break;
+
+      strategies[s](pool->worker[s]);
+   }
+
+   return NULL;
+}
+
+static void run_strategies(sh_context *shc)
+{  GThread *thread[N_STRATEGIES];
+   int n_threads = MIN(shc->rb->threads ? shc->rb->threads : Closure->codecThreads, N_STRATEGIES);
+   int penalty_size = sizeof(int)*MAX(shc->visitedCnt, 1);
+   sh_pool pool;
+   int i,s;
+
+   /* Set up the private contexts */
+
+   pool.lock = g_mutex_new();
+   pool.next = 0;
+
+   for(s=0; s<N_STRATEGIES; s++)
+   {  sh_context *w = g_malloc(sizeof(sh_context));
+
+      memcpy(w, shc, sizeof(sh_context));
+      w->penalty = g_malloc(penalty_size);
+      memcpy(w->penalty, shc->penalty, penalty_size);
+      pool.worker[s] = w;
+   }
+
+   /* Run the strategies */
+
+   if(n_threads <= 1)
+      strategy_thread(&pool);
+   else
+   {  for(i=0; i<n_threads; i++)
+      {  GError *err = NULL;
+
+	 thread[i] = g_thread_create(strategy_thread, (gpointer)&pool, TRUE, &err);
+	 if(!thread[i])
+	    Stop("Could not create smart L-EC thread: %s", err->message);
+      }
+
+      for(i=0; i<n_threads; i++)
+	 g_thread_join(thread[i]);
+   }
+
+   /* Merge penalties and solutions.
+      shc->penalty[] has not been touched by the workers. */
+
+   for(i=0; i<shc->visitedCnt; i++)
+   {  int increase = 0;
+
+      for(s=0; s<N_STRATEGIES; s++)
+	 increase += pool.worker[s]->penalty[i] - shc->penalty[i];
+
+      shc->penalty[i] += increase;
+   }
+
+   for(s=0; s<N_STRATEGIES; s++)
+   {  sh_context *w = pool.worker[s];
+
+      if(found_better_solution(shc, w->bestBonus, w->bestMalus))
+      {  memcpy(shc->bestFrame, w->bestFrame, shc->rb->sampleSize);
+	 memcpy(shc->msg, w->msg, SMART_LEC_MESSAGE_SIZE);
+      }
+
+      g_free(w->penalty);
+      g_free(w);
+   }
+
+   g_mutex_free(pool.lock);
+}
+
 static int smart_lec_iteration(sh_context *shc, char *message)
 {  RawBuffer *rb = shc->rb;
   
@@ -1614,23 +1803,11 @@ static int smart_lec_iteration(sh_context *shc, char *message)
    update_pq_state(shc);
    print_pq_state(shc);
 
-   many_p_correct_one_q(shc);
-   many_q_correct_one_p(shc);
-#ifndef LOCAL_ONLY
-   try_alternative_vectors(shc);
-
-   try_alternative_crossing_bytes(shc);
-#endif
-
-   find_p_with_two_erasures(shc);
-
-   swap_p_for_new_improvement(shc);
-
-   try_indirect_improvement(shc);
+   run_strategies(shc);
 
    if(frame_visited(shc, shc->bestFrame))
       printf("pruning!\n");
-   memcpy(rb->recovered, shc->bestFrame, rb->sampleSize);
+   PQStateCopyFrame(&shc->pq, shc->bestFrame, rb->sampleSize);
    push_frame(shc, shc->bestFrame);
 
    if(message)
@@ -1687,6 +1864,10 @@ void *PrepareIterativeSmartLEC(RawBuffer *rb)
 void SmartLECIteration(void *shc_handle, char *message)
 {  sh_context *shc = (sh_context*)shc_handle;
 
+   /* The raw editor may have changed the frame since the last call */
+
+   shc->pqValid = FALSE;
+
    switch(shc->iteration)
    {  case ITERATION_PICK_BEST_SECTOR:
 #ifndef LOCAL_ONLY
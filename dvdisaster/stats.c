@@ -0,0 +1,413 @@
+/*  dvdisaster: Additional error correction for optical media.
+ *  Copyright (C) 2004-2012 Carsten Gnoerlich.
+ *
+ *  Email: carsten@dvdisaster.org  -or-  cgnoerlich@fsfe.org
+ *  Project homepage: http://www.dvdisaster.org
+ *
+ *  This file is part of dvdisaster.
+ *
+ *  dvdisaster is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dvdisaster is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dvdisaster. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "dvdisaster.h"
+
+/***
+ *** Run time statistics.
+ ***
+ * Named timers, counters and gauges for the stages of the major
+ * actions (reading, ecc creation, verification and repair).
+ * Timers accumulate the time spent in a stage, counters add up
+ * amounts (bytes, blocks, ...) and gauges remember the last and
+ * the largest value of a quantity.
+ * Recording is enabled between StartStats() and StopStats() when
+ * --stats or --stats-interval were given; otherwise all functions
+ * return right away. The result is written as one JSON object per
+ * action and optionally as a line in the log every few seconds.
+ * Timers which are updated from several threads may add up to
+ * more than the elapsed time.
+ * Timers and counters are updated for every sector from several
+ * threads, so each thread sums them up in a block of its own and
+ * the blocks are only added up for the output. A block's lock is
+ * therefore only contended while it is being read out.
+ * The timer is kept for the life time of the program since threads
+ * which outlive the action (e.g. the md5 workers) may still ask it
+ * for time stamps after StopStats().
+ */
+
+enum { STATS_TIMER, STATS_COUNTER, STATS_GAUGE };
+
+typedef struct
+{  char *name;
+   int kind;
+   int io;                 /* timer counts towards I/O time */
+} stats_desc;
+
+static stats_desc descriptions[STAT_COUNT] =
+{  { "ioWait",       STATS_TIMER, TRUE  },
+   { "flush",        STATS_TIMER, TRUE  },
+   { "encodeWait",   STATS_TIMER, FALSE },
+   { "encode",       STATS_TIMER, FALSE },
+   { "crc",          STATS_TIMER, FALSE },
+   { "md5",          STATS_TIMER, FALSE },
+   { "syndrome",     STATS_TIMER, FALSE },
+   { "decode",       STATS_TIMER, FALSE },
+   { "bytesRead",    STATS_COUNTER, FALSE },
+   { "bytesWritten", STATS_COUNTER, FALSE },
+   { "eccBlocks",    STATS_COUNTER, FALSE },
+   { "erasures",     STATS_COUNTER, FALSE },
+   { "corrected",    STATS_COUNTER, FALSE },
+   { "uncorrectable",STATS_COUNTER, FALSE },
+   { "readErrors",   STATS_COUNTER, FALSE },
+   { "cpuBound",     STATS_COUNTER, FALSE },
+   { "ioBound",      STATS_COUNTER, FALSE },
+   { "readSpeed",    STATS_GAUGE,   FALSE },
+   { "codecThreads", STATS_GAUGE,   FALSE },
+};
+
+typedef struct
+{  gint64 value;           /* usecs, sum or last value */
+   gint64 count;           /* number of updates */
+   gint64 max;             /* longest interval or largest value */
+} stats_value;
+
+typedef struct _stats_block
+{  stats_value values[STAT_COUNT];  /* timers and counters of one thread */
+   GMutex *lock;
+   int inUse;                        /* owning thread is still running */
+   struct _stats_block *next;
+} stats_block;
+
+static GStaticPrivate stats_key = G_STATIC_PRIVATE_INIT;
+static GStaticMutex stats_lock = G_STATIC_MUTEX_INIT;  /* protects blocks and gauges */
+static stats_block *blocks;
+static stats_value gauges[STAT_COUNT];
+static GTimer *stats_timer;    /* never destroyed, see above */
+static gint64 stats_origin;    /* time stamp of StartStats() */
+static char *stats_action;
+static gint stats_enabled;
+static gint next_line;         /* second of the next periodic line */
+static int stats_depth;
+
+/***
+ *** Recording
+ ***/
+
+/*
+ * Returns a time stamp in microseconds for measuring a stage,
+ * or 0 when recording is disabled.
+ */
+
+gint64 StatsTimestamp(void)
+{
+   if(!g_atomic_int_get(&stats_enabled))
+     return 0;
+
+   return (gint64)(1000000.0*g_timer_elapsed(stats_timer, NULL));
+}
+
+/*
+ * Find the block of the calling thread; create it upon first use.
+ * Blocks of finished threads are handed on to new ones,
+ * keeping their values.
+ */
+
+static void release_block(gpointer data)
+{  stats_block *sb = (stats_block*)data;
+
+   g_static_mutex_lock(&stats_lock);
+   sb->inUse = FALSE;
+   g_static_mutex_unlock(&stats_lock);
+}
+
+static stats_block* get_block(void)
+{  stats_block *sb = g_static_private_get(&stats_key);
+
+   if(sb) return sb;
+
+   g_static_mutex_lock(&stats_lock);
+   for(sb=blocks; sb; sb=sb->next)
+     if(!sb->inUse)
+       break;
+
+   if(!sb)
+   {  sb = g_malloc0(sizeof(stats_block));
+      sb->lock = g_mutex_new();
+      sb->next = blocks;
+      blocks   = sb;
+   }
+   sb->inUse = TRUE;
+   g_static_mutex_unlock(&stats_lock);
+
+   g_static_private_set(&stats_key, sb, release_block);
+
+   return sb;
+}
+
+static void print_stats_line(gint64 now);
+
+static void update_value(stats_value *sv, gint64 value, int add)
+{
+   if(add) sv->value += value;
+   else    sv->value  = value;
+   sv->count++;
+   if(value > sv->max)
+     sv->max = value;
+}
+
+static void update(int id, gint64 value, int add)
+{
+   if(descriptions[id].kind == STATS_GAUGE)   /* rare; last value is global */
+   {  g_static_mutex_lock(&stats_lock);
+      update_value(&gauges[id], value, add);
+      g_static_mutex_unlock(&stats_lock);
+   }
+   else
+   {  stats_block *sb = get_block();
+
+      g_mutex_lock(sb->lock);
+      update_value(&sb->values[id], value, add);
+      g_mutex_unlock(sb->lock);
+   }
+
+   /* Only the thread which advances next_line prints the line */
+
+   if(Closure->statsInterval)
+   {  gint64 now = StatsTimestamp();
+      gint next  = g_atomic_int_get(&next_line);
+
+      if(   now >= 1000000*(gint64)next
+	 && g_atomic_int_compare_and_exchange(&next_line, next,
+					      now/1000000 + Closure->statsInterval))
+	print_stats_line(now);
+   }
+}
+
+/*
+ * Adds the time elapsed since the given time stamp to a timer
+ */
+
+void StatsTime(int id, gint64 start)
+{
+   if(!g_atomic_int_get(&stats_enabled))
+     return;
+
+   update(id, StatsTimestamp()-start, TRUE);
+}
+
+/*
+ * Adds n to a counter. Loops over small items may also sum up
+ * their time locally and add the microseconds to a timer here.
+ */
+
+void StatsCount(int id, gint64 n)
+{
+   if(!g_atomic_int_get(&stats_enabled))
+     return;
+
+   update(id, n, TRUE);
+}
+
+void StatsGauge(int id, gint64 value)
+{
+   if(!g_atomic_int_get(&stats_enabled))
+     return;
+
+   update(id, value, FALSE);
+}
+
+/***
+ *** Output
+ ***/
+
+/*
+ * Add up the blocks of all threads
+ */
+
+static void collect_values(stats_value *values)
+{  stats_block *sb;
+   int i;
+
+   g_static_mutex_lock(&stats_lock);
+   memcpy(values, gauges, sizeof(gauges));
+
+   for(sb=blocks; sb; sb=sb->next)
+   {  g_mutex_lock(sb->lock);
+      for(i=0; i<STAT_COUNT; i++)
+      {  values[i].value += sb->values[i].value;
+	 values[i].count += sb->values[i].count;
+	 values[i].max    = MAX(values[i].max, sb->values[i].max);
+      }
+      g_mutex_unlock(sb->lock);
+   }
+   g_static_mutex_unlock(&stats_lock);
+}
+
+static void reset_values(void)
+{  stats_block *sb;
+
+   g_static_mutex_lock(&stats_lock);
+   memset(gauges, 0, sizeof(gauges));
+
+   for(sb=blocks; sb; sb=sb->next)
+   {  g_mutex_lock(sb->lock);
+      memset(sb->values, 0, sizeof(sb->values));
+      g_mutex_unlock(sb->lock);
+   }
+   g_static_mutex_unlock(&stats_lock);
+}
+
+static void sum_io_cpu(stats_value *values, double *io, double *cpu)
+{  int i;
+
+   *io = *cpu = 0.0;
+   for(i=0; i<STAT_COUNT; i++)
+     if(descriptions[i].kind == STATS_TIMER)
+     {  if(descriptions[i].io) *io  += values[i].value/1000000.0;
+        else if(i != STAT_ENCODE_WAIT) *cpu += values[i].value/1000000.0;
+     }
+}
+
+static void print_stats_line(gint64 now)
+{  GString *line = g_string_sized_new(256);
+   stats_value values[STAT_COUNT];
+   int i;
+
+   collect_values(values);
+   g_string_append_printf(line, "Stats %s %.1fs:", stats_action, (now-stats_origin)/1000000.0);
+
+   for(i=0; i<STAT_COUNT; i++)
+   {  stats_value *sv = &values[i];
+
+      if(!sv->count) continue;
+
+      if(descriptions[i].kind == STATS_TIMER)
+	   g_string_append_printf(line, " %s=%.2fs", descriptions[i].name, sv->value/1000000.0);
+      else g_string_append_printf(line, " %s=%lld", descriptions[i].name, (long long)sv->value);
+   }
+
+   PrintLog("%s\n", line->str);
+   g_string_free(line, TRUE);
+}
+
+static GString* stats_json(double elapsed)
+{  GString *json = g_string_sized_new(1024);
+   stats_value values[STAT_COUNT];
+   double io,cpu;
+   int kind,i;
+   static char *sections[] = { "timers", "counters", "gauges" };
+
+   collect_values(values);
+   sum_io_cpu(values, &io, &cpu);
+
+   g_string_append_printf(json, "{\"action\": \"%s\", \"elapsedSecs\": %.3f, "
+			  "\"ioSecs\": %.3f, \"cpuSecs\": %.3f, \"bottleneck\": \"%s\"",
+			  stats_action, elapsed, io, cpu, 
+			  io+cpu == 0.0 ? "none" : (io >= cpu ? "io" : "cpu"));
+
+   for(kind=STATS_TIMER; kind<=STATS_GAUGE; kind++)
+   {  int first = TRUE;
+
+      g_string_append_printf(json, ", \"%s\": {", sections[kind]);
+      for(i=0; i<STAT_COUNT; i++)
+      {  stats_value *sv = &values[i];
+
+	 if(descriptions[i].kind != kind || !sv->count)
+	   continue;
+
+	 g_string_append_printf(json, "%s\"%s\": ", first ? "" : ", ", descriptions[i].name);
+	 switch(kind)
+	 {  case STATS_TIMER:
+	      g_string_append_printf(json, "{\"secs\": %.3f, \"count\": %lld, \"maxUsecs\": %lld}",
+				     sv->value/1000000.0, (long long)sv->count, (long long)sv->max);
+	      break;
+	    case STATS_COUNTER:
+	      g_string_append_printf(json, "%lld", (long long)sv->value);
+	      break;
+	    case STATS_GAUGE:
+	      g_string_append_printf(json, "{\"last\": %lld, \"max\": %lld}",
+				     (long long)sv->value, (long long)sv->max);
+	      break;
+	 }
+	 first = FALSE;
+      }
+      g_string_append(json, "}");
+   }
+
+   g_string_append(json, "}");
+
+   return json;
+}
+
+/***
+ *** Start and stop recording for an action
+ ***/
+
+void StartStats(char *action)
+{
+   if(!Closure->stats && !Closure->statsInterval)
+     return;
+
+   if(stats_depth++)   /* nested action, e.g. ecc creation after reading */
+     return;
+
+   if(!stats_timer)
+     stats_timer = g_timer_new();
+
+   reset_values();
+   stats_action = action;
+   stats_origin = (gint64)(1000000.0*g_timer_elapsed(stats_timer, NULL));
+   g_atomic_int_set(&next_line, stats_origin/1000000 + Closure->statsInterval);
+   g_atomic_int_set(&stats_enabled, TRUE);
+
+   StatsGauge(STAT_CODEC_THREADS, Closure->codecThreads);
+}
+
+/*
+ * Writes the JSON report of the action as a single line, 
+ * either appended to Closure->statsFile or into the log.
+ */
+
+void StopStats(void)
+{  GString *json;
+   FILE *file;
+
+   if(!stats_depth || --stats_depth)
+     return;
+
+   g_atomic_int_set(&stats_enabled, FALSE);
+   json = stats_json(g_timer_elapsed(stats_timer, NULL) - stats_origin/1000000.0);
+
+   if(!Closure->stats)
+   {  g_string_free(json, TRUE);
+      return;
+   }
+
+   if(!Closure->statsFile)
+   {  PrintLog("%s\n", json->str);
+      g_string_free(json, TRUE);
+      return;
+   }
+
+   file = portable_fopen(Closure->statsFile, "a");
+   if(!file)
+      PrintLog(_("Could not write statistics %s: %s\n"), Closure->statsFile, strerror(errno));
+   else
+   {  g_fprintf(file, "%s\n", json->str);
+      if(fclose(file))
+	 PrintLog(_("Could not write statistics %s: %s\n"), Closure->statsFile, strerror(errno));
+   }
+
+   g_string_free(json, TRUE);
+}
@@ -0,0 +1,234 @@
+/*  dvdisaster: Additional error correction for optical media.
+ *  Copyright (C) 2004-2012 Carsten Gnoerlich.
+ *
+ *  Email: carsten@dvdisaster.org  -or-  cgnoerlich@fsfe.org
+ *  Project homepage: http://www.dvdisaster.org
+ *
+ *  This file is part of dvdisaster.
+ *
+ *  dvdisaster is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  dvdisaster is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dvdisaster. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "dvdisaster.h"
+
+/***
+ *** Span tracing.
+ ***
+ * Records the begin and duration of selected hot path operations
+ * so that the interplay of the reader and encoder threads can be
+ * viewed on a time line. Each thread writes into its own ring
+ * buffer without any locking; when a ring is full the oldest spans
+ * are overwritten. The rings are only read by StopTrace() after
+ * the actions have finished and their threads have been joined.
+ * The output is in the Chrome trace event format and can be loaded
+ * into chrome://tracing or the Perfetto UI.
+ * StartTrace() and StopTrace() are called once per program run
+ * from the main thread.
+ */
+
+#define TRACE_RING_SIZE 65536     /* spans per thread */
+
+static struct
+{  char *name;
+   char *category;
+} spans[TRACE_COUNT] =
+{  { "read_next_chunk",    "io"     },
+   { "flush_crc",          "io"     },
+   { "flush_parity",       "io"     },
+   { "wait for encoders",  "wait"   },
+   { "encode",             "codec"  },
+   { "wait for data",      "wait"   },
+   { "wait for slices",    "wait"   },
+   { "fix cache refill",   "io"     },
+   { "fix decode",         "codec"  },
+   { "ReadSectors",        "io"     },
+};
+
+typedef struct
+{  gint64 start;           /* usecs since StartTrace() */
+   gint64 duration;
+   int span;
+} trace_event;
+
+typedef struct _trace_ring
+{  trace_event *event;
+   guint64 written;        /* total number of spans recorded */
+   int tid;
+   char *name;
+   struct _trace_ring *next;
+} trace_ring;
+
+static GStaticPrivate trace_key = G_STATIC_PRIVATE_INIT;
+static GStaticMutex trace_lock = G_STATIC_MUTEX_INIT;  /* protects rings and next_tid */
+static trace_ring *rings;
+static int next_tid;
+static GTimer *trace_timer;
+static int trace_enabled;
+
+/*
+ * Find the ring of the calling thread; create it upon first use
+ */
+
+static trace_ring* get_ring(void)
+{  trace_ring *tr = g_static_private_get(&trace_key);
+
+   if(tr) return tr;
+
+   tr = g_malloc0(sizeof(trace_ring));
+   tr->event = g_malloc(TRACE_RING_SIZE*sizeof(trace_event));
+
+   g_static_mutex_lock(&trace_lock);
+   tr->tid  = ++next_tid;
+   tr->next = rings;
+   rings    = tr;
+   g_static_mutex_unlock(&trace_lock);
+
+   g_static_private_set(&trace_key, tr, NULL);
+
+   return tr;
+}
+
+/***
+ *** Recording
+ ***/
+
+/*
+ * Returns the begin of a span in microseconds (offset by one
+ * so that it is never 0), or 0 when tracing is disabled.
+ */
+
+gint64 TraceBegin(void)
+{
+   if(!trace_enabled)
+     return 0;
+
+   return (gint64)(1000000.0*g_timer_elapsed(trace_timer, NULL)) + 1;
+}
+
+void TraceEnd(int span, gint64 start)
+{  trace_ring *tr;
+   trace_event *te;
+
+   if(!trace_enabled || !start)
+     return;
+
+   tr = get_ring();
+   te = &tr->event[tr->written % TRACE_RING_SIZE];
+   te->start    = start - 1;
+   te->duration = TraceBegin() - start;
+   te->span     = span;
+   tr->written++;
+}
+
+/*
+ * Names the row of the calling thread in the time line
+ */
+
+void TraceThreadName(char *format, ...)
+{  trace_ring *tr;
+   va_list argp;
+
+   if(!trace_enabled)
+     return;
+
+   tr = get_ring();
+   if(tr->name) g_free(tr->name);
+
+   va_start(argp, format);
+   tr->name = g_strdup_vprintf(format, argp);
+   va_end(argp);
+}
+
+/***
+ *** Start and stop tracing
+ ***/
+
+void StartTrace(void)
+{
+   if(!Closure->traceFile)
+     return;
+
+   trace_timer = g_timer_new();
+   trace_enabled = TRUE;
+
+   TraceThreadName("main");
+}
+
+/*
+ * Writes out the rings and releases them.
+ */
+
+static void write_ring(FILE *file, trace_ring *tr, int *first)
+{  guint64 i = tr->written > TRACE_RING_SIZE ? tr->written - TRACE_RING_SIZE : 0;
+
+   g_fprintf(file, "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+	     "\"args\": {\"name\": \"%s\"}}",
+	     *first ? "" : ",", tr->tid, tr->name ? tr->name : "worker");
+   *first = FALSE;
+
+   if(i)
+     g_fprintf(file, ",\n{\"name\": \"dropped\", \"ph\": \"i\", \"s\": \"t\", \"ts\": 0, "
+	       "\"pid\": 1, \"tid\": %d, \"args\": {\"spans\": %lld}}",
+	       tr->tid, (long long)i);
+
+   for(; i<tr->written; i++)
+   {  trace_event *te = &tr->event[i % TRACE_RING_SIZE];
+
+      g_fprintf(file, ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", "
+		"\"ts\": %lld, \"dur\": %lld, \"pid\": 1, \"tid\": %d}",
+		spans[te->span].name, spans[te->span].category,
+		(long long)te->start, (long long)te->duration, tr->tid);
+   }
+}
+
+void StopTrace(void)
+{  trace_ring *tr;
+   FILE *file;
+   int first = TRUE;
+
+   if(!trace_enabled)
+     return;
+
+   trace_enabled = FALSE;
+   g_timer_destroy(trace_timer);
+
+   file = portable_fopen(Closure->traceFile, "w");
+   if(!file)
+      PrintLog(_("Could not write trace %s: %s\n"), Closure->traceFile, strerror(errno));
+   else
+   {  g_fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+      for(tr=rings; tr; tr=tr->next)
+	 write_ring(file, tr, &first);
+      g_fprintf(file, "\n]}\n");
+
+      if(fclose(file))
+	 PrintLog(_("Could not write trace %s: %s\n"), Closure->traceFile, strerror(errno));
+   }
+
+   /* Release the rings */
+
+   g_static_private_set(&trace_key, NULL, NULL);
+
+   tr = rings;
+   while(tr)
+   {  trace_ring *next = tr->next;
+
+      g_free(tr->event);
+      if(tr->name) g_free(tr->name);
+      g_free(tr);
+      tr = next;
+   }
+   rings = NULL;
+}